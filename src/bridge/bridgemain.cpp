@@ -1487,6 +1487,11 @@ BRIDGE_IMPEXP void GuiFoldDisassembly(duint startAddress, duint length)
     _gui_sendmessage(GUI_FOLD_DISASSEMBLY, (void*)startAddress, (void*)length);
 }
 
+BRIDGE_IMPEXP void GuiBenchmarkGraphLayout(int blockCount)
+{
+    _gui_sendmessage(GUI_BENCHMARK_GRAPH_LAYOUT, (void*)(duint)blockCount, nullptr);
+}
+
 BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved)
 {
     hInst = hinstDLL;
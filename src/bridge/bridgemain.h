@@ -980,7 +980,8 @@ typedef enum
     GUI_ADD_FAVOURITE_COMMAND,      // param1=const char* command   param2=const char* shortcut
     GUI_SET_FAVOURITE_TOOL_SHORTCUT,// param1=const char* name      param2=const char* shortcut
     GUI_FOLD_DISASSEMBLY,           // param1=duint startAddress    param2=duint length
-	GUI_GET_ACTIVE_VIEW				// param1=unused,               param2=unused
+	GUI_GET_ACTIVE_VIEW,			// param1=unused,               param2=unused
+    GUI_BENCHMARK_GRAPH_LAYOUT,     // param1=int blockCount        param2=unused
 } GUIMSG;
 
 //GUI Typedefs
@@ -1111,6 +1112,7 @@ BRIDGE_IMPEXP void GuiAddFavouriteTool(const char* name, const char* description
 BRIDGE_IMPEXP void GuiAddFavouriteCommand(const char* name, const char* shortcut);
 BRIDGE_IMPEXP void GuiSetFavouriteToolShortcut(const char* name, const char* shortcut);
 BRIDGE_IMPEXP void GuiFoldDisassembly(duint startAddress, duint length);
+BRIDGE_IMPEXP void GuiBenchmarkGraphLayout(int blockCount);
 
 #ifdef __cplusplus
 }
@@ -296,6 +296,7 @@ void dbgfunctionsinit()
     _dbgfunctions.ModGetParty = ModGetParty;
     _dbgfunctions.ModSetParty = ModSetParty;
     _dbgfunctions.WatchIsWatchdogTriggered = WatchIsWatchdogTriggered;
+    _dbgfunctions.GetAnnotationRevision = SymAnnotationRevision;
     _dbgfunctions.Assemble = assemble;
     _dbgfunctions.PatchGet = _patchget;
     _dbgfunctions.PatchInRange = _patchinrange;
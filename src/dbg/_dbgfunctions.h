@@ -144,6 +144,7 @@ typedef duint(*GETDBGEVENTS)();
 typedef int (*MODGETPARTY)(duint base);
 typedef void (*MODSETPARTY)(duint base, int party);
 typedef bool (*WATCHISWATCHDOGTRIGGERED)(unsigned int id);
+typedef unsigned int (*GETANNOTATIONREVISION)();
 
 typedef struct DBGFUNCTIONS_
 {
@@ -198,6 +199,7 @@ typedef struct DBGFUNCTIONS_
     MODGETPARTY ModGetParty;
     MODSETPARTY ModSetParty;
     WATCHISWATCHDOGTRIGGERED WatchIsWatchdogTriggered;
+    GETANNOTATIONREVISION GetAnnotationRevision;
 } DBGFUNCTIONS;
 
 #ifdef BUILD_DBG
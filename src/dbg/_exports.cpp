@@ -33,6 +33,7 @@
 #include "encodemap.h"
 #include "argument.h"
 #include "watch.h"
+#include "symbolindex.h"
 
 static bool bOnlyCipAutoComments = false;
 
@@ -117,6 +118,36 @@ static bool shouldFilterSymbol(const char* name)
     return false;
 }
 
+static bool getSymbol(duint addr, String & name, bool & undecorated)
+{
+    duint displacement = 0;
+    String decoratedName, undecoratedName;
+    auto result = SymIndexFromAddr(addr, displacement, &decoratedName, bUndecorateSymbolNames ? &undecoratedName : nullptr);
+    if(result == SymIndexResult::NotFound)
+        return false;
+    if(result == SymIndexResult::Unavailable) //the symbol index of the module is not built yet
+    {
+        DWORD64 symDisplacement = 0;
+        char buffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME * sizeof(char)];
+        PSYMBOL_INFO pSymbol = (PSYMBOL_INFO)buffer;
+        pSymbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+        pSymbol->MaxNameLen = MAX_LABEL_SIZE;
+        if(!SafeSymFromAddr(fdProcessInfo->hProcess, (DWORD64)addr, &symDisplacement, pSymbol))
+            return false;
+        pSymbol->Name[pSymbol->MaxNameLen - 1] = '\0';
+        displacement = duint(symDisplacement);
+        decoratedName = pSymbol->Name;
+        char undecoratedBuffer[MAX_LABEL_SIZE];
+        if(bUndecorateSymbolNames && SafeUnDecorateSymbolName(pSymbol->Name, undecoratedBuffer, MAX_LABEL_SIZE, UNDNAME_COMPLETE))
+            undecoratedName = undecoratedBuffer;
+    }
+    if(displacement)
+        return false;
+    undecorated = !undecoratedName.empty();
+    name = undecorated ? undecoratedName : decoratedName;
+    return true;
+}
+
 static bool getLabel(duint addr, char* label)
 {
     bool retval = false;
@@ -124,16 +155,11 @@ static bool getLabel(duint addr, char* label)
         retval = true;
     else //no user labels
     {
-        DWORD64 displacement = 0;
-        char buffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME * sizeof(char)];
-        PSYMBOL_INFO pSymbol = (PSYMBOL_INFO)buffer;
-        pSymbol->SizeOfStruct = sizeof(SYMBOL_INFO);
-        pSymbol->MaxNameLen = MAX_LABEL_SIZE;
-        if(SafeSymFromAddr(fdProcessInfo->hProcess, (DWORD64)addr, &displacement, pSymbol) && !displacement)
+        String name;
+        bool undecorated;
+        if(getSymbol(addr, name, undecorated))
         {
-            pSymbol->Name[pSymbol->MaxNameLen - 1] = '\0';
-            if(!bUndecorateSymbolNames || !SafeUnDecorateSymbolName(pSymbol->Name, label, MAX_LABEL_SIZE, UNDNAME_COMPLETE))
-                strcpy_s(label, MAX_LABEL_SIZE, pSymbol->Name);
+            strncpy_s(label, MAX_LABEL_SIZE, name.c_str(), _TRUNCATE);
             retval = !shouldFilterSymbol(label);
         }
         if(!retval)  //search for CALL <jmp.&user32.MessageBoxA>
@@ -145,11 +171,12 @@ static bool getLabel(duint addr, char* label)
                 duint val = 0;
                 if(MemRead(basicinfo.memory.value, &val, sizeof(val), nullptr, true))
                 {
-                    if(SafeSymFromAddr(fdProcessInfo->hProcess, (DWORD64)val, &displacement, pSymbol) && !displacement)
+                    if(getSymbol(val, name, undecorated))
                     {
-                        pSymbol->Name[pSymbol->MaxNameLen - 1] = '\0';
-                        if(!bUndecorateSymbolNames || !SafeUnDecorateSymbolName(pSymbol->Name, label, MAX_LABEL_SIZE, UNDNAME_COMPLETE))
-                            sprintf_s(label, MAX_LABEL_SIZE, "JMP.&%s", pSymbol->Name);
+                        if(undecorated)
+                            strncpy_s(label, MAX_LABEL_SIZE, name.c_str(), _TRUNCATE);
+                        else
+                            _snprintf_s(label, MAX_LABEL_SIZE, _TRUNCATE, "JMP.&%s", name.c_str());
                         retval = !shouldFilterSymbol(label);
                     }
                 }
@@ -831,9 +858,11 @@ extern "C" DLL_EXPORT duint _dbg_sendmessage(DBGMSG type, void* param1, void* pa
         bOnlyCipAutoComments = settingboolget("Disassembler", "OnlyCipAutoComments");
         bListAllPages = settingboolget("Engine", "ListAllPages");
         bUndecorateSymbolNames = settingboolget("Engine", "UndecorateSymbolNames");
+        SymInvalidateAnnotations();
         bEnableSourceDebugging = settingboolget("Engine", "EnableSourceDebugging");
         bTraceRecordEnabledDuringTrace = settingboolget("Engine", "TraceRecordEnabledDuringTrace");
         bSkipInt3Stepping = settingboolget("Engine", "SkipInt3Stepping");
+        bDeferBreakpointLog = settingboolget("Engine", "DeferBreakpointLog");
 
         duint setting;
         if(BridgeSettingGetUint("Engine", "BreakpointType", &setting))
@@ -1132,35 +1161,7 @@ extern "C" DLL_EXPORT duint _dbg_sendmessage(DBGMSG type, void* param1, void* pa
 
     case DBG_GET_STRING_AT:
     {
-        auto addr = duint(param1);
-        if(!MemIsValidReadPtrUnsafe(addr, true))
-            return false;
-
-        auto dest = (char*)param2;
-        *dest = '\0';
-        char string[MAX_STRING_SIZE];
-        duint addrPtr;
-        STRING_TYPE strtype;
-        if(MemReadUnsafe(addr, &addrPtr, sizeof(addr)) && MemIsValidReadPtrUnsafe(addrPtr, true))
-        {
-            if(disasmgetstringat(addrPtr, &strtype, string, string, MAX_STRING_SIZE - 5))
-            {
-                if(strtype == str_ascii)
-                    sprintf_s(dest, MAX_STRING_SIZE, "&\"%s\"", string);
-                else //unicode
-                    sprintf_s(dest, MAX_STRING_SIZE, "&L\"%s\"", string);
-                return true;
-            }
-        }
-        if(disasmgetstringat(addr, &strtype, string, string, MAX_STRING_SIZE - 4))
-        {
-            if(strtype == str_ascii)
-                sprintf_s(dest, MAX_STRING_SIZE, "\"%s\"", string);
-            else //unicode
-                sprintf_s(dest, MAX_STRING_SIZE, "L\"%s\"", string);
-            return true;
-        }
-        return false;
+        return disasmgetstringatwrapper(duint(param1), (char*)param2);
     }
     break;
 
@@ -46,4 +46,23 @@ SCRIPT_EXPORT bool Script::Pattern::SearchAndReplaceMem(duint start, duint size,
     patternwrite(data() + found, data.size() - found, replacepattern);
     MemWrite((start + found), data() + found, data.size() - found);
     return true;
+}
+
+SCRIPT_EXPORT bool Script::Pattern::FindAllMulti(const char* scope, const char** patterns, int count, duint maxresults, ListOf(PatternMatch) matches)
+{
+    std::vector<SimplePage> pages;
+    if(!patterns || count <= 0 || !MemFindScopePages(scope, pages))
+        return false;
+    std::vector<std::vector<PatternByte>> searchpatterns(count);
+    for(int i = 0; i < count; i++)
+        if(!patterntransform(patterns[i], searchpatterns[i]))
+            return false;
+    std::vector<MemFindMatch> results;
+    if(!MemFindPatternsInMap(pages, searchpatterns, results, maxresults))
+        return false;
+    std::vector<PatternMatch> scriptMatches;
+    scriptMatches.reserve(results.size());
+    for(const auto & result : results)
+        scriptMatches.push_back(PatternMatch { result.address, int(result.pattern) });
+    return BridgeList<PatternMatch>::CopyData(matches, scriptMatches);
 }
\ No newline at end of file
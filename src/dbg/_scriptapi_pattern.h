@@ -7,12 +7,19 @@ namespace Script
 {
     namespace Pattern
     {
+        struct PatternMatch
+        {
+            duint addr;
+            int pattern; //index in the pattern list
+        };
+
         SCRIPT_EXPORT duint Find(unsigned char* data, duint datasize, const char* pattern);
         SCRIPT_EXPORT duint FindMem(duint start, duint size, const char* pattern);
         SCRIPT_EXPORT void Write(unsigned char* data, duint datasize, const char* pattern);
         SCRIPT_EXPORT void WriteMem(duint start, duint size, const char* pattern);
         SCRIPT_EXPORT bool SearchAndReplace(unsigned char* data, duint datasize, const char* searchpattern, const char* replacepattern);
         SCRIPT_EXPORT bool SearchAndReplaceMem(duint start, duint size, const char* searchpattern, const char* replacepattern);
+        SCRIPT_EXPORT bool FindAllMulti(const char* scope, const char** patterns, int count, duint maxresults, ListOf(PatternMatch) matches); //scope: "modules", "mem" or "mod1;mod2", caller has the responsibility to free the list
     };
 };
 
@@ -1,15 +1,60 @@
 #include "analysis.h"
 #include "memory.h"
 
-Analysis::Analysis(duint base, duint size)
+Analysis::Analysis(duint base, duint size, bool lazy)
 {
     mBase = base;
     mSize = size;
-    mData = new unsigned char[mSize + MAX_DISASM_BUFFER];
-    MemRead(mBase, mData, mSize);
+    if(lazy)
+        mData = nullptr;
+    else
+    {
+        mData = new unsigned char[mSize + MAX_DISASM_BUFFER];
+        MemRead(mBase, mData, mSize);
+    }
 }
 
 Analysis::~Analysis()
 {
     delete[] mData;
+}
+
+const unsigned char* Analysis::translatePage(duint addr) const
+{
+    auto page = addr & ~duint(LazyPageSize - 1);
+    auto found = mPages.find(page);
+    if(found == mPages.end())
+    {
+        // Every page carries the start of the next one so an instruction crossing the boundary can be disassembled
+        auto start = max(page, mBase);
+        auto size = min(page + LazyPageSize + MAX_DISASM_BUFFER, mBase + mSize) - start;
+        std::unique_ptr<unsigned char[]> data(new unsigned char[LazyPageSize + MAX_DISASM_BUFFER]());
+        MemRead(start, data.get() + (start - page), size);
+        found = mPages.emplace(page, std::move(data)).first;
+    }
+    return found->second.get() + (addr - page);
+}
+
+// Reads the pages of a range in one go, used when the range of a function is already known
+void Analysis::Prefetch(duint start, duint end) const
+{
+    if(mData || !inRange(start) || !inRange(end) || end < start)
+        return;
+    auto first = start & ~duint(LazyPageSize - 1);
+    auto last = end & ~duint(LazyPageSize - 1);
+    auto count = (last - first) / LazyPageSize + 1;
+    std::vector<unsigned char> data(count * LazyPageSize + MAX_DISASM_BUFFER);
+    auto readStart = max(first, mBase);
+    auto readEnd = min(last + LazyPageSize + MAX_DISASM_BUFFER, mBase + mSize);
+    if(!MemRead(readStart, data.data() + (readStart - first), readEnd - readStart))
+        return; //leave it to the page reads
+    for(duint i = 0; i < count; i++)
+    {
+        auto page = first + i * LazyPageSize;
+        if(mPages.count(page))
+            continue;
+        std::unique_ptr<unsigned char[]> pageData(new unsigned char[LazyPageSize + MAX_DISASM_BUFFER]);
+        memcpy(pageData.get(), data.data() + i * LazyPageSize, LazyPageSize + MAX_DISASM_BUFFER);
+        mPages.emplace(page, std::move(pageData));
+    }
 }
\ No newline at end of file
@@ -3,15 +3,18 @@
 
 #include "_global.h"
 #include <capstone_wrapper.h>
+#include <unordered_map>
+#include <memory>
 
 class Analysis
 {
 public:
-    explicit Analysis(duint base, duint size);
+    explicit Analysis(duint base, duint size, bool lazy = false);
     Analysis(const Analysis & that) = delete;
     virtual ~Analysis();
     virtual void Analyse() = 0;
     virtual void SetMarkers() = 0;
+    void Prefetch(duint start, duint end) const;
 
 protected:
     duint mBase;
@@ -26,8 +29,21 @@ protected:
 
     const unsigned char* translateAddr(duint addr) const
     {
-        return inRange(addr) ? mData + (addr - mBase) : nullptr;
+        if(!inRange(addr))
+            return nullptr;
+        return mData ? mData + (addr - mBase) : translatePage(addr);
     }
+
+private:
+    // In lazy mode memory is read one page at a time when the analysis first touches it
+    enum
+    {
+        LazyPageSize = 0x1000
+    };
+
+    mutable std::unordered_map<duint, std::unique_ptr<unsigned char[]>> mPages;
+
+    const unsigned char* translatePage(duint addr) const;
 };
 
 #endif //_ANALYSIS_H
\ No newline at end of file
@@ -5,8 +5,8 @@
 #include "function.h"
 #include "xrefs.h"
 
-RecursiveAnalysis::RecursiveAnalysis(duint base, duint size, duint entryPoint, duint maxDepth, bool dump)
-    : Analysis(base, size),
+RecursiveAnalysis::RecursiveAnalysis(duint base, duint size, duint entryPoint, duint maxDepth, bool dump, bool lazy)
+    : Analysis(base, size, lazy),
       mEntryPoint(entryPoint),
       mMaxDepth(maxDepth),
       mDump(dump)
@@ -5,7 +5,7 @@
 class RecursiveAnalysis : public Analysis
 {
 public:
-    explicit RecursiveAnalysis(duint base, duint size, duint entryPoint, duint maxDepth, bool dump = false);
+    explicit RecursiveAnalysis(duint base, duint size, duint entryPoint, duint maxDepth, bool dump = false, bool lazy = false);
     void Analyse() override;
     void SetMarkers() override;
 
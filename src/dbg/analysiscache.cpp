@@ -0,0 +1,182 @@
+/**
+@file analysiscache.cpp
+
+@brief Implements an on-disk cache of automatic analysis results, keyed by the content hash of the module image.
+*/
+
+#include "analysiscache.h"
+#include "lz4\lz4.h"
+#include "console.h"
+#include "module.h"
+#include "function.h"
+#include "argument.h"
+#include "loop.h"
+#include "xrefs.h"
+#include "encodemap.h"
+#include "filehelper.h"
+#include "hashing.h"
+#include "threading.h"
+
+/**
+\brief Directory where the analysis cache files are stored (usually in \db\analysis). UTF-8 encoding.
+*/
+static char cachepath[deflen];
+
+struct AnalysisCacheHeader
+{
+    char magic[4]; // "XAC1"
+    unsigned int version;
+    unsigned int rawSize;
+    unsigned int compressedSize;
+};
+
+void AnalysisCacheSetPath(const char* Directory)
+{
+    sprintf_s(cachepath, "%s\\analysis", Directory);
+    if(!CreateDirectoryW(StringUtils::Utf8ToUtf16(cachepath).c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+        *cachepath = '\0';
+}
+
+bool AnalysisCacheEnabled()
+{
+    return *cachepath && !settingboolget("Engine", "DisableAnalysisCache");
+}
+
+void AnalysisCacheHashImage(const void* Data, duint Size, unsigned long long Hash[2])
+{
+    // The seed includes the analysis version so stale results never match
+    Hash128(Data, size_t(Size), 0x1337 + ANALYSIS_CACHE_VERSION, Hash);
+}
+
+static bool getCacheFile(duint Base, const char* cacheType, String & fileName, String & moduleName)
+{
+    SHARED_ACQUIRE(LockModules);
+    auto info = ModInfoFromAddr(Base);
+    if(!info || (!info->imageHash[0] && !info->imageHash[1]))
+        return false;
+    fileName = StringUtils::sprintf("%s\\%016llX%016llX.%s", cachepath, info->imageHash[0], info->imageHash[1], cacheType);
+    moduleName = String(info->name) + info->extension;
+    return true;
+}
+
+#ifdef _WIN64
+#define ANALYSIS_CACHE_TYPE "ac64"
+#else
+#define ANALYSIS_CACHE_TYPE "ac32"
+#endif // _WIN64
+
+/**
+\brief Gets the name of a cache file of the module image, for other caches that are keyed by the image hash.
+\param Base The module base.
+\param Extension The file extension of the cache type.
+\param [out] FileName The full path of the cache file.
+\return false if the cache is disabled or the module was not hashed.
+*/
+bool AnalysisCacheFileName(duint Base, const char* Extension, String & FileName)
+{
+    if(!AnalysisCacheEnabled())
+        return false;
+    ModPipelineWait(Base);
+    String moduleName;
+    return getCacheFile(Base, Extension, FileName, moduleName);
+}
+
+/**
+\brief Stores the automatic analysis results of the module containing an address.
+\param Address An address inside the module.
+\return true if the cache file was written.
+*/
+bool AnalysisCacheSave(duint Address)
+{
+    if(!AnalysisCacheEnabled())
+        return false;
+    duint base = ModBaseFromAddr(Address);
+    if(!base)
+        return false;
+
+    // The cached results have to be merged before they are written back
+    ModPipelineWait(base);
+    String fileName, moduleName;
+    if(!getCacheFile(base, ANALYSIS_CACHE_TYPE, fileName, moduleName))
+        return false;
+
+    JSON root = json_object();
+    FunctionCacheSaveModule(root, moduleName.c_str());
+    ArgumentCacheSaveModule(root, moduleName.c_str());
+    LoopCacheSaveModule(root, moduleName.c_str());
+    XrefCacheSaveModule(root, moduleName.c_str());
+    EncodeMapCacheSaveModule(root, moduleName.c_str());
+    if(!json_object_size(root))
+    {
+        json_decref(root);
+        return false;
+    }
+    json_object_set_new(root, "version", json_integer(ANALYSIS_CACHE_VERSION));
+
+    char* jsonText = json_dumps(root, JSON_COMPACT);
+    json_decref(root);
+    if(!jsonText)
+        return false;
+    int rawSize = int(strlen(jsonText));
+    std::vector<char> data(sizeof(AnalysisCacheHeader) + LZ4_compressBound(rawSize));
+    auto header = (AnalysisCacheHeader*)data.data();
+    memcpy(header->magic, "XAC1", sizeof(header->magic));
+    header->version = ANALYSIS_CACHE_VERSION;
+    header->rawSize = rawSize;
+    header->compressedSize = LZ4_compress(jsonText, data.data() + sizeof(AnalysisCacheHeader), rawSize);
+    json_free(jsonText);
+    if(!header->compressedSize)
+        return false;
+    return FileHelper::WriteAllData(fileName, data.data(), sizeof(AnalysisCacheHeader) + header->compressedSize);
+}
+
+/**
+\brief Merges cached analysis results into the database, existing entries are kept.
+\param Base The module base.
+\return true if a matching cache file was loaded.
+*/
+bool AnalysisCacheLoad(duint Base)
+{
+    if(!AnalysisCacheEnabled())
+        return false;
+    String fileName, moduleName;
+    if(!getCacheFile(Base, ANALYSIS_CACHE_TYPE, fileName, moduleName) || !FileExists(fileName.c_str()))
+        return false;
+
+    std::vector<unsigned char> data;
+    if(!FileHelper::ReadAllData(fileName, data) || data.size() < sizeof(AnalysisCacheHeader))
+        return false;
+    auto header = (const AnalysisCacheHeader*)data.data();
+    if(memcmp(header->magic, "XAC1", sizeof(header->magic)) || header->version != ANALYSIS_CACHE_VERSION || header->compressedSize > data.size() - sizeof(AnalysisCacheHeader))
+        return false;
+    String jsonText;
+    jsonText.resize(header->rawSize);
+    if(LZ4_decompress_safe((const char*)data.data() + sizeof(AnalysisCacheHeader), &jsonText[0], header->compressedSize, header->rawSize) != int(header->rawSize))
+    {
+        dprintf("Corrupted analysis cache file %s\n", fileName.c_str());
+        return false;
+    }
+
+    JSON root = json_loads(jsonText.c_str(), 0, 0);
+    if(!root)
+        return false;
+
+    // The cached image may have been loaded under a different file name, entries are keyed by module name
+    const char* keys[] = { "functions", "arguments", "autoloops", "xrefs", "encodemaps" };
+    for(auto key : keys)
+    {
+        size_t i;
+        JSON value;
+        JSON values = json_object_get(root, key);
+        json_array_foreach(values, i, value)
+            json_object_set_new(value, "module", json_string(moduleName.c_str()));
+    }
+
+    FunctionCacheMerge(root);
+    ArgumentCacheMerge(root);
+    LoopCacheMerge(root);
+    XrefCacheMerge(root);
+    EncodeMapCacheMerge(root);
+    json_decref(root);
+    return true;
+}
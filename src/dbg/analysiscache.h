@@ -0,0 +1,16 @@
+#ifndef _ANALYSISCACHE_H
+#define _ANALYSISCACHE_H
+
+#include "_global.h"
+
+// Bump when the output of the analysis passes changes, old cache files are then ignored
+#define ANALYSIS_CACHE_VERSION 1
+
+void AnalysisCacheSetPath(const char* Directory);
+bool AnalysisCacheEnabled();
+void AnalysisCacheHashImage(const void* Data, duint Size, unsigned long long Hash[2]);
+bool AnalysisCacheSave(duint Address);
+bool AnalysisCacheLoad(duint Base);
+bool AnalysisCacheFileName(duint Base, const char* Extension, String & FileName);
+
+#endif // _ANALYSISCACHE_H
@@ -143,6 +143,24 @@ void ArgumentCacheLoad(JSON Root)
     arguments.CacheLoad(Root);
 }
 
+unsigned int ArgumentCacheRevision()
+{
+    return arguments.Revision();
+}
+
+void ArgumentCacheSaveModule(JSON Root, const char* Module)
+{
+    arguments.CacheSaveWhere(Root, [Module](const ARGUMENTSINFO & value)
+    {
+        return !value.manual && !_stricmp(value.mod, Module);
+    });
+}
+
+void ArgumentCacheMerge(JSON Root)
+{
+    arguments.CacheMerge(Root);
+}
+
 void ArgumentClear()
 {
     arguments.Clear();
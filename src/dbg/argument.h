@@ -19,6 +19,9 @@ bool ArgumentDelete(duint Address);
 void ArgumentDelRange(duint Start, duint End, bool DeleteManual = false);
 void ArgumentCacheSave(JSON Root);
 void ArgumentCacheLoad(JSON Root);
+unsigned int ArgumentCacheRevision();
+void ArgumentCacheSaveModule(JSON Root, const char* Module);
+void ArgumentCacheMerge(JSON Root);
 void ArgumentClear();
 void ArgumentGetList(std::vector<ARGUMENTSINFO> & list);
 bool ArgumentGetInfo(duint Address, ARGUMENTSINFO & info);
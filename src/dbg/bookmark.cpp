@@ -53,6 +53,11 @@ void BookmarkCacheLoad(JSON Root)
     bookmarks.CacheLoad(Root, false, "auto"); //legacy support
 }
 
+unsigned int BookmarkCacheRevision()
+{
+    return bookmarks.Revision();
+}
+
 bool BookmarkEnum(BOOKMARKSINFO* List, size_t* Size)
 {
     return bookmarks.Enum(List, Size);
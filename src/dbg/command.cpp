@@ -10,9 +10,45 @@
 #include "commandparser.h"
 #include "expressionparser.h"
 #include "variable.h"
+#include "threading.h"
 
 COMMAND* cmd_list = 0;
 
+static unsigned int cmd_version = 0;
+
+/**
+\brief Case-insensitive index of every command name and alias. Plugins add and remove commands from their own threads, so the index and the list are only used with LockCommands held.
+*/
+static std::unordered_map<String, COMMAND*> cmd_index;
+
+static void cmdindexadd(COMMAND* cmd)
+{
+    for(const auto & alias : StringUtils::Split(cmd->name, '\1'))
+        cmd_index.insert({ StringUtils::ToLower(alias), cmd }); //the first command with an alias keeps it
+}
+
+static void cmdindexrebuild()
+{
+    cmd_index.clear();
+    for(COMMAND* cur = cmd_list; cur && cur->name; cur = cur->next)
+        cmdindexadd(cur);
+}
+
+static COMMAND* cmdfindnolock(const char* name, COMMAND** link)
+{
+    auto found = cmd_index.find(StringUtils::ToLower(name));
+    if(found == cmd_index.end())
+        return 0;
+    if(link) //the previous list entry is only needed to unlink the command
+    {
+        COMMAND* prev = 0;
+        for(COMMAND* cur = cmd_list; cur != found->second; cur = cur->next)
+            prev = cur;
+        *link = prev;
+    }
+    return found->second;
+}
+
 /**
 \brief Finds a ::COMMAND in a command list.
 \param [in] command list.
@@ -22,22 +58,8 @@ COMMAND* cmd_list = 0;
 */
 COMMAND* cmdfind(const char* name, COMMAND** link)
 {
-    COMMAND* cur = cmd_list;
-    if(!cur->name)
-        return 0;
-    COMMAND* prev = 0;
-    while(cur)
-    {
-        if(arraycontains(cur->name, name))
-        {
-            if(link)
-                *link = prev;
-            return cur;
-        }
-        prev = cur;
-        cur = cur->next;
-    }
-    return 0;
+    SHARED_ACQUIRE(LockCommands);
+    return cmdfindnolock(name, link);
 }
 
 /**
@@ -57,6 +79,8 @@ COMMAND* cmdinit()
 */
 void cmdfree()
 {
+    EXCLUSIVE_ACQUIRE(LockCommands);
+    cmd_index.clear();
     COMMAND* cur = cmd_list;
     while(cur)
     {
@@ -77,7 +101,8 @@ void cmdfree()
 */
 bool cmdnew(const char* name, CBCOMMAND cbCommand, bool debugonly)
 {
-    if(!cmd_list || !cbCommand || !name || !*name || cmdfind(name, 0))
+    EXCLUSIVE_ACQUIRE(LockCommands);
+    if(!cmd_list || !cbCommand || !name || !*name || cmdfindnolock(name, 0))
         return false;
     COMMAND* cmd;
     bool nonext = false;
@@ -93,6 +118,7 @@ bool cmdnew(const char* name, CBCOMMAND cbCommand, bool debugonly)
     strcpy(cmd->name, name);
     cmd->cbCommand = cbCommand;
     cmd->debugonly = debugonly;
+    cmd_version++;
     COMMAND* cur = cmd_list;
     if(!nonext)
     {
@@ -100,6 +126,7 @@ bool cmdnew(const char* name, CBCOMMAND cbCommand, bool debugonly)
             cur = cur->next;
         cur->next = cmd;
     }
+    cmdindexadd(cmd);
     return true;
 }
 
@@ -136,12 +163,14 @@ CBCOMMAND cmdset(const char* name, CBCOMMAND cbCommand, bool debugonly)
 {
     if(!cbCommand)
         return 0;
-    COMMAND* found = cmdfind(name, 0);
+    EXCLUSIVE_ACQUIRE(LockCommands);
+    COMMAND* found = cmdfindnolock(name, 0);
     if(!found)
         return 0;
     CBCOMMAND old = found->cbCommand;
     found->cbCommand = cbCommand;
     found->debugonly = debugonly;
+    cmd_version++;
     return old;
 }
 
@@ -153,10 +182,12 @@ CBCOMMAND cmdset(const char* name, CBCOMMAND cbCommand, bool debugonly)
 */
 bool cmddel(const char* name)
 {
+    EXCLUSIVE_ACQUIRE(LockCommands);
     COMMAND* prev = 0;
-    COMMAND* found = cmdfind(name, &prev);
+    COMMAND* found = cmdfindnolock(name, &prev);
     if(!found)
         return false;
+    cmd_version++;
     efree(found->name, "cmddel:found->name");
     if(found == cmd_list)
     {
@@ -175,9 +206,104 @@ bool cmddel(const char* name)
         prev->next = found->next;
         efree(found, "cmddel:found");
     }
+    cmdindexrebuild(); //entries move and hidden aliases of other commands become visible
+    return true;
+}
+
+/**
+\brief Gets a number that changes whenever a command is added, changed or removed, so resolved ::COMMAND pointers can be cached.
+\return The command list version.
+*/
+unsigned int cmdversion()
+{
+    return cmd_version;
+}
+
+/**
+\brief Splits the command line of an invocation into its arguments.
+*/
+static void cmdparseargs(CMDINVOCATION & invocation)
+{
+    Command parsed(invocation.command);
+    int argcount = parsed.GetArgCount();
+    invocation.args.clear();
+    invocation.args.reserve(argcount);
+    for(int i = 0; i < argcount; i++)
+        invocation.args.push_back(parsed.GetArg(i));
+}
+
+/**
+\brief Calls a command callback with the arguments of an invocation. Every argument gets its own deflen buffer
+       (callbacks may modify them), the buffers are only allocated on the first call.
+*/
+static CMDRESULT cmdcall(CBCOMMAND cbCommand, CMDINVOCATION & invocation)
+{
+    int argc = int(invocation.args.size()) + 1;
+    if(invocation.argbuffer.size() < size_t(argc) * deflen)
+        invocation.argbuffer.resize(size_t(argc) * deflen);
+    invocation.argv.resize(argc);
+    for(int i = 0; i < argc; i++)
+    {
+        invocation.argv[i] = invocation.argbuffer.data() + i * deflen;
+        strcpy_s(invocation.argv[i], deflen, i ? invocation.args[i - 1].c_str() : invocation.command.c_str());
+    }
+    return cbCommand(argc, invocation.argv.data());
+}
+
+static void cmdbind(CMDINVOCATION & invocation)
+{
+    invocation.version = cmd_version;
+    invocation.cmd = cmdget(invocation.command.c_str());
+    if(invocation.cmd && !invocation.cmd->cbCommand)
+        invocation.cmd = nullptr;
+    if(!invocation.cmd && !invocation.expression)
+        invocation.expression = std::make_shared<ExpressionParser>(invocation.command);
+}
+
+/**
+\brief Parses a command line once so it can be executed repeatedly with cmdinvoke.
+\param cmd The command line.
+\param [out] invocation The parsed command.
+\return false if the command line is empty.
+*/
+bool cmdprepare(const char* cmd, CMDINVOCATION & invocation)
+{
+    if(!cmd)
+        return false;
+    invocation.command = StringUtils::Trim(cmd);
+    if(invocation.command.empty())
+        return false;
+    if(invocation.command.length() >= deflen)
+        invocation.command.resize(deflen - 1);
+    cmdparseargs(invocation);
+    invocation.expression = nullptr;
+    cmdbind(invocation);
     return true;
 }
 
+/**
+\brief Executes a command line parsed by cmdprepare. The command is looked up again only when the command list changed.
+\param [in,out] invocation The parsed command.
+\return A CMDRESULT.
+*/
+CMDRESULT cmdinvoke(CMDINVOCATION & invocation)
+{
+    if(invocation.version != cmd_version)
+        cmdbind(invocation);
+    if(!invocation.cmd)
+    {
+        duint result;
+        if(!invocation.expression->Calculate(result, valuesignedcalc(), true))
+            return STATUS_ERROR;
+        varset("$result", result, false);
+        varset("$ans", result, true);
+        return STATUS_CONTINUE;
+    }
+    if(invocation.cmd->debugonly && !DbgIsDebugging())
+        return STATUS_ERROR;
+    return cmdcall(invocation.cmd->cbCommand, invocation);
+}
+
 /*
 command_list:         command list
 cbUnknownCommand:     function to execute when an unknown command was found
@@ -200,6 +326,7 @@ CMDRESULT cmdloop(CBCOMMAND cbUnknownCommand, CBCOMMANDPROVIDER cbCommandProvide
     if(!cbUnknownCommand || !cbCommandProvider)
         return STATUS_ERROR;
     char command[deflen] = "";
+    CMDINVOCATION invocation; //reused so the argument buffers are only allocated once
     bool bLoop = true;
     while(bLoop)
     {
@@ -232,20 +359,9 @@ CMDRESULT cmdloop(CBCOMMAND cbUnknownCommand, CBCOMMANDPROVIDER cbCommandProvide
                 }
                 else
                 {
-                    Command commandParsed(command);
-                    int argcount = commandParsed.GetArgCount();
-                    char** argv = (char**)emalloc((argcount + 1) * sizeof(char*), "cmdloop:argv");
-                    argv[0] = command;
-                    for(int i = 0; i < argcount; i++)
-                    {
-                        argv[i + 1] = (char*)emalloc(deflen, "cmdloop:argv[i+1]");
-                        *argv[i + 1] = 0;
-                        strcpy_s(argv[i + 1], deflen, commandParsed.GetArg(i).c_str());
-                    }
-                    CMDRESULT res = cmd->cbCommand(argcount + 1, argv);
-                    for(int i = 0; i < argcount; i++)
-                        efree(argv[i + 1], "cmdloop:argv[i+1]");
-                    efree(argv, "cmdloop:argv");
+                    invocation.command = command;
+                    cmdparseargs(invocation);
+                    CMDRESULT res = cmdcall(cmd->cbCommand, invocation);
                     if((error_is_fatal && res == STATUS_ERROR) || res == STATUS_EXIT)
                         bLoop = false;
                 }
@@ -264,40 +380,8 @@ CMDRESULT cmdloop(CBCOMMAND cbUnknownCommand, CBCOMMANDPROVIDER cbCommandProvide
 CMDRESULT cmddirectexec(const char* cmd)
 {
     // Don't allow anyone to send in empty strings
-    if(!cmd)
+    CMDINVOCATION invocation;
+    if(!cmdprepare(cmd, invocation))
         return STATUS_ERROR;
-
-    char command[deflen];
-    strcpy_s(command, StringUtils::Trim(cmd).c_str());
-    if(!*command)
-        return STATUS_ERROR;
-
-    COMMAND* found = cmdget(command);
-    if(!found || !found->cbCommand)
-    {
-        ExpressionParser parser(command);
-        duint result;
-        if(!parser.Calculate(result, valuesignedcalc(), true))
-            return STATUS_ERROR;
-        varset("$result", result, false);
-        varset("$ans", result, true);
-        return STATUS_CONTINUE;
-    }
-    if(found->debugonly && !DbgIsDebugging())
-        return STATUS_ERROR;
-    Command cmdParsed(command);
-    int argcount = cmdParsed.GetArgCount();
-    char** argv = (char**)emalloc((argcount + 1) * sizeof(char*), "cmddirectexec:argv");
-    argv[0] = command;
-    for(int i = 0; i < argcount; i++)
-    {
-        argv[i + 1] = (char*)emalloc(deflen, "cmddirectexec:argv[i+1]");
-        *argv[i + 1] = 0;
-        strcpy_s(argv[i + 1], deflen, cmdParsed.GetArg(i).c_str());
-    }
-    CMDRESULT res = found->cbCommand(argcount + 1, argv);
-    for(int i = 0; i < argcount; i++)
-        efree(argv[i + 1], "cmddirectexec:argv[i+1]");
-    efree(argv, "cmddirectexec:argv");
-    return res;
+    return cmdinvoke(invocation);
 }
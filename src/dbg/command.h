@@ -2,10 +2,12 @@
 #define _COMMAND_H
 
 #include "_global.h"
+#include <memory>
 
 //typedefs
 
 struct COMMAND;
+class ExpressionParser;
 
 enum CMDRESULT
 {
@@ -27,6 +29,18 @@ struct COMMAND
     COMMAND* next;
 };
 
+//pre-parsed command line that can be executed repeatedly (see cmdprepare)
+struct CMDINVOCATION
+{
+    String command; //trimmed command line, passed as argv[0]
+    std::vector<String> args; //split arguments
+    unsigned int version; //cmdversion() the command was resolved against
+    COMMAND* cmd; //nullptr when the command line is an expression
+    std::shared_ptr<ExpressionParser> expression;
+    std::vector<char> argbuffer; //argument storage, reused between executions
+    std::vector<char*> argv;
+};
+
 //functions
 COMMAND* cmdinit();
 void cmdfree();
@@ -35,7 +49,10 @@ bool cmdnew(const char* name, CBCOMMAND cbCommand, bool debugonly);
 COMMAND* cmdget(const char* cmd);
 CBCOMMAND cmdset(const char* name, CBCOMMAND cbCommand, bool debugonly);
 bool cmddel(const char* name);
+unsigned int cmdversion();
 CMDRESULT cmdloop(CBCOMMAND cbUnknownCommand, CBCOMMANDPROVIDER cbCommandProvider, CBCOMMANDFINDER cbCommandFinder, bool error_is_fatal);
 CMDRESULT cmddirectexec(const char* cmd);
+bool cmdprepare(const char* cmd, CMDINVOCATION & invocation);
+CMDRESULT cmdinvoke(CMDINVOCATION & invocation);
 
 #endif // _COMMAND_H
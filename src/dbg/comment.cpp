@@ -78,6 +78,11 @@ void CommentCacheLoad(JSON Root)
     comments.CacheLoad(Root, false, "auto"); //legacy support
 }
 
+unsigned int CommentCacheRevision()
+{
+    return comments.Revision();
+}
+
 bool CommentEnum(COMMENTSINFO* List, size_t* Size)
 {
     return comments.Enum(List, Size);
@@ -15,6 +15,7 @@ bool CommentDelete(duint Address);
 void CommentDelRange(duint Start, duint End, bool Manual);
 void CommentCacheSave(JSON Root);
 void CommentCacheLoad(JSON Root);
+unsigned int CommentCacheRevision();
 bool CommentEnum(COMMENTSINFO* List, size_t* Size);
 void CommentClear();
 void CommentGetList(std::vector<COMMENTSINFO> & list);
@@ -4,6 +4,7 @@
 @brief Implements runtime database saving and loading.
 */
 
+#include "lz4\lz4.h"
 #include "lz4\lz4file.h"
 #include "console.h"
 #include "breakpoint.h"
@@ -23,6 +24,9 @@
 #include "encodemap.h"
 #include "plugin_loader.h"
 #include "argument.h"
+#include "handle.h"
+#include "murmurhash.h"
+#include <ppl.h>
 
 /**
 \brief Directory where program databases are stored (usually in \db). UTF-8 encoding.
@@ -34,111 +38,447 @@ char dbbasepath[deflen];
 */
 char dbpath[deflen];
 
-void DbSave(DbLoadSaveType saveType)
+/**
+\brief Binary database container. The file starts with a DbFileHeader, followed by
+       sectionCount pairs of DbSectionHeader and (optionally LZ4-compressed) compact JSON.
+*/
+#define DB_FILE_MAGIC "XDB1"
+#define DB_FILE_VERSION 1
+#define DB_SECTION_COMPRESSED 1
+
+struct DbFileHeader
 {
-    EXCLUSIVE_ACQUIRE(LockDatabase);
+    char magic[4];
+    unsigned int version;
+    unsigned int sectionCount;
+};
 
-    dputs("Saving database...");
-    DWORD ticks = GetTickCount();
-    JSON root = json_object();
+struct DbSectionHeader
+{
+    char name[16];
+    unsigned int flags;
+    unsigned int rawSize;
+    unsigned int storedSize;
+};
+
+static DbLoadSaveType pluginLoadSaveType; // only valid during the plugin callbacks
+
+static void notesSave(JSON Root)
+{
+    char* text = nullptr;
+    GuiGetDebuggeeNotes(&text);
+    if(text)
+    {
+        json_object_set_new(Root, "notes", json_string(text));
+        BridgeFree(text);
+    }
+}
+
+static void notesLoad(JSON Root)
+{
+    const char* text = json_string_value(json_object_get(Root, "notes"));
+    GuiSetDebuggeeNotes(text);
+}
+
+static int pluginloadsavetype()
+{
+    switch(pluginLoadSaveType)
+    {
+    case DbLoadSaveType::DebugData:
+        return PLUG_DB_LOADSAVE_DATA;
+    case DbLoadSaveType::All:
+        return PLUG_DB_LOADSAVE_ALL;
+    default:
+        return 0;
+    }
+}
+
+static void pluginsSave(JSON Root)
+{
+    PLUG_CB_LOADSAVEDB pluginSaveDb;
+    // Some plugins may wish to change this value so that all plugins after his or her plugin will save data into plugin-supplied storage instead of the system's.
+    // We back up this value so that the debugger is not fooled by such plugins.
+    JSON pluginRoot = json_object();
+    pluginSaveDb.root = pluginRoot;
+    pluginSaveDb.loadSaveType = pluginloadsavetype();
+    plugincbcall(CBTYPE::CB_SAVEDB, &pluginSaveDb);
+    if(json_object_size(pluginRoot))
+        json_object_set(Root, "plugins", pluginRoot);
+    json_decref(pluginRoot);
+}
 
-    // Save only command line
-    if(saveType == DbLoadSaveType::CommandLine || saveType == DbLoadSaveType::All)
+static void pluginsLoad(JSON Root)
+{
+    JSON pluginRoot = json_object_get(Root, "plugins");
+    if(pluginRoot)
     {
-        CmdLineCacheSave(root);
+        PLUG_CB_LOADSAVEDB pluginLoadDb;
+        pluginLoadDb.root = pluginRoot;
+        pluginLoadDb.loadSaveType = pluginloadsavetype();
+        plugincbcall(CB_LOADDB, &pluginLoadDb);
     }
+}
 
-    if(saveType == DbLoadSaveType::DebugData || saveType == DbLoadSaveType::All)
+typedef void(*DBSECTIONCALLBACK)(JSON Root);
+typedef unsigned int(*DBREVISIONCALLBACK)();
+
+struct DbSectionInfo
+{
+    const char* name;
+    DbLoadSaveType type;
+    DBSECTIONCALLBACK save;
+    DBSECTIONCALLBACK load;
+    DBREVISIONCALLBACK revision; // nullptr when changes are not tracked (the serialized content is compared instead)
+    bool serial; // save must run on the calling thread (GUI and plugin callbacks)
+};
+
+// The order of this table is the order in which sections are loaded
+static const DbSectionInfo dbSections[] =
+{
+    { "commandline", DbLoadSaveType::CommandLine, CmdLineCacheSave, CmdLineCacheLoad, nullptr, false },
+    { "comments", DbLoadSaveType::DebugData, CommentCacheSave, CommentCacheLoad, CommentCacheRevision, false },
+    { "labels", DbLoadSaveType::DebugData, LabelCacheSave, LabelCacheLoad, LabelCacheRevision, false },
+    { "bookmarks", DbLoadSaveType::DebugData, BookmarkCacheSave, BookmarkCacheLoad, BookmarkCacheRevision, false },
+    { "functions", DbLoadSaveType::DebugData, FunctionCacheSave, FunctionCacheLoad, FunctionCacheRevision, false },
+    { "arguments", DbLoadSaveType::DebugData, ArgumentCacheSave, ArgumentCacheLoad, ArgumentCacheRevision, false },
+    { "loops", DbLoadSaveType::DebugData, LoopCacheSave, LoopCacheLoad, LoopCacheRevision, false },
+    { "xrefs", DbLoadSaveType::DebugData, XrefCacheSave, XrefCacheLoad, XrefCacheRevision, false },
+    { "encodemaps", DbLoadSaveType::DebugData, EncodeMapCacheSave, EncodeMapCacheLoad, EncodeMapCacheRevision, false },
+    { "tracerecord", DbLoadSaveType::DebugData, [](JSON Root) { TraceRecord.saveToDb(Root); }, [](JSON Root) { TraceRecord.loadFromDb(Root); }, nullptr, false },
+    { "breakpoints", DbLoadSaveType::DebugData, BpCacheSave, BpCacheLoad, nullptr, false },
+    { "watches", DbLoadSaveType::DebugData, WatchCacheSave, WatchCacheLoad, nullptr, false },
+    { "notes", DbLoadSaveType::DebugData, notesSave, notesLoad, nullptr, true },
+    { "plugins", DbLoadSaveType::DebugData, pluginsSave, pluginsLoad, nullptr, true },
+};
+
+/**
+\brief State of the database file on disk. While it is valid, changed sections are appended to the
+       file (a later section replaces an earlier one with the same name) instead of rewriting it.
+*/
+struct DbJournal
+{
+    bool valid;
+    unsigned int sectionCount; // sections in the file, including replaced ones
+    unsigned long long fileSize;
+    unsigned long long checkpointSize; // file size after the last full save
+    struct
     {
-        CommentCacheSave(root);
-        LabelCacheSave(root);
-        BookmarkCacheSave(root);
-        FunctionCacheSave(root);
-        ArgumentCacheSave(root);
-        LoopCacheSave(root);
-        XrefCacheSave(root);
-        EncodeMapCacheSave(root);
-        TraceRecord.saveToDb(root);
-        BpCacheSave(root);
-        WatchCacheSave(root);
-
-        //save notes
-        char* text = nullptr;
-        GuiGetDebuggeeNotes(&text);
-        if(text)
+        bool revisionValid;
+        unsigned int revision;
+        bool hashValid;
+        unsigned long long hash; // hash of the serialized JSON
+    } sections[_countof(dbSections)];
+};
+
+static DbJournal dbjournal;
+
+static bool dbsectionselected(const DbSectionInfo & section, DbLoadSaveType type)
+{
+    return type == DbLoadSaveType::All || section.type == type;
+}
+
+struct DbSectionData
+{
+    size_t index;
+    JSON root;
+    unsigned int revision;
+    unsigned long long hash;
+    DbSectionHeader header;
+    std::vector<char> data;
+};
+
+/**
+\brief Serializes the selected subsystems, each into its own section root.
+       Notes and plugin data go through the GUI and plugin callbacks and are gathered on this thread,
+       the other subsystems are serialized in parallel.
+\param onlyChanged Skip subsystems whose revision did not change since the last save.
+*/
+static void dbcollectsections(DbLoadSaveType saveType, std::vector<DbSectionData> & sections, bool onlyChanged)
+{
+    sections.clear();
+    sections.reserve(_countof(dbSections));
+    for(size_t i = 0; i < _countof(dbSections); i++)
+    {
+        const auto & info = dbSections[i];
+        if(!dbsectionselected(info, saveType))
+            continue;
+        DbSectionData section;
+        section.index = i;
+        section.revision = info.revision ? info.revision() : 0;
+        const auto & saved = dbjournal.sections[i];
+        if(onlyChanged && info.revision && saved.revisionValid && saved.revision == section.revision)
+            continue;
+        section.root = json_object();
+        section.hash = 0;
+        memset(&section.header, 0, sizeof(section.header));
+        strncpy_s(section.header.name, info.name, _TRUNCATE);
+        sections.push_back(section);
+    }
+
+    pluginLoadSaveType = saveType;
+    for(auto & section : sections)
+        if(dbSections[section.index].serial)
+            dbSections[section.index].save(section.root);
+
+    concurrency::parallel_for(size_t(0), sections.size(), [&](size_t i)
+    {
+        auto & section = sections[i];
+        if(!dbSections[section.index].serial)
+            dbSections[section.index].save(section.root);
+    });
+}
+
+/**
+\brief Writes sections to the database file.
+\param append Append to the existing file (journal) instead of replacing it.
+\return true on success, the journal is updated accordingly.
+*/
+static bool dbwritesections(const std::vector<DbSectionData> & sections, bool append)
+{
+    DbFileHeader fileHeader;
+    memcpy(fileHeader.magic, DB_FILE_MAGIC, sizeof(fileHeader.magic));
+    fileHeader.version = DB_FILE_VERSION;
+    fileHeader.sectionCount = append ? dbjournal.sectionCount : 0;
+    unsigned long long fileSize = append ? dbjournal.fileSize : sizeof(fileHeader);
+
+    auto wdbpath = StringUtils::Utf8ToUtf16(dbpath);
+    auto wfilepath = append ? wdbpath : wdbpath + L".tmp";
+    bool success;
+    {
+        Handle hFile = CreateFileW(wfilepath.c_str(), GENERIC_WRITE, 0, nullptr, append ? OPEN_EXISTING : CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        DWORD written = 0;
+        LARGE_INTEGER offset;
+        offset.QuadPart = fileSize;
+        // A new file gets its header at the end, when the section count is known
+        success = !!hFile && SetFilePointerEx(hFile, offset, nullptr, FILE_BEGIN);
+        for(size_t i = 0; success && i < sections.size(); i++)
         {
-            json_object_set_new(root, "notes", json_string(text));
-            BridgeFree(text);
+            const auto & section = sections[i];
+            if(!section.header.storedSize)
+                continue;
+            success = WriteFile(hFile, &section.header, sizeof(section.header), &written, nullptr) &&
+                      WriteFile(hFile, section.data.data(), section.header.storedSize, &written, nullptr);
+            fileHeader.sectionCount++;
+            fileSize += sizeof(section.header) + section.header.storedSize;
         }
+        // Updating the header commits the appended sections, an interrupted append leaves trailing data that is ignored
+        offset.QuadPart = 0;
+        success = success && SetEndOfFile(hFile) && SetFilePointerEx(hFile, offset, nullptr, FILE_BEGIN) &&
+                  WriteFile(hFile, &fileHeader, sizeof(fileHeader), &written, nullptr);
+    }
+    if(!append && (!success || !MoveFileExW(wfilepath.c_str(), wdbpath.c_str(), MOVEFILE_REPLACE_EXISTING)))
+    {
+        DeleteFileW(wfilepath.c_str());
+        success = false;
+    }
 
-        //plugin data
-        PLUG_CB_LOADSAVEDB pluginSaveDb;
-        // Some plugins may wish to change this value so that all plugins after his or her plugin will save data into plugin-supplied storage instead of the system's.
-        // We back up this value so that the debugger is not fooled by such plugins.
-        JSON pluginRoot = json_object();
-        pluginSaveDb.root = pluginRoot;
-        switch(saveType)
+    if(!success)
+    {
+        dbjournal.valid = false;
+        return false;
+    }
+    dbjournal.valid = true;
+    dbjournal.sectionCount = fileHeader.sectionCount;
+    dbjournal.fileSize = fileSize;
+    if(!append)
+        dbjournal.checkpointSize = fileSize;
+    for(const auto & section : sections)
+    {
+        auto & saved = dbjournal.sections[section.index];
+        saved.revisionValid = dbSections[section.index].revision != nullptr;
+        saved.revision = section.revision;
+        saved.hashValid = true;
+        saved.hash = section.hash;
+    }
+    return true;
+}
+
+/**
+\brief Saves the database in the binary container format. Sections are serialized and
+       compressed in parallel. When the file on disk is known, only changed sections are
+       appended to it; a full save (checkpoint) rewrites the file once the appended data
+       outgrows the last checkpoint.
+*/
+void DbSave(DbLoadSaveType saveType)
+{
+    EXCLUSIVE_ACQUIRE(LockDatabase);
+
+    dputs("Saving database...");
+    DWORD ticks = GetTickCount();
+
+    bool append = saveType == DbLoadSaveType::All && dbjournal.valid &&
+                  dbjournal.fileSize - dbjournal.checkpointSize < max(dbjournal.checkpointSize, 0x10000ull) &&
+                  !settingboolget("Engine", "DisableIncrementalDatabase");
+
+    std::vector<DbSectionData> sections;
+    dbcollectsections(saveType, sections, append);
+
+    bool useCompression = !settingboolget("Engine", "DisableDatabaseCompression");
+    concurrency::parallel_for(size_t(0), sections.size(), [&](size_t i)
+    {
+        auto & section = sections[i];
+        char* jsonText = json_dumps(section.root, JSON_COMPACT);
+        json_decref(section.root);
+        section.root = nullptr;
+        if(!jsonText)
+            return;
+        int rawSize = int(strlen(jsonText));
+        section.hash = murmurhash(jsonText, rawSize);
+        const auto & saved = dbjournal.sections[section.index];
+        // Empty sections are left out of a full save, but must be appended to replace older content
+        bool write = append ? !saved.hashValid || saved.hash != section.hash : rawSize > 2;
+        if(write)
         {
-        case DbLoadSaveType::DebugData:
-            pluginSaveDb.loadSaveType = PLUG_DB_LOADSAVE_DATA;
-            break;
-        case DbLoadSaveType::All:
-            pluginSaveDb.loadSaveType = PLUG_DB_LOADSAVE_ALL;
-            break;
-        default:
-            pluginSaveDb.loadSaveType = 0;
-            break;
+            section.header.rawSize = rawSize;
+            if(useCompression)
+            {
+                section.data.resize(LZ4_compressBound(rawSize));
+                int compressedSize = LZ4_compress(jsonText, section.data.data(), rawSize);
+                if(compressedSize > 0)
+                {
+                    section.header.flags |= DB_SECTION_COMPRESSED;
+                    section.data.resize(compressedSize);
+                }
+            }
+            if(!(section.header.flags & DB_SECTION_COMPRESSED))
+                section.data.assign(jsonText, jsonText + rawSize);
+            section.header.storedSize = (unsigned int)section.data.size();
         }
-        plugincbcall(CBTYPE::CB_SAVEDB, &pluginSaveDb);
-        if(json_object_size(pluginRoot))
-            json_object_set(root, "plugins", pluginRoot);
-        json_decref(pluginRoot);
+        json_free(jsonText);
+    });
+
+    const auto emptyHash = murmurhash("{}", 2);
+    bool empty = true;
+    bool changed = false;
+    for(const auto & section : sections)
+    {
+        if(section.header.storedSize)
+            changed = true;
+        if(section.hash != emptyHash)
+            empty = false;
     }
 
     auto wdbpath = StringUtils::Utf8ToUtf16(dbpath);
-    CopyFileW(wdbpath.c_str(), (wdbpath + L".bak").c_str(), FALSE); //make a backup
-    if(json_object_size(root))
+    if(append)
     {
-        char* jsonText = json_dumps(root, JSON_INDENT(1));
-
-        if(jsonText)
+        if(changed && !dbwritesections(sections, true))
+            dputs("\nFailed to append to database file!");
+    }
+    else
+    {
+        CopyFileW(wdbpath.c_str(), (wdbpath + L".bak").c_str(), FALSE); //make a backup
+        if(!empty)
         {
-            // Dump JSON to disk (overwrite any old files)
-            if(!FileHelper::WriteAllText(dbpath, jsonText))
+            if(!dbwritesections(sections, false))
             {
                 dputs("\nFailed to write database file!");
-                json_free(jsonText);
-                json_decref(root);
                 return;
             }
-
-            json_free(jsonText);
         }
-
-        if(!settingboolget("Engine", "DisableDatabaseCompression"))
-            LZ4_compress_fileW(wdbpath.c_str(), wdbpath.c_str());
+        else //remove database when nothing is in there
+        {
+            DeleteFileW(wdbpath.c_str());
+            dbjournal.valid = false;
+        }
     }
-    else //remove database when nothing is in there
-        DeleteFileW(wdbpath.c_str());
 
     dprintf("%ums\n", GetTickCount() - ticks);
-    json_decref(root); //free root
 }
 
-void DbLoad(DbLoadSaveType loadType)
+/**
+\brief Exports the whole database as indented JSON (the original text format, which DbLoad still accepts).
+\param FileName Path of the file to write. UTF-8 encoding.
+\return true if the file was written.
+*/
+bool DbExportJson(const char* FileName)
 {
     EXCLUSIVE_ACQUIRE(LockDatabase);
 
-    // If the file doesn't exist, there is no DB to load
-    if(!FileExists(dbpath))
-        return;
+    std::vector<DbSectionData> sections;
+    dbcollectsections(DbLoadSaveType::All, sections, false);
+    JSON root = json_object();
+    for(auto & section : sections)
+    {
+        json_object_update(root, section.root);
+        json_decref(section.root);
+    }
 
-    if(loadType == DbLoadSaveType::CommandLine)
-        dputs("Loading commandline...");
-    else
-        dprintf("Loading database...");
-    DWORD ticks = GetTickCount();
+    bool result = false;
+    char* jsonText = json_dumps(root, JSON_INDENT(1));
+    if(jsonText)
+    {
+        result = FileHelper::WriteAllText(FileName, jsonText);
+        json_free(jsonText);
+    }
+    json_decref(root);
+    return result;
+}
+
+/**
+\brief Splits a binary database container into per-section JSON roots, decompressing and parsing sections in parallel.
+\param [out] endOffset Offset after the last section, where the next section will be appended.
+\return false if the container is corrupted.
+*/
+static bool dbparsecontainer(const std::vector<unsigned char> & fileData, DbLoadSaveType loadType, JSON roots[_countof(dbSections)], size_t & endOffset)
+{
+    auto fileHeader = (const DbFileHeader*)fileData.data();
+    if(fileHeader->version != DB_FILE_VERSION)
+        return false;
+
+    // Appended sections replace earlier ones with the same name
+    const DbSectionHeader* latest[_countof(dbSections)] = {};
+    size_t offset = sizeof(DbFileHeader);
+    for(unsigned int i = 0; i < fileHeader->sectionCount; i++)
+    {
+        if(fileData.size() - offset < sizeof(DbSectionHeader))
+            return false;
+        auto header = (const DbSectionHeader*)(fileData.data() + offset);
+        offset += sizeof(DbSectionHeader);
+        if(fileData.size() - offset < header->storedSize)
+            return false;
+        offset += header->storedSize;
+        for(size_t j = 0; j < _countof(dbSections); j++)
+        {
+            // Unknown sections (written by newer versions) are skipped
+            if(strncmp(header->name, dbSections[j].name, sizeof(header->name)) == 0 && dbsectionselected(dbSections[j], loadType))
+            {
+                latest[j] = header;
+                break;
+            }
+        }
+    }
+
+    endOffset = offset;
+
+    bool success = true;
+    concurrency::parallel_for(size_t(0), _countof(dbSections), [&](size_t i)
+    {
+        auto header = latest[i];
+        if(!header)
+            return;
+        auto stored = (const char*)(header + 1);
+        JSON root = nullptr;
+        if(header->flags & DB_SECTION_COMPRESSED)
+        {
+            std::vector<char> raw(header->rawSize);
+            if(LZ4_decompress_safe(stored, raw.data(), header->storedSize, header->rawSize) == int(header->rawSize))
+                root = json_loadb(raw.data(), raw.size(), 0, 0);
+        }
+        else
+            root = json_loadb(stored, header->storedSize, 0, 0);
+        if(root)
+            roots[i] = root;
+        else
+            success = false;
+    });
+    return success;
+}
 
+/**
+\brief Reads a database in the original JSON format, either plain or as an LZ4 archive.
+*/
+static JSON dbloadlegacy()
+{
     // Multi-byte (UTF8) file path converted to UTF16
     WString databasePathW = StringUtils::Utf8ToUtf16(dbpath);
 
@@ -152,7 +492,7 @@ void DbLoad(DbLoadSaveType loadType)
         if(useCompression && lzmaStatus != LZ4_SUCCESS && lzmaStatus != LZ4_INVALID_ARCHIVE)
         {
             dputs("\nInvalid database file!");
-            return;
+            return nullptr;
         }
     }
 
@@ -162,72 +502,117 @@ void DbLoad(DbLoadSaveType loadType)
     if(!FileHelper::ReadAllText(dbpath, databaseText))
     {
         dputs("\nFailed to read database file!");
-        return;
+        return nullptr;
     }
 
     // Restore the old, compressed file
     if(lzmaStatus != LZ4_INVALID_ARCHIVE && useCompression)
         LZ4_compress_fileW(databasePathW.c_str(), databasePathW.c_str());
 
-
     // Deserialize JSON and validate
     JSON root = json_loads(databaseText.c_str(), 0, 0);
 
     if(!root)
-    {
         dputs("\nInvalid database file (JSON)!");
+    return root;
+}
+
+void DbLoad(DbLoadSaveType loadType)
+{
+    EXCLUSIVE_ACQUIRE(LockDatabase);
+
+    // If the file doesn't exist, there is no DB to load
+    if(!FileExists(dbpath))
+        return;
+
+    if(loadType == DbLoadSaveType::CommandLine)
+        dputs("Loading commandline...");
+    else
+        dprintf("Loading database...");
+    DWORD ticks = GetTickCount();
+
+    std::vector<unsigned char> fileData;
+    if(!FileHelper::ReadAllData(dbpath, fileData))
+    {
+        dputs("\nFailed to read database file!");
         return;
     }
 
-    // Load only command line
-    if(loadType == DbLoadSaveType::CommandLine || loadType == DbLoadSaveType::All)
+    // Every subsystem gets its own section root, the legacy format shares one root between all of them
+    JSON roots[_countof(dbSections)] = {};
+    size_t endOffset = 0;
+    bool container = fileData.size() >= sizeof(DbFileHeader) && memcmp(fileData.data(), DB_FILE_MAGIC, 4) == 0;
+    if(container)
     {
-        CmdLineCacheLoad(root);
+        if(!dbparsecontainer(fileData, loadType, roots, endOffset))
+        {
+            for(auto root : roots)
+                if(root)
+                    json_decref(root);
+            dputs("\nInvalid database file!");
+            return;
+        }
+    }
+    else
+    {
+        fileData.clear();
+        JSON root = dbloadlegacy();
+        if(!root)
+            return;
+        for(auto & sectionRoot : roots)
+            sectionRoot = json_incref(root);
+        json_decref(root);
     }
 
-    if(loadType == DbLoadSaveType::DebugData || loadType == DbLoadSaveType::All)
+    pluginLoadSaveType = loadType;
+    for(size_t i = 0; i < _countof(dbSections); i++)
+    {
+        if(!dbsectionselected(dbSections[i], loadType))
+            continue;
+        // Missing sections are loaded from an empty root so the subsystem state is still reset
+        if(!roots[i])
+            roots[i] = json_object();
+        dbSections[i].load(roots[i]);
+    }
+
+    // The file now matches the loaded data, so the next save can append to it
+    if(loadType != DbLoadSaveType::CommandLine)
     {
-        // Finally load all structures
-        CommentCacheLoad(root);
-        LabelCacheLoad(root);
-        BookmarkCacheLoad(root);
-        FunctionCacheLoad(root);
-        ArgumentCacheLoad(root);
-        LoopCacheLoad(root);
-        XrefCacheLoad(root);
-        EncodeMapCacheLoad(root);
-        TraceRecord.loadFromDb(root);
-        BpCacheLoad(root);
-        WatchCacheLoad(root);
-
-        // Load notes
-        const char* text = json_string_value(json_object_get(root, "notes"));
-        GuiSetDebuggeeNotes(text);
-
-        // Plugins
-        JSON pluginRoot = json_object_get(root, "plugins");
-        if(pluginRoot)
+        memset(&dbjournal, 0, sizeof(dbjournal));
+        if(container)
         {
-            PLUG_CB_LOADSAVEDB pluginLoadDb;
-            pluginLoadDb.root = pluginRoot;
-            switch(loadType)
+            dbjournal.valid = true;
+            dbjournal.sectionCount = ((const DbFileHeader*)fileData.data())->sectionCount;
+            dbjournal.fileSize = endOffset;
+            dbjournal.checkpointSize = endOffset;
+            for(size_t i = 0; i < _countof(dbSections); i++)
             {
-            case DbLoadSaveType::DebugData:
-                pluginLoadDb.loadSaveType = PLUG_DB_LOADSAVE_DATA;
-                break;
-            case DbLoadSaveType::All:
-                pluginLoadDb.loadSaveType = PLUG_DB_LOADSAVE_ALL;
-                break;
-            default:
-                pluginLoadDb.loadSaveType = 0;
-                break;
+                auto & saved = dbjournal.sections[i];
+                saved.revisionValid = dbSections[i].revision && dbsectionselected(dbSections[i], loadType);
+                saved.revision = saved.revisionValid ? dbSections[i].revision() : 0;
+
+                // Sections without change tracking are compared by content, start from what was loaded
+                if(!dbSections[i].revision && dbsectionselected(dbSections[i], loadType))
+                {
+                    JSON sectionRoot = json_object();
+                    dbSections[i].save(sectionRoot);
+                    char* jsonText = json_dumps(sectionRoot, JSON_COMPACT);
+                    json_decref(sectionRoot);
+                    if(jsonText)
+                    {
+                        saved.hashValid = true;
+                        saved.hash = murmurhash(jsonText, int(strlen(jsonText)));
+                        json_free(jsonText);
+                    }
+                }
             }
-            plugincbcall(CB_LOADDB, &pluginLoadDb);
         }
     }
 
-    // Free root
-    json_decref(root);
+    // Free roots
+    for(auto root : roots)
+        if(root)
+            json_decref(root);
 
     if(loadType != DbLoadSaveType::CommandLine)
         dprintf("%ums\n", GetTickCount() - ticks);
@@ -235,6 +620,8 @@ void DbLoad(DbLoadSaveType loadType)
 
 void DbClose()
 {
+    // Compact the appended sections into a full save
+    dbjournal.valid = false;
     DbSave(DbLoadSaveType::All);
     CommentClear();
     LabelClear();
@@ -271,6 +658,8 @@ void DbSetPath(const char* Directory, const char* ModulePath)
     // The database file path may be relative (dbbasepath) or a full path
     if(ModulePath)
     {
+        dbjournal.valid = false;
+
         ASSERT_TRUE(strlen(ModulePath) > 0);
 
 #ifdef _WIN64
@@ -12,6 +12,7 @@ enum class DbLoadSaveType
 
 void DbSave(DbLoadSaveType saveType);
 void DbLoad(DbLoadSaveType loadType);
+bool DbExportJson(const char* FileName);
 void DbClose();
 void DbSetPath(const char* Directory, const char* ModulePath);
 
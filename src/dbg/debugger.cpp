@@ -27,6 +27,8 @@
 #include "TraceRecord.h"
 #include "historycontext.h"
 #include "taskthread.h"
+#include "hitlog.h"
+#include "symbolindex.h"
 
 struct TraceCondition
 {
@@ -85,8 +87,78 @@ bool bUndecorateSymbolNames = true;
 bool bEnableSourceDebugging = true;
 bool bTraceRecordEnabledDuringTrace = true;
 bool bSkipInt3Stepping = false;
+bool bDeferBreakpointLog = false;
 duint DbgEvents = 0;
 
+struct BPLOGRECORD
+{
+    std::shared_ptr<FormatTemplate> format;
+    FormatValues values;
+};
+
+static std::vector<BPLOGRECORD> bpLogRecords;
+static DWORD bpLogFlushTicks = 0;
+
+/**
+\brief Formats the deferred breakpoint log records and sends them to the log in one message.
+       This is called from the GUI update threads as well, the records are taken under LockBreakpointLog and formatted outside of it.
+*/
+static void bplogflush()
+{
+    std::vector<BPLOGRECORD> records;
+    {
+        EXCLUSIVE_ACQUIRE(LockBreakpointLog);
+        bpLogFlushTicks = GetTickCount();
+        if(bpLogRecords.empty())
+            return;
+        records.swap(bpLogRecords);
+    }
+    String text;
+    for(const auto & record : records)
+    {
+        text += stringformatrender(*record.format, record.values);
+        text += '\n';
+    }
+    GuiAddLogMessageAsync(text.c_str());
+}
+
+/**
+\brief Logs the text of a breakpoint. The compiled templates are cached by their text.
+\param logText The log text of the breakpoint.
+\param immediate Format the text now, even if the breakpoint log is deferred.
+*/
+static void bplog(const char* logText, bool immediate)
+{
+    static std::unordered_map<String, std::shared_ptr<FormatTemplate>> templates;
+    auto found = templates.find(logText);
+    if(found == templates.end())
+    {
+        if(templates.size() >= 256) //breakpoint log texts were edited a lot
+            templates.clear();
+        auto format = std::make_shared<FormatTemplate>();
+        stringformatcompile(logText, *format);
+        found = templates.insert({ logText, format }).first;
+    }
+    if(!bDeferBreakpointLog || immediate)
+    {
+        bplogflush();
+        dprintf("%s\n", stringformatinline(*found->second).c_str());
+        return;
+    }
+    //only evaluate the expressions now, the numbers are formatted when the log is flushed
+    BPLOGRECORD record;
+    record.format = found->second;
+    stringformatevaluate(*record.format, record.values);
+    bool flush;
+    {
+        EXCLUSIVE_ACQUIRE(LockBreakpointLog);
+        bpLogRecords.push_back(std::move(record));
+        flush = bpLogRecords.size() >= 4096 || GetTickCount() - bpLogFlushTicks >= 100;
+    }
+    if(flush)
+        bplogflush();
+}
+
 static duint dbgcleartracecondition()
 {
     duint steps = 0;
@@ -349,6 +421,7 @@ void updateSEHChainAsync()
 
 void DebugUpdateGui(duint disasm_addr, bool stack)
 {
+    bplogflush();
     if(GuiIsUpdateDisabled())
         return;
     duint cip = GetContextDataEx(hActiveThread, UE_CIP);
@@ -610,6 +683,25 @@ static void handleBreakCondition(const BREAKPOINT & bp, const void* ExceptionAdd
     }
 }
 
+/**
+\brief Executes a breakpoint command. Command texts are parsed once and reused on every hit.
+*/
+static void bpcmdexec(const char* commandText)
+{
+    static std::unordered_map<String, CMDINVOCATION> invocations;
+    auto found = invocations.find(commandText);
+    if(found == invocations.end())
+    {
+        if(invocations.size() >= 256) //breakpoint commands were edited a lot
+            invocations.clear();
+        CMDINVOCATION invocation;
+        if(!cmdprepare(commandText, invocation))
+            return;
+        found = invocations.insert({ commandText, invocation }).first;
+    }
+    cmdinvoke(found->second);
+}
+
 static void cbGenericBreakpoint(BP_TYPE bptype, void* ExceptionAddress = nullptr)
 {
     hActiveThread = ThreadGetHandle(((DEBUG_EVENT*)GetDebugData())->dwThreadId);
@@ -652,6 +744,7 @@ static void cbGenericBreakpoint(BP_TYPE bptype, void* ExceptionAddress = nullptr
     SHARED_RELEASE();
     bp.addr += ModBaseFromAddr(CIP);
     bp.active = true; //a breakpoint that has been hit is active
+    HitLogAdd(bp, bp.addr);
 
     varset("$breakpointcounter", bp.hitcount, false); //save the breakpoint counter as a variable
 
@@ -675,6 +768,8 @@ static void cbGenericBreakpoint(BP_TYPE bptype, void* ExceptionAddress = nullptr
         commandCondition = breakCondition; //if no condition is set, execute the command when the debugger would break
 
     lock(WAITID_RUN);
+    if(breakCondition) //show the log of the previous hits before the debugger breaks
+        bplogflush();
     handleBreakCondition(bp, ExceptionAddress, CIP, breakCondition);
 
     PLUG_CB_BREAKPOINT bpInfo;
@@ -692,14 +787,14 @@ static void cbGenericBreakpoint(BP_TYPE bptype, void* ExceptionAddress = nullptr
 
     if(*bp.logText && logCondition)  //log
     {
-        dprintf("%s\n", stringformatinline(bp.logText).c_str());
+        bplog(bp.logText, breakCondition);
     }
     if(*bp.commandText && commandCondition)  //command
     {
         //TODO: commands like run/step etc will fuck up your shit
         varset("$breakpointcondition", breakCondition ? 1 : 0, false);
         varset("$breakpointlogcondition", logCondition, false);
-        _dbg_dbgcmddirectexec(bp.commandText);
+        bpcmdexec(bp.commandText);
         duint script_breakcondition;
         int size;
         VAR_TYPE type;
@@ -1163,6 +1258,7 @@ static void cbCreateProcess(CREATE_PROCESS_DEBUG_INFO* CreateProcessInfo)
     modInfo.SizeOfStruct = sizeof(modInfo);
     if(SafeSymGetModuleInfoW64(fdProcessInfo->hProcess, (DWORD64)base, &modInfo))
         ModLoad((duint)base, modInfo.ImageSize, StringUtils::Utf16ToUtf8(modInfo.ImageName).c_str());
+    SymIndexLoad((duint)base);
 
     char modname[256] = "";
     if(ModNameFromAddr((duint)base, modname, true))
@@ -1259,11 +1355,13 @@ static void cbCreateProcess(CREATE_PROCESS_DEBUG_INFO* CreateProcessInfo)
 
 static void cbExitProcess(EXIT_PROCESS_DEBUG_INFO* ExitProcess)
 {
+    bplogflush();
     dprintf("Process stopped with exit code 0x%X\n", ExitProcess->dwExitCode);
     PLUG_CB_EXITPROCESS callbackInfo;
     callbackInfo.ExitProcess = ExitProcess;
     plugincbcall(CB_EXITPROCESS, &callbackInfo);
     //unload main module
+    SymIndexUnload(pCreateProcessBase);
     SafeSymUnloadModule64(fdProcessInfo->hProcess, pCreateProcessBase);
     //history
     dbgcleartracecondition();
@@ -1389,20 +1487,28 @@ static void cbLoadDll(LOAD_DLL_DEBUG_INFO* LoadDll)
     if(!GetFileNameFromHandle(LoadDll->hFile, DLLDebugFileName))
         strcpy_s(DLLDebugFileName, "??? (GetFileNameFromHandle failed)");
 
-    SafeSymLoadModuleExW(fdProcessInfo->hProcess, LoadDll->hFile, StringUtils::Utf8ToUtf16(DLLDebugFileName).c_str(), 0, (DWORD64)base, 0, 0, 0);
     IMAGEHLP_MODULEW64 modInfo;
     memset(&modInfo, 0, sizeof(modInfo));
     modInfo.SizeOfStruct = sizeof(modInfo);
-    if(SafeSymGetModuleInfoW64(fdProcessInfo->hProcess, (DWORD64)base, &modInfo))
+    bool symbolsLoaded;
+    {
+        ModStageTimer timer(ModLoadStage::Symbols);
+        SafeSymLoadModuleExW(fdProcessInfo->hProcess, LoadDll->hFile, StringUtils::Utf8ToUtf16(DLLDebugFileName).c_str(), 0, (DWORD64)base, 0, 0, 0);
+        symbolsLoaded = !!SafeSymGetModuleInfoW64(fdProcessInfo->hProcess, (DWORD64)base, &modInfo);
+    }
+    if(symbolsLoaded)
         ModLoad((duint)base, modInfo.ImageSize, StringUtils::Utf16ToUtf8(modInfo.ImageName).c_str());
+    SymIndexLoad((duint)base);
 
     // Update memory map
     MemUpdateMapAsync();
 
     char modname[256] = "";
     if(ModNameFromAddr((duint)base, modname, true))
+    {
+        ModStageTimer timer(ModLoadStage::Breakpoints);
         BpEnumAll(cbSetModuleBreakpoints, modname, duint(base));
-    GuiUpdateBreakpointsView();
+    }
     bool bAlreadySetEntry = false;
 
     char command[256] = "";
@@ -1418,7 +1524,7 @@ static void cbLoadDll(LOAD_DLL_DEBUG_INFO* LoadDll)
             cmddirectexec(command);
         }
     }
-    GuiUpdateBreakpointsView();
+    DebugUpdateBreakpointsViewAsync();
 
     if(settingboolget("Events", "TlsCallbacks"))
     {
@@ -1456,11 +1562,18 @@ static void cbLoadDll(LOAD_DLL_DEBUG_INFO* LoadDll)
 
     if((bBreakOnNextDll || settingboolget("Events", "DllEntry")) && !bAlreadySetEntry)
     {
-        duint oep = GetPE32DataW(StringUtils::Utf8ToUtf16(DLLDebugFileName).c_str(), 0, UE_OEP);
-        if(oep)
+        // The entry was read from the mapped image already, only parse the file again when the module wasn't loaded
+        duint entry = ModEntryFromAddr((duint)base);
+        if(!entry && !ModBaseFromAddr((duint)base))
+        {
+            duint oep = GetPE32DataW(StringUtils::Utf8ToUtf16(DLLDebugFileName).c_str(), 0, UE_OEP);
+            if(oep)
+                entry = oep + (duint)base;
+        }
+        if(entry)
         {
             char command[256] = "";
-            sprintf(command, "bp " fhex ",\"DllMain (%s)\",ss", oep + (duint)base, modname);
+            sprintf(command, "bp " fhex ",\"DllMain (%s)\",ss", entry, modname);
             cmddirectexec(command);
         }
     }
@@ -1526,6 +1639,7 @@ static void cbUnloadDll(UNLOAD_DLL_DEBUG_INFO* UnloadDll)
     if(ModNameFromAddr((duint)base, modname, true))
         BpEnumAll(cbRemoveModuleBreakpoints, modname, duint(base));
     GuiUpdateBreakpointsView();
+    SymIndexUnload((duint)base);
     SafeSymUnloadModule64(fdProcessInfo->hProcess, (DWORD64)base);
     dprintf("DLL Unloaded: " fhex " %s\n", base, modname);
 
@@ -1690,6 +1804,7 @@ static void cbException(EXCEPTION_DEBUG_INFO* ExceptionData)
 static void cbDebugEvent(DEBUG_EVENT* DebugEvent)
 {
     InterlockedIncrement(&DbgEvents);
+    SymInvalidateSymbolicNames(); //names can depend on memory (pointers, jump thunks)
     PLUG_CB_DEBUGEVENT debugEventInfo;
     debugEventInfo.DebugEvent = DebugEvent;
     plugincbcall(CB_DEBUGEVENT, &debugEventInfo);
@@ -2317,6 +2432,7 @@ static void debugLoopFunction(void* lpParameter, bool attach)
     plugincbcall(CB_STOPDEBUG, &stopInfo);
 
     //cleanup dbghelp
+    SymIndexClear();
     SafeSymRegisterCallbackW64(hProcess, nullptr, 0);
     SafeSymCleanup(hProcess);
 
@@ -2326,6 +2442,7 @@ static void debugLoopFunction(void* lpParameter, bool attach)
     //cleanup
     dbgcleartracecondition();
     dbgClearRtuBreakpoints();
+    stackclearcallstack();
     DbClose();
     ModClear();
     ThreadClear();
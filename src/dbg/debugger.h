@@ -134,5 +134,6 @@ extern bool bUndecorateSymbolNames;
 extern bool bEnableSourceDebugging;
 extern bool bTraceRecordEnabledDuringTrace;
 extern bool bSkipInt3Stepping;
+extern bool bDeferBreakpointLog;
 
 #endif // _DEBUGGER_H
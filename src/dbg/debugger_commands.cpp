@@ -25,6 +25,8 @@
 #include "function.h"
 #include "historycontext.h"
 #include "taskthread.h"
+#include "hitlog.h"
+#include "symbolindex.h"
 
 static bool bScyllaLoaded = false;
 duint LoadLibThreadID;
@@ -674,6 +676,126 @@ CMDRESULT cbDebugResetBPXHitCount(int argc, char* argv[])
     return cbDebugResetBPXHitCountCommon(BPNORMAL, argc, argv);
 }
 
+CMDRESULT cbDebugHitLog(int argc, char* argv[])
+{
+    if(argc < 2) //stop logging
+    {
+        if(!HitLogEnabled())
+        {
+            dputs("The hit log is not running");
+            return STATUS_ERROR;
+        }
+        dprintf("Hit log stopped, %llu hit(s) written\n", HitLogStop());
+        return STATUS_CONTINUE;
+    }
+    std::vector<String> expressions;
+    for(int i = 2; i < argc; i++)
+        expressions.push_back(argv[i]);
+    if(expressions.size() > HITLOG_MAX_VALUES)
+    {
+        dprintf("A maximum of %d values can be logged\n", HITLOG_MAX_VALUES);
+        return STATUS_ERROR;
+    }
+    if(!HitLogStart(argv[1], expressions))
+    {
+        dprintf("Failed to start the hit log \"%s\" (invalid expression or file)\n", argv[1]);
+        return STATUS_ERROR;
+    }
+    dprintf("Breakpoint hits will be written to \"%s\"\n", argv[1]);
+    return STATUS_CONTINUE;
+}
+
+CMDRESULT cbDebugHitLogStats(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        dputs("Not enough arguments!");
+        return STATUS_ERROR;
+    }
+    duint filter = 0;
+    if(argc > 2 && !valfromstring(argv[2], &filter, false))
+        return STATUS_ERROR;
+    struct HitStats
+    {
+        unsigned long long hits;
+        unsigned long long first;
+        unsigned long long last;
+        std::set<unsigned int> threads;
+        unsigned long long minValue[HITLOG_MAX_VALUES];
+        unsigned long long maxValue[HITLOG_MAX_VALUES];
+    };
+    typedef std::pair<unsigned long long, unsigned char> HitKey; //address and breakpoint type
+    typedef std::pair<HitKey, HitStats> HitEntry;
+    std::map<HitKey, HitStats> stats;
+    unsigned long long start = 0;
+    HITLOGHEADER header;
+    auto cbRecord = [&](const HITLOGRECORD & record)
+    {
+        if(!start)
+            start = record.timestamp;
+        if(argc > 2 && record.address != filter)
+            return true;
+        auto found = stats.find({ record.address, record.type });
+        if(found == stats.end())
+        {
+            HitStats hit;
+            hit.hits = 0;
+            hit.first = record.timestamp;
+            for(int i = 0; i < HITLOG_MAX_VALUES; i++)
+            {
+                hit.minValue[i] = ~0ull;
+                hit.maxValue[i] = 0;
+            }
+            found = stats.insert({ { record.address, record.type }, hit }).first;
+        }
+        auto & hit = found->second;
+        hit.hits++;
+        hit.last = record.timestamp;
+        hit.threads.insert(record.threadId);
+        for(int i = 0; i < HITLOG_MAX_VALUES; i++)
+        {
+            if(!(record.valueMask & (1 << i)))
+                continue;
+            hit.minValue[i] = min(hit.minValue[i], record.values[i]);
+            hit.maxValue[i] = max(hit.maxValue[i], record.values[i]);
+        }
+        return true;
+    };
+    if(!HitLogRead(argv[1], header, cbRecord))
+    {
+        dprintf("\"%s\" is not a valid hit log\n", argv[1]);
+        return STATUS_ERROR;
+    }
+    std::vector<HitEntry> sorted(stats.begin(), stats.end());
+    std::sort(sorted.begin(), sorted.end(), [](const HitEntry & a, const HitEntry & b)
+    {
+        return a.second.hits > b.second.hits;
+    });
+    auto seconds = [&](unsigned long long timestamp)
+    {
+        return double(timestamp - start) / double(header.frequency);
+    };
+    dprintf("%llu hit(s) in the log\n", header.recordCount);
+    for(const auto & entry : sorted)
+    {
+        const auto & hit = entry.second;
+        dprintf("%p (type %d): %llu hit(s), %d thread(s), %.6fs - %.6fs\n",
+                duint(entry.first.first),
+                entry.first.second,
+                hit.hits,
+                int(hit.threads.size()),
+                seconds(hit.first),
+                seconds(hit.last));
+        for(unsigned int i = 0; i < header.valueCount; i++)
+        {
+            if(hit.minValue[i] > hit.maxValue[i]) //never evaluated
+                continue;
+            dprintf("    %s: %llX - %llX\n", header.expressions[i], hit.minValue[i], hit.maxValue[i]);
+        }
+    }
+    return STATUS_CONTINUE;
+}
+
 CMDRESULT cbDebugGetBPXHitCount(int argc, char* argv[])
 {
     return cbDebugGetBPXHitCountCommon(BPNORMAL, argc, argv);
@@ -1677,6 +1799,21 @@ CMDRESULT cbDebugStartScylla(int argc, char* argv[])
     return STATUS_CONTINUE;
 }
 
+CMDRESULT cbDebugPluginTiming(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        plugincbtimingprint();
+        return STATUS_CONTINUE;
+    }
+    duint enable = 0;
+    if(!valfromstring(argv[1], &enable, false))
+        return STATUS_ERROR;
+    plugincbtiming(enable != 0);
+    dputs(enable ? "Plugin callback timing enabled" : "Plugin callback timing disabled");
+    return STATUS_CONTINUE;
+}
+
 CMDRESULT cbDebugAttach(int argc, char* argv[])
 {
     if(argc < 2)
@@ -2076,6 +2213,7 @@ CMDRESULT cbDebugDownloadSymbol(int argc, char* argv[])
         return STATUS_ERROR;
     }
     SafeSymSetOptions(symOptions);
+    SymIndexLoad(modbase);
     if(!SafeSymSetSearchPathW(fdProcessInfo->hProcess, szOldSearchPath))
     {
         dputs("SymSetSearchPathW (2) failed!");
@@ -26,6 +26,8 @@ CMDRESULT cbDebugGetBPXHitCount(int argc, char* argv[]);
 CMDRESULT cbDebugSetBPXFastResume(int argc, char* argv[]);
 CMDRESULT cbDebugSetBPXSilent(int argc, char* argv[]);
 CMDRESULT cbDebugResetBPXHitCount(int argc, char* argv[]);
+CMDRESULT cbDebugHitLog(int argc, char* argv[]);
+CMDRESULT cbDebugHitLogStats(int argc, char* argv[]);
 CMDRESULT cbDebugSetBPGoto(int argc, char* argv[]);
 CMDRESULT cbDebugSetHardwareBreakpoint(int argc, char* argv[]);
 CMDRESULT cbDebugDeleteHardwareBreakpoint(int argc, char* argv[]);
@@ -78,6 +80,7 @@ CMDRESULT cbDebugMemset(int argc, char* argv[]);
 CMDRESULT cbDebugBenchmark(int argc, char* argv[]);
 CMDRESULT cbDebugPause(int argc, char* argv[]);
 CMDRESULT cbDebugStartScylla(int argc, char* argv[]);
+CMDRESULT cbDebugPluginTiming(int argc, char* argv[]);
 CMDRESULT cbDebugAttach(int argc, char* argv[]);
 CMDRESULT cbDebugDetach(int argc, char* argv[]);
 CMDRESULT cbDebugDump(int argc, char* argv[]);
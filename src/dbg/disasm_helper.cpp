@@ -13,6 +13,8 @@
 #include "encodemap.h"
 #include <capstone_wrapper.h>
 #include "datainst_helper.h"
+#include <emmintrin.h>
+#include <intrin.h>
 
 
 duint disasmback(unsigned char* data, duint base, duint size, duint ip, int n)
@@ -252,99 +254,158 @@ void disasmprint(duint addr)
         dprintf(" %d:%d:%" fext "X:%" fext "X:%" fext "X\n", i, instr.arg[i].type, instr.arg[i].constant, instr.arg[i].value, instr.arg[i].memvalue);
 }
 
-static bool isasciistring(const unsigned char* data, int maxlen)
+// Lookup table for isprint(c) || isspace(c) in the "C" locale
+static struct PrintableTable
 {
-    int len = 0;
-    for(char* p = (char*)data; *p; len++, p++)
+    bool table[256];
+
+    PrintableTable()
     {
-        if(len >= maxlen)
-            break;
+        for(int i = 0; i < 256; i++)
+            table[i] = (i >= 0x20 && i < 0x7F) || (i >= 0x09 && i <= 0x0D);
     }
 
-    if(len < 2 || len + 1 >= maxlen)
-        return false;
-    for(int i = 0; i < len; i++)
-        if(!isprint(data[i]) && !isspace(data[i]))
-            return false;
-    return true;
-}
+    bool operator[](unsigned char ch) const
+    {
+        return table[ch];
+    }
+} isprintable;
 
-static bool isunicodestring(const unsigned char* data, int maxlen)
+/**
+\brief Determines the length of a printable, null-terminated ASCII string.
+\param data The data to scan, at least maxlen bytes must be readable.
+\param maxlen The maximum number of bytes to scan.
+\return The string length, or -1 when a non-printable character comes before the terminator or there is no terminator.
+*/
+static int asciistringlen(const unsigned char* data, int maxlen)
 {
-    int len = 0;
-    for(wchar_t* p = (wchar_t*)data; *p; len++, p++)
+    int i = 0;
+    // Classify 16 bytes at a time: printable = (0x1F, 0x7F) or (0x08, 0x0E), signed compares reject >= 0x80
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i printLow = _mm_set1_epi8(0x1F), printHigh = _mm_set1_epi8(0x7F);
+    const __m128i spaceLow = _mm_set1_epi8(0x08), spaceHigh = _mm_set1_epi8(0x0E);
+    for(; i + 16 <= maxlen; i += 16)
+    {
+        auto chunk = _mm_loadu_si128((const __m128i*)(data + i));
+        auto print = _mm_and_si128(_mm_cmpgt_epi8(chunk, printLow), _mm_cmplt_epi8(chunk, printHigh));
+        auto space = _mm_and_si128(_mm_cmpgt_epi8(chunk, spaceLow), _mm_cmplt_epi8(chunk, spaceHigh));
+        unsigned int goodMask = _mm_movemask_epi8(_mm_or_si128(print, space));
+        unsigned int nullMask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, zero));
+        if(nullMask)
+        {
+            unsigned long index;
+            _BitScanForward(&index, nullMask);
+            unsigned int before = (1u << index) - 1;
+            return (goodMask & before) == before ? i + int(index) : -1;
+        }
+        if(goodMask != 0xFFFF)
+            return -1;
+    }
+    for(; i < maxlen; i++)
     {
-        if(len >= maxlen)
-            break;
+        if(!data[i])
+            return i;
+        if(!isprintable[data[i]])
+            return -1;
     }
+    return -1;
+}
 
-    if(len < 2 || len + 1 >= maxlen)
-        return false;
-    for(int i = 0; i < len * 2; i += 2)
+/**
+\brief Determines the length of a printable, null-terminated UTF-16 string (extended ASCII only).
+\param data The data to scan, at least maxlen * 2 bytes must be readable.
+\param maxlen The maximum number of characters to scan.
+\return The string length in characters, or -1 if the data is not such a string.
+*/
+static int unicodestringlen(const unsigned char* data, int maxlen)
+{
+    int i = 0;
+    // Same as above on 16-bit lanes, a non-zero high byte falls outside both ranges
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i printLow = _mm_set1_epi16(0x1F), printHigh = _mm_set1_epi16(0x7F);
+    const __m128i spaceLow = _mm_set1_epi16(0x08), spaceHigh = _mm_set1_epi16(0x0E);
+    for(; i + 8 <= maxlen; i += 8)
+    {
+        auto chunk = _mm_loadu_si128((const __m128i*)(data + i * 2));
+        auto print = _mm_and_si128(_mm_cmpgt_epi16(chunk, printLow), _mm_cmplt_epi16(chunk, printHigh));
+        auto space = _mm_and_si128(_mm_cmpgt_epi16(chunk, spaceLow), _mm_cmplt_epi16(chunk, spaceHigh));
+        unsigned int goodMask = _mm_movemask_epi8(_mm_or_si128(print, space));
+        unsigned int nullMask = _mm_movemask_epi8(_mm_cmpeq_epi16(chunk, zero));
+        if(nullMask)
+        {
+            unsigned long index;
+            _BitScanForward(&index, nullMask);
+            unsigned int before = (1u << index) - 1;
+            return (goodMask & before) == before ? i + int(index / 2) : -1;
+        }
+        if(goodMask != 0xFFFF)
+            return -1;
+    }
+    for(; i < maxlen; i++)
     {
-        if(data[i + 1]) //Extended ASCII only
-            return false;
-        if(!isprint(data[i]) && !isspace(data[i]))
-            return false;
+        auto lo = data[i * 2], hi = data[i * 2 + 1];
+        if(!lo && !hi)
+            return i;
+        if(hi || !isprintable[lo])
+            return -1;
     }
-    return true;
+    return -1;
+}
+
+static bool isasciistring(const unsigned char* data, int maxlen)
+{
+    // The terminator has to fit with room to spare (len + 1 < maxlen)
+    return asciistringlen(data, maxlen - 1) >= 2;
+}
+
+static bool isunicodestring(const unsigned char* data, int maxlen)
+{
+    return unicodestringlen(data, maxlen - 1) >= 2;
 }
 
 bool disasmispossiblestring(duint addr)
 {
-    unsigned char data[11];
+    unsigned char data[12];
     memset(data, 0, sizeof(data));
-    if(!MemReadUnsafe(addr, data, sizeof(data) - 3))
+    if(!MemReadUnsafe(addr, data, sizeof(data) - 4))
         return false;
-    duint test = 0;
-    memcpy(&test, data, sizeof(duint));
-    if(isasciistring(data, sizeof(data)) || isunicodestring(data, _countof(data)))
+    if(isasciistring(data, sizeof(data)) || isunicodestring(data, sizeof(data) / 2))
         return true;
     return false;
 }
 
-bool disasmgetstringat(duint addr, STRING_TYPE* type, char* ascii, char* unicode, int maxlen)
+/**
+\brief Classifies and escapes a string from a local buffer.
+\param data The data to check, must contain (maxlen + 1) * 2 bytes.
+*/
+static bool disasmgetstringfromdata(const unsigned char* data, STRING_TYPE* type, char* ascii, char* unicode, int maxlen)
 {
-    if(type)
-        *type = str_none;
-    if(!MemIsValidReadPtrUnsafe(addr, true) || !disasmispossiblestring(addr))
-        return false;
-    Memory<unsigned char*> data((maxlen + 1) * 2, "disasmgetstringat:data");
-    if(!MemReadUnsafe(addr, data(), (maxlen + 1) * 2)) //TODO: use safe version?
-        return false;
-
-    // Save a few pointer casts
-    auto asciiData = (char*)data();
-    auto unicodeData = (wchar_t*)data();
-
     // First check if this was an ASCII only string
-    if(isasciistring(data(), maxlen))
+    int asciiLength = asciistringlen(data, maxlen - 1);
+    if(asciiLength >= 2)
     {
         if(type)
             *type = str_ascii;
 
         // Escape the string
-        String escaped = StringUtils::Escape(asciiData);
+        String escaped = StringUtils::Escape(String((const char*)data, asciiLength));
 
         // Copy data back to outgoing parameter
         strncpy_s(ascii, min(int(escaped.length()) + 1, maxlen), escaped.c_str(), _TRUNCATE);
         return true;
     }
 
-    if(isunicodestring(data(), maxlen))
+    int unicodeLength = unicodestringlen(data, maxlen - 1);
+    if(unicodeLength >= 2)
     {
         if(type)
             *type = str_unicode;
 
-        // Determine string length only once, limited to output buffer size
-        int unicodeLength = min(int(wcslen(unicodeData)), maxlen);
-
         // Truncate each wchar_t to char
+        String asciiData;
+        asciiData.resize(unicodeLength);
         for(int i = 0; i < unicodeLength; i++)
-            asciiData[i] = char(unicodeData[i] & 0xFF);
-
-        // Fix the null terminator (data len = maxlen + 1)
-        asciiData[unicodeLength] = '\0';
+            asciiData[i] = char(data[i * 2]);
 
         // Escape the string
         String escaped = StringUtils::Escape(asciiData);
@@ -357,6 +418,73 @@ bool disasmgetstringat(duint addr, STRING_TYPE* type, char* ascii, char* unicode
     return false;
 }
 
+bool disasmgetstringat(duint addr, STRING_TYPE* type, char* ascii, char* unicode, int maxlen)
+{
+    if(type)
+        *type = str_none;
+    if(!MemIsValidReadPtrUnsafe(addr, true) || !disasmispossiblestring(addr))
+        return false;
+    Memory<unsigned char*> data((maxlen + 1) * 2, "disasmgetstringat:data");
+    if(!MemReadUnsafe(addr, data(), (maxlen + 1) * 2)) //TODO: use safe version?
+        return false;
+    return disasmgetstringfromdata(data(), type, ascii, unicode, maxlen);
+}
+
+bool disasmgetstringat(const MemSnapshot & snapshot, duint addr, STRING_TYPE* type, char* ascii, char* unicode, int maxlen)
+{
+    if(!snapshot.IsValid(addr))
+        return disasmgetstringat(addr, type, ascii, unicode, maxlen);
+    if(type)
+        *type = str_none;
+    duint size = (maxlen + 1) * 2;
+    auto data = snapshot.Data(addr, size);
+    if(data)
+        return disasmgetstringfromdata(data, type, ascii, unicode, maxlen);
+    // Near the end of the snapshot, the (zeroed) remainder terminates the string
+    Memory<unsigned char*> buffer(size, "disasmgetstringat:buffer");
+    snapshot.Read(addr, buffer(), size);
+    return disasmgetstringfromdata(buffer(), type, ascii, unicode, maxlen);
+}
+
+bool disasmgetstringatwrapper(duint addr, char* dest, const MemSnapshot* snapshot)
+{
+    *dest = '\0';
+    if((!snapshot || !snapshot->IsValid(addr)) && !MemIsValidReadPtrUnsafe(addr, true))
+        return false;
+    char string[MAX_STRING_SIZE];
+    duint addrPtr;
+    STRING_TYPE strtype;
+    auto readPtr = [&](duint ptr)
+    {
+        if(snapshot && snapshot->Read(ptr, &addrPtr, sizeof(addrPtr)))
+            return true;
+        return MemReadUnsafe(ptr, &addrPtr, sizeof(addrPtr));
+    };
+    auto getString = [&](duint ptr, int maxlen)
+    {
+        if(snapshot)
+            return disasmgetstringat(*snapshot, ptr, &strtype, string, string, maxlen);
+        return disasmgetstringat(ptr, &strtype, string, string, maxlen);
+    };
+    if(readPtr(addr) && getString(addrPtr, MAX_STRING_SIZE - 5))
+    {
+        if(strtype == str_ascii)
+            sprintf_s(dest, MAX_STRING_SIZE, "&\"%s\"", string);
+        else //unicode
+            sprintf_s(dest, MAX_STRING_SIZE, "&L\"%s\"", string);
+        return true;
+    }
+    if(getString(addr, MAX_STRING_SIZE - 4))
+    {
+        if(strtype == str_ascii)
+            sprintf_s(dest, MAX_STRING_SIZE, "\"%s\"", string);
+        else //unicode
+            sprintf_s(dest, MAX_STRING_SIZE, "L\"%s\"", string);
+        return true;
+    }
+    return false;
+}
+
 int disasmgetsize(duint addr, unsigned char* data)
 {
     Capstone cp;
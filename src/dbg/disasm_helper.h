@@ -2,6 +2,7 @@
 #define _DISASM_HELPER_H
 
 #include "_global.h"
+#include "memsnapshot.h"
 
 //functions
 duint disasmback(unsigned char* data, duint base, duint size, duint ip, int n);
@@ -12,6 +13,8 @@ void disasmget(unsigned char* buffer, duint addr, DISASM_INSTR* instr);
 void disasmget(duint addr, DISASM_INSTR* instr);
 bool disasmispossiblestring(duint addr);
 bool disasmgetstringat(duint addr, STRING_TYPE* type, char* ascii, char* unicode, int maxlen);
+bool disasmgetstringat(const MemSnapshot & snapshot, duint addr, STRING_TYPE* type, char* ascii, char* unicode, int maxlen);
+bool disasmgetstringatwrapper(duint addr, char* dest, const MemSnapshot* snapshot = nullptr);
 int disasmgetsize(duint addr, unsigned char* data);
 int disasmgetsize(duint addr);
 
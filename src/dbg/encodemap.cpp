@@ -72,12 +72,19 @@ struct EncodeMapSerializer : AddrInfoSerializer<ENCODEMAP>
     }
 };
 
+void EncodeMapReleaseBuffer(void* buffer, bool lock);
+
 struct EncodeMap : AddrInfoHashMap<LockEncodeMaps, ENCODEMAP, EncodeMapSerializer>
 {
     const char* jsonKey() const override
     {
         return "encodemaps";
     }
+
+    void discardValue(ENCODEMAP & value) const override
+    {
+        EncodeMapReleaseBuffer(value.data, false);
+    }
 };
 
 static EncodeMap encmaps;
@@ -221,6 +228,13 @@ duint EncodeMapGetSize(duint addr, duint codesize)
     return codesize;
 }
 
+// The map data is changed in place, so the revision has to be bumped after every change for the incremental save
+static void EncodeMapMarkModified()
+{
+    EXCLUSIVE_ACQUIRE(LockEncodeMaps);
+    encmaps.MarkModified();
+}
+
 bool EncodeMapSetType(duint addr, duint size, ENCODETYPE type)
 {
     auto base = MemFindBaseAddr(addr, nullptr);
@@ -245,7 +259,10 @@ bool EncodeMapSetType(duint addr, duint size, ENCODETYPE type)
             Capstone cp;
             Memory<unsigned char*> buffer(size);
             if(!MemRead(addr, buffer(), size))
+            {
+                EncodeMapMarkModified(); // the range was reset already
                 return false;
+            }
 
             duint buffersize = size, bufferoffset = 0, cmdsize;
             for(auto i = offset; i < offset + size;)
@@ -273,6 +290,7 @@ bool EncodeMapSetType(duint addr, duint size, ENCODETYPE type)
         else
             break;
     }
+    EncodeMapMarkModified();
     return true;
 }
 
@@ -306,6 +324,24 @@ void EncodeMapCacheLoad(JSON Root)
     encmaps.CacheLoad(Root);
 }
 
+unsigned int EncodeMapCacheRevision()
+{
+    return encmaps.Revision();
+}
+
+void EncodeMapCacheSaveModule(JSON Root, const char* Module)
+{
+    encmaps.CacheSaveWhere(Root, [Module](const ENCODEMAP & value)
+    {
+        return !value.manual && !_stricmp(value.mod, Module);
+    });
+}
+
+void EncodeMapCacheMerge(JSON Root)
+{
+    encmaps.CacheMerge(Root);
+}
+
 void EncodeMapClear()
 {
     EXCLUSIVE_ACQUIRE(LockEncodeMaps);
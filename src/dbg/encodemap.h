@@ -11,5 +11,8 @@ bool EncodeMapSetType(duint addr, duint size, ENCODETYPE type);
 void EncodeMapDelRange(duint Start, duint End);
 void EncodeMapCacheSave(JSON Root);
 void EncodeMapCacheLoad(JSON Root);
+unsigned int EncodeMapCacheRevision();
+void EncodeMapCacheSaveModule(JSON Root, const char* Module);
+void EncodeMapCacheMerge(JSON Root);
 void EncodeMapClear();
 duint GetEncodeTypeSize(ENCODETYPE type);
\ No newline at end of file
@@ -146,6 +146,24 @@ void FunctionCacheLoad(JSON Root)
     functions.CacheLoad(Root, false, "auto"); //legacy support
 }
 
+unsigned int FunctionCacheRevision()
+{
+    return functions.Revision();
+}
+
+void FunctionCacheSaveModule(JSON Root, const char* Module)
+{
+    functions.CacheSaveWhere(Root, [Module](const FUNCTIONSINFO & value)
+    {
+        return !value.manual && !_stricmp(value.mod, Module);
+    });
+}
+
+void FunctionCacheMerge(JSON Root)
+{
+    functions.CacheMerge(Root);
+}
+
 bool FunctionEnum(FUNCTIONSINFO* List, size_t* Size)
 {
     return functions.Enum(List, Size);
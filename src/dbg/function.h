@@ -19,6 +19,9 @@ bool FunctionDelete(duint Address);
 void FunctionDelRange(duint Start, duint End, bool DeleteManual = false);
 void FunctionCacheSave(JSON Root);
 void FunctionCacheLoad(JSON Root);
+unsigned int FunctionCacheRevision();
+void FunctionCacheSaveModule(JSON Root, const char* Module);
+void FunctionCacheMerge(JSON Root);
 bool FunctionEnum(FUNCTIONSINFO* List, size_t* Size);
 void FunctionClear();
 void FunctionGetList(std::vector<FUNCTIONSINFO> & list);
@@ -0,0 +1,210 @@
+/**
+@file hashing.cpp
+
+@brief Implements a fast streaming hash for large buffers and per-page fingerprints of the debuggee memory.
+*/
+
+#include "hashing.h"
+#include "memory.h"
+
+// The constants and the round function are the ones of xxHash64, so the 64-bit results match it
+static const unsigned long long PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const unsigned long long PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const unsigned long long PRIME64_3 = 0x165667B19E3779F9ULL;
+static const unsigned long long PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const unsigned long long PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline unsigned long long hashrotl(unsigned long long x, int r)
+{
+    return _rotl64(x, r);
+}
+
+static inline unsigned long long hashread64(const unsigned char* p)
+{
+    unsigned long long value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline unsigned int hashread32(const unsigned char* p)
+{
+    unsigned int value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline unsigned long long hashround(unsigned long long acc, unsigned long long input)
+{
+    acc += input * PRIME64_2;
+    acc = hashrotl(acc, 31);
+    return acc * PRIME64_1;
+}
+
+static inline unsigned long long hashmerge(unsigned long long acc, unsigned long long lane)
+{
+    acc ^= hashround(0, lane);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+static inline unsigned long long hashavalanche(unsigned long long h)
+{
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+// The lanes don't depend on each other, so the multiplies of a stripe run in parallel
+static const unsigned char* hashstripes(unsigned long long lanes[4], const unsigned char* p, const unsigned char* end)
+{
+    unsigned long long v1 = lanes[0], v2 = lanes[1], v3 = lanes[2], v4 = lanes[3];
+    for(; p + 32 <= end; p += 32)
+    {
+        v1 = hashround(v1, hashread64(p));
+        v2 = hashround(v2, hashread64(p + 8));
+        v3 = hashround(v3, hashread64(p + 16));
+        v4 = hashround(v4, hashread64(p + 24));
+    }
+    lanes[0] = v1, lanes[1] = v2, lanes[2] = v3, lanes[3] = v4;
+    return p;
+}
+
+void HashInit(HashState & State, unsigned long long Seed)
+{
+    State.lanes[0] = Seed + PRIME64_1 + PRIME64_2;
+    State.lanes[1] = Seed + PRIME64_2;
+    State.lanes[2] = Seed;
+    State.lanes[3] = Seed - PRIME64_1;
+    State.seed = Seed;
+    State.totalSize = 0;
+    State.bufferSize = 0;
+}
+
+void HashUpdate(HashState & State, const void* Data, size_t Size)
+{
+    auto p = (const unsigned char*)Data;
+    auto end = p + Size;
+    State.totalSize += Size;
+
+    // Complete the stripe that was started by the previous update
+    if(State.bufferSize)
+    {
+        size_t fill = min(Size, sizeof(State.buffer) - State.bufferSize);
+        memcpy(State.buffer + State.bufferSize, p, fill);
+        State.bufferSize += fill;
+        p += fill;
+        if(State.bufferSize < sizeof(State.buffer))
+            return;
+        hashstripes(State.lanes, State.buffer, State.buffer + sizeof(State.buffer));
+        State.bufferSize = 0;
+    }
+
+    p = hashstripes(State.lanes, p, end);
+    State.bufferSize = size_t(end - p);
+    if(State.bufferSize)
+        memcpy(State.buffer, p, State.bufferSize);
+}
+
+unsigned long long HashFinal(const HashState & State)
+{
+    unsigned long long h;
+    if(State.totalSize >= 32)
+    {
+        h = hashrotl(State.lanes[0], 1) + hashrotl(State.lanes[1], 7) + hashrotl(State.lanes[2], 12) + hashrotl(State.lanes[3], 18);
+        for(int i = 0; i < 4; i++)
+            h = hashmerge(h, State.lanes[i]);
+    }
+    else
+        h = State.seed + PRIME64_5;
+    h += State.totalSize;
+
+    // Tail of up to 31 bytes
+    auto p = State.buffer;
+    auto end = State.buffer + State.bufferSize;
+    for(; p + 8 <= end; p += 8)
+    {
+        h ^= hashround(0, hashread64(p));
+        h = hashrotl(h, 27) * PRIME64_1 + PRIME64_4;
+    }
+    if(p + 4 <= end)
+    {
+        h ^= (unsigned long long)hashread32(p) * PRIME64_1;
+        h = hashrotl(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    for(; p < end; p++)
+    {
+        h ^= *p * PRIME64_5;
+        h = hashrotl(h, 11) * PRIME64_1;
+    }
+    return hashavalanche(h);
+}
+
+void HashFinal128(const HashState & State, unsigned long long Hash[2])
+{
+    // The second half mixes the lanes in a different order, so it is independent of the first
+    Hash[0] = HashFinal(State);
+    unsigned long long h = State.seed ^ PRIME64_3 ^ State.totalSize;
+    for(int i = 3; i >= 0; i--)
+        h = hashmerge(hashrotl(h, 29), State.lanes[i]);
+    Hash[1] = hashavalanche(h ^ Hash[0]);
+}
+
+unsigned long long Hash64(const void* Data, size_t Size, unsigned long long Seed)
+{
+    HashState state;
+    HashInit(state, Seed);
+    HashUpdate(state, Data, Size);
+    return HashFinal(state);
+}
+
+void Hash128(const void* Data, size_t Size, unsigned long long Seed, unsigned long long Hash[2])
+{
+    HashState state;
+    HashInit(state, Seed);
+    HashUpdate(state, Data, Size);
+    HashFinal128(state, Hash);
+}
+
+/**
+\brief Fingerprints every page of a memory range, to find out which pages changed since an earlier call.
+\param Address The start of the range, rounded down to a page.
+\param Size The size of the range.
+\param [out] Fingerprints The content hash of every page, zero for pages that could not be read.
+\return false if none of the pages could be read.
+*/
+bool HashMemoryPages(duint Address, duint Size, std::vector<unsigned long long> & Fingerprints)
+{
+    Fingerprints.clear();
+    if(!Size)
+        return false;
+    duint start = Address & ~(PAGE_SIZE - 1);
+    duint pageCount = (Address + Size - start + PAGE_SIZE - 1) / PAGE_SIZE;
+    Fingerprints.resize(pageCount);
+
+    // Read in big chunks to save round trips
+    const duint chunkPages = 256;
+    std::vector<unsigned char> data(chunkPages * PAGE_SIZE);
+    std::vector<bool> pageRead;
+    bool readAny = false;
+    for(duint page = 0; page < pageCount; page += chunkPages)
+    {
+        duint count = min(chunkPages, pageCount - page);
+        MemReadPages(start + page * PAGE_SIZE, data.data(), count * PAGE_SIZE, pageRead);
+        for(duint i = 0; i < count; i++)
+        {
+            auto pageData = data.data() + i * PAGE_SIZE;
+            if(!pageRead[size_t(i)])
+            {
+                Fingerprints[page + i] = 0;
+                continue;
+            }
+            auto fingerprint = Hash64(pageData, PAGE_SIZE);
+            Fingerprints[page + i] = fingerprint ? fingerprint : 1; // zero means unreadable
+            readAny = true;
+        }
+    }
+    return readAny;
+}
@@ -0,0 +1,24 @@
+#ifndef _HASHING_H
+#define _HASHING_H
+
+#include "_global.h"
+
+// Streaming hash of large buffers (xxHash64 layout: four independent 64-bit lanes per 32-byte stripe)
+struct HashState
+{
+    unsigned long long lanes[4];
+    unsigned long long seed;
+    unsigned long long totalSize;
+    unsigned char buffer[32]; // Bytes of the last incomplete stripe
+    size_t bufferSize;
+};
+
+void HashInit(HashState & State, unsigned long long Seed = 0);
+void HashUpdate(HashState & State, const void* Data, size_t Size);
+unsigned long long HashFinal(const HashState & State);
+void HashFinal128(const HashState & State, unsigned long long Hash[2]);
+unsigned long long Hash64(const void* Data, size_t Size, unsigned long long Seed = 0);
+void Hash128(const void* Data, size_t Size, unsigned long long Seed, unsigned long long Hash[2]);
+bool HashMemoryPages(duint Address, duint Size, std::vector<unsigned long long> & Fingerprints);
+
+#endif // _HASHING_H
@@ -1,96 +1,376 @@
 #include "historycontext.h"
-#include "disasm_helper.h"
 #include "memory.h"
 #include "console.h"
 #include "watch.h"
+#include "thread.h"
+#include "value.h"
 #include "_exports.h"
+#include <capstone_wrapper.h>
 
-duint HistoryMaxCount = 4096;
-std::deque<HistoryContext> history;
+/*
+Every step adds a record to a ring buffer of bytes (Engine\HistoryBudget, in MB).
+Only the context of the newest record is kept in full; a record stores the context words
+in which the previous record differs from it, so undoing a step applies the delta to get
+the context before it. Records also store the exact bytes that the instruction may write.
+*/
 
-//This will capture the current instruction
-HistoryContext::HistoryContext()
+#define HISTORY_DEFAULT_BUDGET 32 //MB
+#define HISTORY_MAX_PREIMAGE 0x10000 //larger writes (rep prefixes) make the record unrestorable
+
+enum HistoryFlags
+{
+    HistoryInvalid = 1, //the instruction or its memory writes could not be captured
+    HistoryFirst = 2 //there is no previous context to return to
+};
+
+struct HistoryRecord
+{
+    unsigned int size; //size of the record including this header
+    unsigned short flags;
+    unsigned short regcount; //register delta: regcount word indices, followed by regcount values
+    unsigned int memcount; //memory pre-images: address, size and data
+};
+
+struct HistoryPreImage
+{
+    duint addr;
+    unsigned int size;
+};
+
+typedef unsigned int HistoryWord;
+static const size_t HistoryContextWords = sizeof(TITAN_ENGINE_CONTEXT_t) / sizeof(HistoryWord);
+
+static std::vector<unsigned char> historyData; //ring buffer of records
+static std::deque<size_t> historyRecords; //record offsets, oldest first
+static size_t historyHead = 0; //write offset of the next record
+static TITAN_ENGINE_CONTEXT_t historyContext; //context of the newest record
+
+static duint historyregister(const TITAN_ENGINE_CONTEXT_t & context, Capstone & cp, x86_reg reg)
 {
-    DISASM_INSTR instruction;
-    if(GetFullContextDataEx(hActiveThread, &registers) && MemIsValidReadPtr(registers.cip))
+    switch(reg)
     {
-        disasmget(registers.cip, &instruction);
-        if(!(memcmp(instruction.instruction, "nop ", 4) == 0 || memcmp(instruction.instruction, "lea ", 4) == 0))
-            // do not process the memory operands of these instructions, because these instructions do not write to the memory.
-        {
-            if(memcmp(instruction.instruction, "push", 4) == 0 || memcmp(instruction.instruction, "call", 4) == 0)
-                // push and call instruction : save previous content on the stack
-            {
-                ChangedData olddata;
-                olddata.addr = registers.csp - sizeof(duint);
-                MemRead(olddata.addr, (unsigned char*)olddata.oldvalue, sizeof(duint));
-                ChangedLocation.push_back(olddata);
-            }
-            // TODO: FPU/SSE instructions, ENTER instruction, and possibly other instructions.
-            // These instructions can write more than sizeof(duint) bytes.
-            for(int i = 0; i < instruction.argcount; i++)
-            {
-                DISASM_ARG & arg = instruction.arg[i];
-                if(arg.type == DISASM_ARGTYPE::arg_memory)
-                {
-                    ChangedData olddata;
-                    olddata.addr = arg.value;
-                    memcpy(olddata.oldvalue, &arg.memvalue, sizeof(arg.memvalue));
-                    ChangedLocation.push_back(olddata);
-                }
-            }
-        }
-        invalid = false;
+#ifdef _WIN64
+    case X86_REG_RAX:
+        return context.cax;
+    case X86_REG_RBX:
+        return context.cbx;
+    case X86_REG_RCX:
+        return context.ccx;
+    case X86_REG_RDX:
+        return context.cdx;
+    case X86_REG_RSI:
+        return context.csi;
+    case X86_REG_RDI:
+        return context.cdi;
+    case X86_REG_RBP:
+        return context.cbp;
+    case X86_REG_RSP:
+        return context.csp;
+    case X86_REG_RIP:
+        return context.cip;
+    case X86_REG_R8:
+        return context.r8;
+    case X86_REG_R9:
+        return context.r9;
+    case X86_REG_R10:
+        return context.r10;
+    case X86_REG_R11:
+        return context.r11;
+    case X86_REG_R12:
+        return context.r12;
+    case X86_REG_R13:
+        return context.r13;
+    case X86_REG_R14:
+        return context.r14;
+    case X86_REG_R15:
+        return context.r15;
+#else //x86
+    case X86_REG_EAX:
+        return context.cax;
+    case X86_REG_EBX:
+        return context.cbx;
+    case X86_REG_ECX:
+        return context.ccx;
+    case X86_REG_EDX:
+        return context.cdx;
+    case X86_REG_ESI:
+        return context.csi;
+    case X86_REG_EDI:
+        return context.cdi;
+    case X86_REG_EBP:
+        return context.cbp;
+    case X86_REG_ESP:
+        return context.csp;
+    case X86_REG_EIP:
+        return context.cip;
+#endif //_WIN64
+    default:
+    {
+        auto regName = cp.RegName(reg);
+        return regName ? getregister(nullptr, regName) : 0;
+    }
     }
-    else
-        invalid = true;
 }
 
-void HistoryContext::restore()
+/**
+\brief Determines the memory the instruction at the context's instruction pointer may write.
+\return false if the writes cannot be determined.
+*/
+static bool historywrites(const TITAN_ENGINE_CONTEXT_t & context, std::vector<HistoryPreImage> & writes)
 {
-    if(!invalid)
+    unsigned char buffer[MAX_DISASM_BUFFER];
+    Capstone cp;
+    if(!MemRead(context.cip, buffer, sizeof(buffer)) || !cp.Disassemble(context.cip, buffer))
+        return false;
+
+    auto id = cp.GetId();
+    if(id == X86_INS_LEA || id == X86_INS_NOP) //memory operands are not accessed
+        return true;
+
+    //implicit stack writes
+    switch(id)
     {
-        for(auto & i : ChangedLocation)
-            MemWrite(i.addr, i.oldvalue, sizeof(duint));
-        SetFullContextDataEx(hActiveThread, &registers);
-        cbWatchdog(0, nullptr);
-        DebugUpdateGui(GetContextDataEx(hActiveThread, UE_CIP), true);
+    case X86_INS_PUSH:
+    case X86_INS_CALL:
+    case X86_INS_PUSHF:
+    case X86_INS_PUSHFD:
+    case X86_INS_PUSHFQ:
+        writes.push_back({ context.csp - sizeof(duint), sizeof(duint) });
+        break;
+#ifndef _WIN64
+    case X86_INS_PUSHAL:
+    case X86_INS_PUSHAW:
+        writes.push_back({ context.csp - 8 * sizeof(duint), 8 * sizeof(duint) });
+        break;
+#endif //_WIN64
+    case X86_INS_ENTER:
+    {
+        //the frame pointer and up to 31 nested frame pointers are pushed
+        auto level = duint(cp[1].imm & 0x1F);
+        writes.push_back({ context.csp - (level + 1) * sizeof(duint), (unsigned int)((level + 1) * sizeof(duint)) });
+    }
+    break;
+    default:
+        break;
     }
-    else
+
+    //explicit memory operands, string instructions only write their destination
+    const auto & x86 = cp.x86();
+    bool stringop = id == X86_INS_STOSB || id == X86_INS_STOSW || id == X86_INS_STOSD || id == X86_INS_STOSQ ||
+                    id == X86_INS_MOVSB || id == X86_INS_MOVSW || id == X86_INS_MOVSD || id == X86_INS_MOVSQ;
+    for(int i = 0; i < x86.op_count; i++)
     {
-        HistoryClear();
-        dputs("Cannot restore last instruction.");
+        const auto & op = x86.operands[i];
+        if(op.type != X86_OP_MEM || (stringop && i))
+            continue;
+        duint addr = cp.ResolveOpValue(i, [&](x86_reg reg)
+        {
+            return historyregister(context, cp, reg);
+        });
+#ifdef _WIN64
+        if(op.mem.segment == X86_REG_GS)
+#else //x86
+        if(op.mem.segment == X86_REG_FS)
+#endif //_WIN64
+            addr += ThreadGetLocalBase(ThreadGetId(hActiveThread));
+        duint size = op.size;
+        switch(id)
+        {
+        case X86_INS_FXSAVE:
+        case X86_INS_FXSAVE64:
+        case X86_INS_FNSAVE:
+            size = 512;
+            break;
+        case X86_INS_XSAVE:
+        case X86_INS_XSAVE64:
+        case X86_INS_XSAVEOPT:
+        case X86_INS_XSAVEOPT64:
+            size = 4096;
+            break;
+        default:
+            if(!size)
+                size = sizeof(duint);
+            break;
+        }
+        if(stringop && (x86.prefix[0] == X86_PREFIX_REP || x86.prefix[0] == X86_PREFIX_REPNE))
+        {
+            auto count = context.ccx;
+            if(count > HISTORY_MAX_PREIMAGE / size)
+                return false;
+            if(context.eflags & (1 << 10)) //direction flag: the destination moves down
+                addr -= (count ? count - 1 : 0) * size;
+            size *= count;
+        }
+        if(size)
+            writes.push_back({ addr, (unsigned int)size });
     }
+    return true;
 }
 
-HistoryContext::~HistoryContext()
+static size_t historybudget()
 {
+    duint setting = 0;
+    if(!BridgeSettingGetUint("Engine", "HistoryBudget", &setting) || !setting)
+        setting = HISTORY_DEFAULT_BUDGET;
+    return size_t(setting) * 1024 * 1024;
+}
+
+/**
+\brief Reserves space for a record, dropping the oldest records when the budget is exhausted.
+\return Pointer to the reserved space or nullptr if the record can never fit.
+*/
+static unsigned char* historyreserve(size_t size)
+{
+    if(historyRecords.empty()) //apply a changed budget
+    {
+        auto budget = historybudget();
+        if(historyData.size() != budget)
+            std::vector<unsigned char>(budget).swap(historyData);
+    }
+    if(size > historyData.size() / 2)
+        return nullptr;
+    if(historyHead + size > historyData.size())
+    {
+        //wrap around, the records at the end of the buffer are older than the ones at the start
+        while(!historyRecords.empty() && historyRecords.front() >= historyHead)
+            historyRecords.pop_front();
+        historyHead = 0;
+    }
+    while(!historyRecords.empty() && historyRecords.front() >= historyHead && historyRecords.front() < historyHead + size)
+        historyRecords.pop_front();
+    return historyData.data() + historyHead;
 }
 
 void HistoryAdd()
 {
-    if(history.size() > HistoryMaxCount)
-        history.pop_front();
-    history.emplace_back();
+    TITAN_ENGINE_CONTEXT_t context;
+    if(!GetFullContextDataEx(hActiveThread, &context))
+        memset(&context, 0, sizeof(context));
+    std::vector<HistoryPreImage> writes;
+    unsigned short flags = 0;
+    if(!context.cip || !MemIsValidReadPtr(context.cip) || !historywrites(context, writes))
+        flags |= HistoryInvalid;
+    if(historyRecords.empty())
+        flags |= HistoryFirst;
+
+    //words in which the previous context differs from the new one
+    std::vector<unsigned short> regindex;
+    if(!(flags & HistoryFirst))
+    {
+        auto oldwords = (const HistoryWord*)&historyContext;
+        auto newwords = (const HistoryWord*)&context;
+        for(size_t i = 0; i < HistoryContextWords; i++)
+            if(oldwords[i] != newwords[i])
+                regindex.push_back((unsigned short)i);
+    }
+
+    size_t size = sizeof(HistoryRecord) + regindex.size() * (sizeof(unsigned short) + sizeof(HistoryWord));
+    for(const auto & write : writes)
+        size += sizeof(HistoryPreImage) + write.size;
+    size = (size + sizeof(duint) - 1) & ~(sizeof(duint) - 1);
+
+    auto data = historyreserve(size);
+    if(!data)
+    {
+        //the writes of this instruction exceed the budget, history cannot go past it
+        HistoryClear();
+        return;
+    }
+    HistoryRecord record;
+    record.size = (unsigned int)size;
+    record.flags = flags;
+    record.regcount = (unsigned short)regindex.size();
+    record.memcount = (unsigned int)writes.size();
+    auto ptr = data + sizeof(HistoryRecord);
+    if(!regindex.empty())
+    {
+        memcpy(ptr, regindex.data(), regindex.size() * sizeof(unsigned short));
+        ptr += regindex.size() * sizeof(unsigned short);
+        auto oldwords = (const HistoryWord*)&historyContext;
+        for(auto index : regindex)
+        {
+            memcpy(ptr, &oldwords[index], sizeof(HistoryWord));
+            ptr += sizeof(HistoryWord);
+        }
+    }
+    for(const auto & write : writes)
+    {
+        memcpy(ptr, &write, sizeof(write));
+        ptr += sizeof(write);
+        if(!MemRead(write.addr, ptr, write.size))
+            record.flags |= HistoryInvalid;
+        ptr += write.size;
+    }
+    memcpy(data, &record, sizeof(record));
+
+    historyRecords.push_back(historyHead);
+    historyHead += size;
+    historyContext = context;
 }
 
 void HistoryRestore()
 {
-    if(!history.empty())
+    if(historyRecords.empty())
     {
-        history.back().restore();
-        history.pop_back();
-    }
-    else
         dputs("History record is empty");
+        return;
+    }
+
+    auto data = historyData.data() + historyRecords.back();
+    HistoryRecord record;
+    memcpy(&record, data, sizeof(record));
+    if(record.flags & HistoryInvalid)
+    {
+        HistoryClear();
+        dputs("Cannot restore last instruction.");
+        return;
+    }
+
+    //restore the memory in reverse order, in case the writes overlap
+    std::vector<const unsigned char*> preimages;
+    auto ptr = data + sizeof(HistoryRecord) + record.regcount * (sizeof(unsigned short) + sizeof(HistoryWord));
+    for(unsigned int i = 0; i < record.memcount; i++)
+    {
+        HistoryPreImage preimage;
+        memcpy(&preimage, ptr, sizeof(preimage));
+        preimages.push_back(ptr);
+        ptr += sizeof(preimage) + preimage.size;
+    }
+    for(auto itr = preimages.rbegin(); itr != preimages.rend(); ++itr)
+    {
+        HistoryPreImage preimage;
+        memcpy(&preimage, *itr, sizeof(preimage));
+        MemWrite(preimage.addr, *itr + sizeof(preimage), preimage.size);
+    }
+    SetFullContextDataEx(hActiveThread, &historyContext);
+
+    //go back to the context of the previous record
+    if(!(record.flags & HistoryFirst))
+    {
+        auto words = (HistoryWord*)&historyContext;
+        auto indices = data + sizeof(HistoryRecord);
+        auto values = indices + record.regcount * sizeof(unsigned short);
+        for(unsigned short i = 0; i < record.regcount; i++)
+        {
+            unsigned short index;
+            memcpy(&index, indices + i * sizeof(unsigned short), sizeof(index));
+            memcpy(&words[index], values + i * sizeof(HistoryWord), sizeof(HistoryWord));
+        }
+    }
+    historyHead = historyRecords.back();
+    historyRecords.pop_back();
+
+    cbWatchdog(0, nullptr);
+    DebugUpdateGui(GetContextDataEx(hActiveThread, UE_CIP), true);
 }
 
 bool HistoryIsEmpty()
 {
-    return history.empty();
+    return historyRecords.empty();
 }
 
 void HistoryClear()
 {
-    history.clear();
+    historyRecords.clear();
+    historyHead = 0;
 }
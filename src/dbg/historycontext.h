@@ -2,30 +2,6 @@
 #define HISTORYCONTEXT_H
 
 #include "debugger.h"
-#include <capstone_wrapper.h>
-
-/**
- * @brief The class used to hold history context.
-**/
-class HistoryContext
-{
-public:
-    HistoryContext();
-    ~HistoryContext();
-    HistoryContext(const HistoryContext & copy);
-
-    void restore();
-
-protected:
-    TITAN_ENGINE_CONTEXT_t registers;
-    struct ChangedData
-    {
-        duint addr;
-        char oldvalue[32];
-    };
-    std::vector<ChangedData> ChangedLocation;
-    bool invalid;
-};
 
 void HistoryAdd();
 void HistoryRestore();
@@ -0,0 +1,184 @@
+/**
+@file hitlog.cpp
+
+@brief Writes a fixed-size binary record for every breakpoint hit to a memory-mapped file.
+*/
+
+#include "hitlog.h"
+#include "expressionparser.h"
+#include "value.h"
+#include "debugger.h"
+#include "console.h"
+#include "threading.h"
+
+static_assert(sizeof(HITLOGHEADER) % sizeof(HITLOGRECORD) == 0, "records must not cross a chunk boundary");
+
+// The file is mapped one chunk at a time and grows by one chunk when it is full
+#define HITLOG_CHUNK (16 * 1024 * 1024)
+
+static HANDLE hitlogFile = INVALID_HANDLE_VALUE;
+static HANDLE hitlogMapping = nullptr;
+static HITLOGHEADER* hitlogHeader = nullptr; // view of the header (in the first chunk)
+static unsigned char* hitlogChunk = nullptr; // view of the chunk that is being written
+static unsigned long long hitlogChunkOffset = 0;
+static unsigned long long hitlogOffset = 0; // file offset of the next record
+static std::vector<ExpressionParser> hitlogExpressions;
+
+static void hitlogunmap()
+{
+    if(hitlogChunk)
+        UnmapViewOfFile(hitlogChunk);
+    hitlogChunk = nullptr;
+    if(hitlogHeader)
+        UnmapViewOfFile(hitlogHeader);
+    hitlogHeader = nullptr;
+    if(hitlogMapping)
+        CloseHandle(hitlogMapping);
+    hitlogMapping = nullptr;
+}
+
+/**
+\brief Maps the chunk that contains a file offset, growing the file if needed.
+*/
+static bool hitlogmap(unsigned long long Offset)
+{
+    auto chunkOffset = Offset - Offset % HITLOG_CHUNK;
+    auto size = chunkOffset + HITLOG_CHUNK;
+    hitlogunmap();
+    hitlogMapping = CreateFileMappingW(hitlogFile, nullptr, PAGE_READWRITE, DWORD(size >> 32), DWORD(size), nullptr);
+    if(!hitlogMapping)
+        return false;
+    hitlogHeader = (HITLOGHEADER*)MapViewOfFile(hitlogMapping, FILE_MAP_WRITE, 0, 0, sizeof(HITLOGHEADER));
+    hitlogChunk = (unsigned char*)MapViewOfFile(hitlogMapping, FILE_MAP_WRITE, DWORD(chunkOffset >> 32), DWORD(chunkOffset), HITLOG_CHUNK);
+    hitlogChunkOffset = chunkOffset;
+    return hitlogHeader && hitlogChunk;
+}
+
+bool HitLogStart(const char* FileName, const std::vector<String> & Expressions)
+{
+    EXCLUSIVE_ACQUIRE(LockHitLog);
+    HitLogStop();
+    if(Expressions.size() > HITLOG_MAX_VALUES)
+        return false;
+    for(const auto & expression : Expressions)
+    {
+        if(expression.length() >= HITLOG_MAX_EXPRESSION)
+            return false;
+        ExpressionParser parser(expression);
+        if(!parser.IsValidExpression())
+            return false;
+        hitlogExpressions.push_back(parser);
+    }
+    hitlogFile = CreateFileW(StringUtils::Utf8ToUtf16(FileName).c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, 0, nullptr);
+    if(hitlogFile == INVALID_HANDLE_VALUE || !hitlogmap(0))
+    {
+        HitLogStop();
+        return false;
+    }
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    memset(hitlogHeader, 0, sizeof(HITLOGHEADER));
+    memcpy(hitlogHeader->magic, "XHL1", 4);
+    hitlogHeader->recordSize = sizeof(HITLOGRECORD);
+    hitlogHeader->frequency = frequency.QuadPart;
+    hitlogHeader->valueCount = (unsigned int)Expressions.size();
+    for(size_t i = 0; i < Expressions.size(); i++)
+        strcpy_s(hitlogHeader->expressions[i], Expressions[i].c_str());
+    hitlogOffset = sizeof(HITLOGHEADER);
+    return true;
+}
+
+/**
+\brief Stops writing the hit log and truncates the file to the written records.
+\return The number of records in the file.
+*/
+unsigned long long HitLogStop()
+{
+    EXCLUSIVE_ACQUIRE(LockHitLog);
+    unsigned long long count = hitlogHeader ? hitlogHeader->recordCount : 0;
+    hitlogunmap();
+    if(hitlogFile != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER end;
+        end.QuadPart = hitlogOffset;
+        SetFilePointerEx(hitlogFile, end, nullptr, FILE_BEGIN);
+        SetEndOfFile(hitlogFile);
+        CloseHandle(hitlogFile);
+    }
+    hitlogFile = INVALID_HANDLE_VALUE;
+    hitlogOffset = 0;
+    hitlogExpressions.clear();
+    return count;
+}
+
+bool HitLogEnabled()
+{
+    return hitlogChunk != nullptr;
+}
+
+/**
+\brief Writes a record for a breakpoint hit. The log can be started and stopped by commands while breakpoints are hit, so the mapping is only used with LockHitLog held.
+\param Bp The breakpoint that was hit.
+\param Address The address of the breakpoint.
+*/
+void HitLogAdd(const BREAKPOINT & Bp, duint Address)
+{
+    EXCLUSIVE_ACQUIRE(LockHitLog);
+    if(!hitlogChunk)
+        return;
+    if(hitlogOffset - hitlogChunkOffset >= HITLOG_CHUNK && !hitlogmap(hitlogOffset))
+    {
+        dputs("Failed to grow the hit log, it has been stopped");
+        HitLogStop();
+        return;
+    }
+    auto record = (HITLOGRECORD*)(hitlogChunk + (hitlogOffset - hitlogChunkOffset));
+    LARGE_INTEGER timestamp;
+    QueryPerformanceCounter(&timestamp);
+    record->timestamp = timestamp.QuadPart;
+    record->address = Address;
+    record->threadId = ((DEBUG_EVENT*)GetDebugData())->dwThreadId;
+    record->hitcount = Bp.hitcount;
+    record->type = (unsigned char)Bp.type;
+    record->valueMask = 0;
+    for(size_t i = 0; i < hitlogExpressions.size(); i++)
+    {
+        duint value = 0;
+        if(hitlogExpressions[i].Calculate(value, valuesignedcalc(), false))
+            record->valueMask |= 1 << i;
+        record->values[i] = value;
+    }
+    hitlogOffset += sizeof(HITLOGRECORD);
+    hitlogHeader->recordCount++;
+}
+
+/**
+\brief Reads the records of a hit log file.
+\param FileName The file to read.
+\param [out] Header The header of the file.
+\param CbRecord Called for every record, return false to stop reading.
+\return true if the file is a valid hit log.
+*/
+bool HitLogRead(const char* FileName, HITLOGHEADER & Header, const std::function<bool(const HITLOGRECORD &)> & CbRecord)
+{
+    Handle hFile = CreateFileW(StringUtils::Utf8ToUtf16(FileName).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(!hFile)
+        return false;
+    DWORD read = 0;
+    if(!ReadFile(hFile, &Header, sizeof(Header), &read, nullptr) || read != sizeof(Header) || memcmp(Header.magic, "XHL1", 4) != 0 || Header.recordSize != sizeof(HITLOGRECORD))
+        return false;
+    std::vector<HITLOGRECORD> records(4096);
+    auto remaining = Header.recordCount; //the file of a running log is larger than its records
+    while(remaining)
+    {
+        auto count = DWORD(min(remaining, (unsigned long long)records.size()));
+        if(!ReadFile(hFile, records.data(), count * sizeof(HITLOGRECORD), &read, nullptr) || !read)
+            break;
+        count = read / sizeof(HITLOGRECORD);
+        for(DWORD i = 0; i < count; i++)
+            if(!CbRecord(records[i]))
+                return true;
+        remaining -= count;
+    }
+    return true;
+}
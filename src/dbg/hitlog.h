@@ -0,0 +1,42 @@
+#ifndef _HITLOG_H
+#define _HITLOG_H
+
+#include "_global.h"
+#include "breakpoint.h"
+
+#define HITLOG_MAX_VALUES 4
+#define HITLOG_MAX_EXPRESSION 64
+
+// Header of a hit log file, followed by an array of HITLOGRECORD
+struct HITLOGHEADER
+{
+    char magic[4]; // "XHL1"
+    unsigned int recordSize;
+    unsigned long long frequency; // performance counter ticks per second
+    unsigned long long recordCount;
+    unsigned int valueCount;
+    unsigned int reserved;
+    char expressions[HITLOG_MAX_VALUES][HITLOG_MAX_EXPRESSION];
+    char padding[32]; // records are aligned to their size
+};
+
+// One breakpoint hit
+struct HITLOGRECORD
+{
+    unsigned long long timestamp; // performance counter ticks
+    unsigned long long address; // breakpoint address, together with the type this identifies the breakpoint
+    unsigned long long values[HITLOG_MAX_VALUES];
+    unsigned int threadId;
+    unsigned int hitcount;
+    unsigned char type; // BP_TYPE
+    unsigned char valueMask; // bit n is set when values[n] could be evaluated
+    unsigned char reserved[6];
+};
+
+bool HitLogStart(const char* FileName, const std::vector<String> & Expressions);
+unsigned long long HitLogStop();
+bool HitLogEnabled();
+void HitLogAdd(const BREAKPOINT & Bp, duint Address);
+bool HitLogRead(const char* FileName, HITLOGHEADER & Header, const std::function<bool(const HITLOGRECORD &)> & CbRecord);
+
+#endif // _HITLOG_H
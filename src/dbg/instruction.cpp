@@ -39,10 +39,15 @@
 #include "xrefsanalysis.h"
 #include "advancedanalysis.h"
 #include "exhandlerinfo.h"
+#include "analysiscache.h"
 #include "symbolinfo.h"
 #include "argument.h"
 #include "historycontext.h"
 #include "exception.h"
+#include "memsnapshot.h"
+#include "hashing.h"
+#include "murmurhash.h"
+#include <cmath>
 
 static bool bRefinit = false;
 static int maxFindResults = 5000;
@@ -438,6 +443,16 @@ CMDRESULT cbInstrLoaddb(int argc, char* argv[])
 
 CMDRESULT cbInstrSavedb(int argc, char* argv[])
 {
+    if(argc > 1) //export in the JSON text format
+    {
+        if(!DbExportJson(argv[1]))
+        {
+            dprintf("Failed to export database to \"%s\"!\n", argv[1]);
+            return STATUS_ERROR;
+        }
+        dprintf("Database exported to \"%s\"\n", argv[1]);
+        return STATUS_CONTINUE;
+    }
     DbSave(DbLoadSaveType::All);
     return STATUS_CONTINUE;
 }
@@ -1045,27 +1060,38 @@ bool cbRefStr(Capstone* disasm, BASIC_INSTRUCTION_INFO* basicinfo, REFINFO* refi
     char string[MAX_STRING_SIZE] = "";
     if(basicinfo->branch)  //branches have no strings (jmp dword [401000])
         return false;
+    if(!(basicinfo->type & (TYPE_VALUE | TYPE_MEMORY)))
+        return false;
+    // Resolve operand targets against a local copy of the module containing the instruction
+    auto snapshot = (MemSnapshot*)refinfo->userinfo;
+    duint cip = duint(disasm->Address());
+    if(snapshot && !snapshot->Contains(cip))
+    {
+        if(!snapshot->SnapshotModule(cip))
+        {
+            duint regionSize = 0;
+            duint regionBase = MemFindBaseAddr(cip, &regionSize);
+            if(regionBase)
+                snapshot->Snapshot(regionBase, regionSize);
+        }
+    }
     if((basicinfo->type & TYPE_VALUE) == TYPE_VALUE)
     {
-        if(DbgGetStringAt(basicinfo->value.value, string))
+        if(disasmgetstringatwrapper(basicinfo->value.value, string, snapshot))
             found = true;
     }
     if((basicinfo->type & TYPE_MEMORY) == TYPE_MEMORY)
     {
-        if(DbgGetStringAt(basicinfo->memory.value, string))
+        if(disasmgetstringatwrapper(basicinfo->memory.value, string, snapshot))
             found = true;
     }
     if(found)
     {
         char addrText[20] = "";
-        sprintf(addrText, fhex, disasm->Address());
+        sprintf(addrText, fhex, cip);
         GuiReferenceSetRowCount(refinfo->refcount + 1);
         GuiReferenceSetCellContent(refinfo->refcount, 0, addrText);
-        char disassembly[4096] = "";
-        if(GuiGetDisassembly((duint)disasm->Address(), disassembly))
-            GuiReferenceSetCellContent(refinfo->refcount, 1, disassembly);
-        else
-            GuiReferenceSetCellContent(refinfo->refcount, 1, disasm->InstructionText().c_str());
+        GuiReferenceSetCellContent(refinfo->refcount, 1, disasm->InstructionText().c_str());
         GuiReferenceSetCellContent(refinfo->refcount, 2, string);
     }
     return found;
@@ -1089,7 +1115,8 @@ CMDRESULT cbInstrRefStr(int argc, char* argv[])
             refFindType = CURRENT_REGION;
 
     duint ticks = GetTickCount();
-    int found = RefFind(addr, size, cbRefStr, 0, false, "Strings", (REFFINDTYPE)refFindType, false);
+    MemSnapshot snapshot;
+    int found = RefFind(addr, size, cbRefStr, &snapshot, false, "Strings", (REFFINDTYPE)refFindType, false);
     dprintf("%u string(s) in %ums\n", found, GetTickCount() - ticks);
     varset("$result", found, false);
     return STATUS_CONTINUE;
@@ -1467,6 +1494,88 @@ CMDRESULT cbInstrFindMemAll(int argc, char* argv[])
     return STATUS_CONTINUE;
 }
 
+CMDRESULT cbInstrFindAllMulti(int argc, char* argv[]) //findallmulti scope, pattern1[, pattern2...]
+{
+    if(argc < 3)
+    {
+        dputs("not enough arguments!");
+        return STATUS_ERROR;
+    }
+    std::vector<SimplePage> searchPages;
+    if(!MemFindScopePages(argv[1], searchPages))
+    {
+        dprintf("invalid search scope \"%s\"!\n", argv[1]);
+        return STATUS_ERROR;
+    }
+    std::vector<String> patternTexts;
+    std::vector<std::vector<PatternByte>> searchpatterns;
+    for(int i = 2; i < argc; i++)
+    {
+        //remove # from the start and end of the pattern (ODBGScript support)
+        String pattern = argv[i][0] == '#' ? argv[i] + 1 : argv[i];
+        if(pattern.length() && pattern.back() == '#')
+            pattern.pop_back();
+        std::vector<PatternByte> searchpattern;
+        if(!patterntransform(pattern, searchpattern))
+        {
+            dprintf("failed to transform pattern \"%s\"!\n", argv[i]);
+            return STATUS_ERROR;
+        }
+        patternTexts.push_back(pattern);
+        searchpatterns.push_back(std::move(searchpattern));
+    }
+
+    //setup reference view
+    char patterntitle[256] = "";
+    sprintf_s(patterntitle, "Patterns: %d (%s)", int(searchpatterns.size()), argv[1]);
+    GuiReferenceInitialize(patterntitle);
+    GuiReferenceAddColumn(2 * sizeof(duint), "Address");
+    GuiReferenceAddColumn(32, "Pattern");
+    GuiReferenceAddColumn(0, "Disassembly");
+    GuiReferenceSetRowCount(0);
+    GuiReferenceReloadData();
+
+    DWORD ticks = GetTickCount();
+    int refCount = 0;
+    std::vector<MemFindMatch> results;
+    MemFindPatternsInMap(searchPages, searchpatterns, results, maxFindResults, [&](const std::vector<MemFindMatch> & matches, duint bytesDone, duint bytesTotal)
+    {
+        //stream the new matches to the reference view
+        if(matches.size())
+        {
+            GuiReferenceSetRowCount(refCount + int(matches.size()));
+            for(const auto & match : matches)
+            {
+                char msg[deflen] = "";
+                sprintf(msg, fhex, match.address);
+                GuiReferenceSetCellContent(refCount, 0, msg);
+                GuiReferenceSetCellContent(refCount, 1, patternTexts[match.pattern].c_str());
+                if(!GuiGetDisassembly(match.address, msg))
+                    strcpy_s(msg, "[Error disassembling]");
+                GuiReferenceSetCellContent(refCount, 2, msg);
+                refCount++;
+            }
+            GuiReferenceReloadData();
+        }
+        DWORD elapsed = max(GetTickCount() - ticks, DWORD(1));
+        int percent = bytesTotal ? int(floor((double(bytesDone) / double(bytesTotal)) * 100.0)) : 100;
+        char task[deflen] = "";
+        sprintf_s(task, "%.1f MB/s", double(bytesDone) / 1048576.0 / (elapsed / 1000.0));
+        GuiReferenceSetCurrentTaskProgress(percent, task);
+        GuiReferenceSetProgress(percent);
+    });
+    GuiReferenceSetProgress(100);
+    GuiReferenceReloadData();
+
+    duint bytesTotal = 0;
+    for(const auto & page : searchPages)
+        bytesTotal += page.size;
+    DWORD elapsed = max(GetTickCount() - ticks, DWORD(1));
+    dprintf("%d occurrences found in %ums (%.1f MB/s)\n", refCount, elapsed, double(bytesTotal) / 1048576.0 / (elapsed / 1000.0));
+    varset("$result", refCount, false);
+    return STATUS_CONTINUE;
+}
+
 static bool cbModCallFind(Capstone* disasm, BASIC_INSTRUCTION_INFO* basicinfo, REFINFO* refinfo)
 {
     if(!disasm || !basicinfo)  //initialize
@@ -1509,6 +1618,243 @@ static bool cbModCallFind(Capstone* disasm, BASIC_INSTRUCTION_INFO* basicinfo, R
     return found;
 }
 
+CMDRESULT cbInstrEntropyMap(int argc, char* argv[]) //entropymap [minimum entropy in percent]
+{
+    duint minEntropy = 0;
+    if(argc > 1 && !valfromstring(argv[1], &minEntropy))
+        return STATUS_ERROR;
+
+    struct EntropyRegion
+    {
+        duint address;
+        duint size;
+        String info;
+    };
+    std::vector<EntropyRegion> regions;
+    SHARED_ACQUIRE(LockMemoryPages);
+    for(auto & itr : memoryPages)
+    {
+        if(itr.second.mbi.State != MEM_COMMIT)
+            continue;
+        regions.push_back({ duint(itr.second.mbi.BaseAddress), itr.second.mbi.RegionSize, itr.second.info });
+    }
+    SHARED_RELEASE();
+
+    //the entropy of c occurrences out of n is based on c*log(c), precompute it for every count in a page
+    static std::vector<double> xlogx;
+    if(xlogx.empty())
+    {
+        xlogx.resize(PAGE_SIZE + 1);
+        for(size_t i = 1; i < xlogx.size(); i++)
+            xlogx[i] = double(i) * log(double(i));
+    }
+
+    GuiReferenceInitialize("Entropy");
+    GuiReferenceAddColumn(2 * sizeof(duint), "Address");
+    GuiReferenceAddColumn(8, "Entropy");
+    GuiReferenceAddColumn(0, "Info");
+    GuiReferenceReloadData();
+
+    DWORD ticks = GetTickCount();
+    int refCount = 0;
+    const duint chunkSize = 256 * PAGE_SIZE;
+    std::vector<unsigned char> data;
+    std::vector<bool> pageRead;
+    for(const auto & region : regions)
+    {
+        for(duint chunk = 0; chunk < region.size; chunk += chunkSize)
+        {
+            data.resize(min(chunkSize, region.size - chunk));
+            if(!MemReadPages(region.address + chunk, data.data(), data.size(), pageRead))
+                continue;
+            for(duint offset = 0; offset + PAGE_SIZE <= data.size(); offset += PAGE_SIZE)
+            {
+                if(!pageRead[size_t(offset / PAGE_SIZE)])
+                    continue; //unreadable pages have no entropy
+                duint occurrences[256] = {};
+                for(duint i = 0; i < PAGE_SIZE; i++)
+                    occurrences[data[offset + i]]++;
+                double sum = 0.0;
+                for(auto count : occurrences)
+                    sum += xlogx[count];
+                double entropy = (log(double(PAGE_SIZE)) - sum / PAGE_SIZE) / log(256.0);
+                if(entropy * 100.0 < double(minEntropy))
+                    continue;
+
+                char msg[deflen] = "";
+                GuiReferenceSetRowCount(refCount + 1);
+                sprintf_s(msg, fhex, region.address + chunk + offset);
+                GuiReferenceSetCellContent(refCount, 0, msg);
+                sprintf_s(msg, "%.3f", entropy);
+                GuiReferenceSetCellContent(refCount, 1, msg);
+                GuiReferenceSetCellContent(refCount, 2, region.info.c_str());
+                refCount++;
+            }
+        }
+    }
+
+    GuiReferenceReloadData();
+    dprintf("%d page(s) listed in %ums\n", refCount, GetTickCount() - ticks);
+    varset("$result", refCount, false);
+    return STATUS_CONTINUE;
+}
+
+CMDRESULT cbInstrModStats(int argc, char* argv[])
+{
+    GuiReferenceInitialize("Modules");
+    GuiReferenceAddColumn(2 * sizeof(duint), "Base");
+    GuiReferenceAddColumn(20, "Module");
+    GuiReferenceAddColumn(12, "Load time (us)");
+    GuiReferenceAddColumn(12, "Memory");
+    GuiReferenceAddColumn(0, "Imports");
+    GuiReferenceReloadData();
+
+    int refCount = 0;
+    duint totalTime = 0;
+    duint totalMemory = 0;
+    ModEnum([&](const MODINFO & mod)
+    {
+        char msg[deflen] = "";
+        duint memory = ModMemoryUsage(mod);
+        GuiReferenceSetRowCount(refCount + 1);
+        sprintf_s(msg, fhex, mod.base);
+        GuiReferenceSetCellContent(refCount, 0, msg);
+        sprintf_s(msg, "%s%s", mod.name, mod.extension);
+        GuiReferenceSetCellContent(refCount, 1, msg);
+        sprintf_s(msg, "%llu", (unsigned long long)mod.loadTime);
+        GuiReferenceSetCellContent(refCount, 2, msg);
+        sprintf_s(msg, "%llu", (unsigned long long)memory);
+        GuiReferenceSetCellContent(refCount, 3, msg);
+        if(mod.importsParsed)
+            sprintf_s(msg, "%llu", (unsigned long long)mod.imports.size());
+        else
+            strcpy_s(msg, "not parsed");
+        GuiReferenceSetCellContent(refCount, 4, msg);
+        totalTime += mod.loadTime;
+        totalMemory += memory;
+        refCount++;
+    });
+
+    GuiReferenceReloadData();
+    dprintf("%d module(s), loaded in %llums, using %llu bytes\n", refCount, (unsigned long long)totalTime / 1000, (unsigned long long)totalMemory);
+    for(int i = 0; i < int(ModLoadStage::Count); i++)
+    {
+        duint count, time;
+        ModStageStatistics(ModLoadStage(i), count, time);
+        dprintf("  %-16s %llu run(s) in %llums\n", ModStageName(ModLoadStage(i)), (unsigned long long)count, (unsigned long long)time / 1000);
+    }
+    varset("$result", refCount, false);
+    return STATUS_CONTINUE;
+}
+
+CMDRESULT cbInstrHashBench(int argc, char* argv[]) //hashbench [size in MB]
+{
+#ifdef _WIN64
+    const duint maxMegabytes = 1024;
+#else
+    const duint maxMegabytes = 256; //the address space of the debugger is small
+#endif //_WIN64
+    duint megabytes = 64;
+    if(argc > 1 && (!valfromstring(argv[1], &megabytes) || !megabytes || megabytes > maxMegabytes))
+    {
+        dprintf("Invalid size (1-%u MB)!\n", (unsigned int)maxMegabytes);
+        return STATUS_ERROR;
+    }
+
+    //random data, so no hash can take a shortcut
+    std::vector<unsigned char> data(size_t(megabytes * 1024 * 1024));
+    unsigned int seed = 0x1337;
+    for(auto & byte : data)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        byte = (unsigned char)seed;
+    }
+
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    auto bench = [&](const char* name, const std::function<unsigned long long()> & hash)
+    {
+        LARGE_INTEGER start, end;
+        QueryPerformanceCounter(&start);
+        unsigned long long result = hash();
+        QueryPerformanceCounter(&end);
+        double seconds = double(end.QuadPart - start.QuadPart) / double(frequency.QuadPart);
+        dprintf("%-20s %8.0f MB/s %016llX\n", name, seconds > 0 ? double(megabytes) / seconds : 0.0, result);
+    };
+
+    bench("MurmurHash3_x86_32", [&]()
+    {
+        unsigned int hash;
+        MurmurHash3_x86_32(data.data(), int(data.size()), 0, &hash);
+        return (unsigned long long)hash;
+    });
+    bench("MurmurHash3_x64_128", [&]()
+    {
+        unsigned long long hash[2];
+        MurmurHash3_x64_128(data.data(), int(data.size()), 0, hash);
+        return hash[0];
+    });
+    bench("Hash64", [&]()
+    {
+        return Hash64(data.data(), data.size());
+    });
+    bench("Hash128", [&]()
+    {
+        unsigned long long hash[2];
+        Hash128(data.data(), data.size(), 0, hash);
+        return hash[0];
+    });
+    bench("Hash64 (streaming)", [&]()
+    {
+        //odd chunk size, so most updates continue an incomplete stripe
+        HashState state;
+        HashInit(state);
+        for(size_t i = 0; i < data.size(); i += 4093)
+            HashUpdate(state, data.data() + i, min(size_t(4093), data.size() - i));
+        return HashFinal(state);
+    });
+    bench("Page fingerprints", [&]()
+    {
+        unsigned long long combined = 0;
+        for(size_t i = 0; i + PAGE_SIZE <= data.size(); i += PAGE_SIZE)
+            combined ^= Hash64(data.data() + i, PAGE_SIZE);
+        return combined;
+    });
+
+    //fingerprint the pages of the module at cip, this includes reading the debuggee memory
+    if(DbgIsDebugging())
+    {
+        duint cip = GetContextDataEx(hActiveThread, UE_CIP);
+        duint base = ModBaseFromAddr(cip);
+        duint size = ModSizeFromAddr(cip);
+        if(!base)
+            base = MemFindBaseAddr(cip, &size);
+        std::vector<unsigned long long> fingerprints;
+        LARGE_INTEGER start, end;
+        QueryPerformanceCounter(&start);
+        HashMemoryPages(base, size, fingerprints);
+        QueryPerformanceCounter(&end);
+        auto unreadable = std::count(fingerprints.begin(), fingerprints.end(), 0ull);
+        double seconds = double(end.QuadPart - start.QuadPart) / double(frequency.QuadPart);
+        dprintf("%-20s %8.0f MB/s %d page(s) at " fhex ", %d unreadable\n", "HashMemoryPages", seconds > 0 ? double(size) / (1024 * 1024) / seconds : 0.0, int(fingerprints.size()), base, int(unreadable));
+    }
+    return STATUS_CONTINUE;
+}
+
+CMDRESULT cbInstrGraphBench(int argc, char* argv[]) //graphbench [block count]
+{
+    duint blocks = 10000;
+    if(argc > 1 && (!valfromstring(argv[1], &blocks) || blocks < 2 || blocks > 100000))
+    {
+        dputs("Invalid block count (2-100000)!");
+        return STATUS_ERROR;
+    }
+    GuiBenchmarkGraphLayout(int(blocks));
+    return STATUS_CONTINUE;
+}
+
 CMDRESULT cbInstrModCallFind(int argc, char* argv[])
 {
     duint addr;
@@ -2263,6 +2609,7 @@ CMDRESULT cbInstrAnalyse(int argc, char* argv[])
     LinearAnalysis anal(base, size);
     anal.Analyse();
     anal.SetMarkers();
+    AnalysisCacheSave(base);
     GuiUpdateAllViews();
     return STATUS_CONTINUE;
 }
@@ -2276,6 +2623,7 @@ CMDRESULT cbInstrAnalyseadv(int argc, char* argv[])
     AdvancedAnalysis anal(base, size);
     anal.Analyse();
     anal.SetMarkers();
+    AnalysisCacheSave(base);
     GuiUpdateAllViews();
     return STATUS_CONTINUE;
 }
@@ -2292,6 +2640,7 @@ CMDRESULT cbInstrCfanalyse(int argc, char* argv[])
     ControlFlowAnalysis anal(base, size, exceptionDirectory);
     anal.Analyse();
     anal.SetMarkers();
+    AnalysisCacheSave(base);
     GuiUpdateAllViews();
     return STATUS_CONTINUE;
 }
@@ -2305,6 +2654,7 @@ CMDRESULT cbInstrExanalyse(int argc, char* argv[])
     ExceptionDirectoryAnalysis anal(base, size);
     anal.Analyse();
     anal.SetMarkers();
+    AnalysisCacheSave(base);
     GuiUpdateAllViews();
     return STATUS_CONTINUE;
 }
@@ -2323,6 +2673,7 @@ CMDRESULT cbInstrAnalrecur(int argc, char* argv[])
     RecursiveAnalysis analysis(base, size, entry, 0);
     analysis.Analyse();
     analysis.SetMarkers();
+    AnalysisCacheSave(base);
     return STATUS_CONTINUE;
 }
 
@@ -2335,6 +2686,7 @@ CMDRESULT cbInstrAnalxrefs(int argc, char* argv[])
     XrefsAnalysis anal(base, size);
     anal.Analyse();
     anal.SetMarkers();
+    AnalysisCacheSave(base);
     GuiUpdateAllViews();
     return STATUS_CONTINUE;
 }
@@ -2825,13 +3177,31 @@ CMDRESULT cbInstrExinfo(int argc, char* argv[])
     return STATUS_CONTINUE;
 }
 
+// Function graphs built before, only reused while the bytes of their nodes are unchanged
+static std::unordered_map<duint, BridgeCFGraph> graphCache;
+
+static bool graphCacheValid(const BridgeCFGraph & graph)
+{
+    std::vector<unsigned char> data;
+    for(const auto & node : graph.nodes)
+    {
+        const auto & bytes = node.second.data;
+        if(bytes.empty())
+            continue;
+        data.resize(bytes.size());
+        if(!MemRead(node.second.start, data.data(), data.size()) || data != bytes)
+            return false;
+    }
+    return true;
+}
+
 CMDRESULT cbInstrGraph(int argc, char* argv[])
 {
     duint entry;
     if(argc < 2 || !valfromstring(argv[1], &entry))
         entry = GetContextDataEx(hActiveThread, UE_CIP);
-    duint start, size, sel = entry;
-    if(FunctionGet(entry, &start))
+    duint start, end = 0, size, sel = entry;
+    if(FunctionGet(entry, &start, &end))
         entry = start;
     auto base = MemFindBaseAddr(entry, &size);
     if(!base || !MemIsValidReadPtr(entry))
@@ -2841,15 +3211,27 @@ CMDRESULT cbInstrGraph(int argc, char* argv[])
     }
     if(!GuiGraphAt(sel))
     {
-        RecursiveAnalysis analysis(base, size, entry, 0);
-        analysis.Analyse();
-        auto graph = analysis.GetFunctionGraph(entry);
-        if(!graph)
+        auto found = graphCache.find(entry);
+        if(found == graphCache.end() || !graphCacheValid(found->second))
         {
-            dputs("No graph generated...");
-            return STATUS_ERROR;
+            //only read the pages the function touches instead of the whole region
+            RecursiveAnalysis analysis(base, size, entry, 0, false, true);
+            if(end)
+                analysis.Prefetch(entry, end);
+            analysis.Analyse();
+            auto graph = analysis.GetFunctionGraph(entry);
+            if(!graph)
+            {
+                dputs("No graph generated...");
+                return STATUS_ERROR;
+            }
+            if(found != graphCache.end())
+                graphCache.erase(found);
+            else if(graphCache.size() >= 256)
+                graphCache.clear();
+            found = graphCache.insert({ entry, *graph }).first;
         }
-        auto graphList = graph->ToGraphList();
+        auto graphList = found->second.ToGraphList();
         GuiLoadGraph(&graphList, sel);
     }
     GuiUpdateAllViews();
@@ -61,6 +61,11 @@ CMDRESULT cbInstrCopystr(int argc, char* argv[]);
 CMDRESULT cbInstrFind(int argc, char* argv[]);
 CMDRESULT cbInstrFindAll(int argc, char* argv[]);
 CMDRESULT cbInstrFindMemAll(int argc, char* argv[]);
+CMDRESULT cbInstrFindAllMulti(int argc, char* argv[]);
+CMDRESULT cbInstrEntropyMap(int argc, char* argv[]);
+CMDRESULT cbInstrModStats(int argc, char* argv[]);
+CMDRESULT cbInstrHashBench(int argc, char* argv[]);
+CMDRESULT cbInstrGraphBench(int argc, char* argv[]);
 CMDRESULT cbInstrModCallFind(int argc, char* argv[]);
 CMDRESULT cbInstrCommentList(int argc, char* argv[]);
 CMDRESULT cbInstrLabelList(int argc, char* argv[]);
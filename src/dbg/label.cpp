@@ -88,6 +88,11 @@ void LabelCacheLoad(JSON Root)
     labels.CacheLoad(Root, false, "auto"); //legacy support
 }
 
+unsigned int LabelCacheRevision()
+{
+    return labels.Revision();
+}
+
 bool LabelEnum(LABELSINFO* List, size_t* Size)
 {
     return labels.Enum(List, Size);
@@ -16,6 +16,7 @@ bool LabelDelete(duint Address);
 void LabelDelRange(duint Start, duint End, bool Manual);
 void LabelCacheSave(JSON root);
 void LabelCacheLoad(JSON root);
+unsigned int LabelCacheRevision();
 bool LabelEnum(LABELSINFO* List, size_t* Size);
 void LabelClear();
 void LabelGetList(std::vector<LABELSINFO> & list);
@@ -4,6 +4,7 @@
 #include "module.h"
 
 std::map<DepthModuleRange, LOOPSINFO, DepthModuleRangeCompare> loops;
+static unsigned int loopsRevision = 0;
 
 bool LoopAdd(duint Start, duint End, bool Manual)
 {
@@ -47,6 +48,7 @@ bool LoopAdd(duint Start, duint End, bool Manual)
 
     // Insert into list
     loops.insert(std::make_pair(DepthModuleRange(finalDepth, ModuleRange(ModHashFromAddr(moduleBase), Range(loopInfo.start, loopInfo.end))), loopInfo));
+    loopsRevision++;
     return true;
 }
 
@@ -214,6 +216,7 @@ void LoopCacheLoad(JSON Root)
 
     // Remove existing entries
     loops.clear();
+    loopsRevision++;
 
     const JSON jsonLoops = json_object_get(Root, "loops");
     const JSON jsonAutoLoops = json_object_get(Root, "autoloops");
@@ -227,6 +230,67 @@ void LoopCacheLoad(JSON Root)
         AddLoops(jsonAutoLoops, false);
 }
 
+unsigned int LoopCacheRevision()
+{
+    SHARED_ACQUIRE(LockLoops);
+    return loopsRevision;
+}
+
+void LoopCacheSaveModule(JSON Root, const char* Module)
+{
+    SHARED_ACQUIRE(LockLoops);
+
+    const JSON jsonAutoLoops = json_array();
+
+    for(auto & itr : loops)
+    {
+        const LOOPSINFO & currentLoop = itr.second;
+        if(currentLoop.manual || _stricmp(currentLoop.mod, Module))
+            continue;
+
+        JSON currentJson = json_object();
+        json_object_set_new(currentJson, "module", json_string(currentLoop.mod));
+        json_object_set_new(currentJson, "start", json_hex(currentLoop.start));
+        json_object_set_new(currentJson, "end", json_hex(currentLoop.end));
+        json_object_set_new(currentJson, "depth", json_integer(currentLoop.depth));
+        json_object_set_new(currentJson, "parent", json_hex(currentLoop.parent));
+        json_array_append_new(jsonAutoLoops, currentJson);
+    }
+
+    if(json_array_size(jsonAutoLoops))
+        json_object_set(Root, "autoloops", jsonAutoLoops);
+    json_decref(jsonAutoLoops);
+}
+
+void LoopCacheMerge(JSON Root)
+{
+    EXCLUSIVE_ACQUIRE(LockLoops);
+
+    const JSON jsonAutoLoops = json_object_get(Root, "autoloops");
+    size_t i;
+    JSON value;
+    json_array_foreach(jsonAutoLoops, i, value)
+    {
+        LOOPSINFO loopInfo;
+        memset(&loopInfo, 0, sizeof(LOOPSINFO));
+
+        const char* mod = json_string_value(json_object_get(value, "module"));
+        if(mod && strlen(mod) < MAX_MODULE_SIZE)
+            strcpy_s(loopInfo.mod, mod);
+        loopInfo.start = (duint)json_hex_value(json_object_get(value, "start"));
+        loopInfo.end = (duint)json_hex_value(json_object_get(value, "end"));
+        loopInfo.depth = (int)json_integer_value(json_object_get(value, "depth"));
+        loopInfo.parent = (duint)json_hex_value(json_object_get(value, "parent"));
+        loopInfo.manual = false;
+        if(loopInfo.end < loopInfo.start)
+            continue;
+
+        // std::map::insert keeps existing entries
+        if(loops.insert(std::make_pair(DepthModuleRange(loopInfo.depth, ModuleRange(ModHashFromName(loopInfo.mod), Range(loopInfo.start, loopInfo.end))), loopInfo)).second)
+            loopsRevision++;
+    }
+}
+
 bool LoopEnum(LOOPSINFO* List, size_t* Size)
 {
     // If list or size is not requested, fail
@@ -261,4 +325,5 @@ void LoopClear()
 {
     EXCLUSIVE_ACQUIRE(LockLoops);
     loops.clear();
+    loopsRevision++;
 }
\ No newline at end of file
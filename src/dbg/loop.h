@@ -19,6 +19,9 @@ bool LoopOverlaps(int Depth, duint Start, duint End, int* FinalDepth);
 bool LoopDelete(int Depth, duint Address);
 void LoopCacheSave(JSON Root);
 void LoopCacheLoad(JSON Root);
+unsigned int LoopCacheRevision();
+void LoopCacheSaveModule(JSON Root, const char* Module);
+void LoopCacheMerge(JSON Root);
 bool LoopEnum(LOOPSINFO* List, size_t* Size);
 void LoopClear();
 
@@ -12,6 +12,8 @@
 #include "module.h"
 #include "console.h"
 #include "taskthread.h"
+#include "symbolinfo.h"
+#include <ppl.h>
 
 #define PAGE_SHIFT              (12)
 //#define PAGE_SIZE               (4096)
@@ -22,11 +24,15 @@
 std::map<Range, MEMPAGE, RangeCompare> memoryPages;
 bool bListAllPages = false;
 
-void MemUpdateMap()
+bool MemUpdateMap()
 {
     // First gather all possible pages in the memory range
     std::vector<MEMPAGE> pageVector;
-    pageVector.reserve(200); //TODO: provide a better estimate
+    {
+        SHARED_ACQUIRE(LockMemoryPages);
+        pageVector.reserve(memoryPages.size() + 200);
+    }
+    std::vector<size_t> mappedPages; //mapped views that still need a file name
     {
         SIZE_T numBytes = 0;
         duint pageStart = 0;
@@ -62,21 +68,8 @@ void MemUpdateMap()
                         else
                             strcpy_s(curPage.info, "Reserved");
                     }
-                    else if(!ModNameFromAddr(pageStart, curPage.info, true))
-                    {
-                        // Module lookup failed; check if it's a file mapping
-                        wchar_t szMappedName[sizeof(curPage.info)] = L"";
-                        if((mbi.Type == MEM_MAPPED) &&
-                                (GetMappedFileNameW(fdProcessInfo->hProcess, mbi.AllocationBase, szMappedName, MAX_MODULE_SIZE) != 0))
-                        {
-                            auto bFileNameOnly = false; //TODO: setting for this
-                            auto fileStart = wcsrchr(szMappedName, L'\\');
-                            if(bFileNameOnly && fileStart)
-                                strcpy_s(curPage.info, StringUtils::Utf16ToUtf8(fileStart + 1).c_str());
-                            else
-                                strcpy_s(curPage.info, StringUtils::Utf16ToUtf8(szMappedName).c_str());
-                        }
-                    }
+                    else if(!ModNameFromAddr(pageStart, curPage.info, true) && mbi.Type == MEM_MAPPED)
+                        mappedPages.push_back(pageVector.size()); //the file name is resolved once the region size is known
 
                     pageVector.push_back(curPage);
                 }
@@ -99,30 +92,78 @@ void MemUpdateMap()
         while(numBytes);
     }
 
-    // Process file sections
+    // Name the file mappings, views that did not change since the last refresh keep their name
+    {
+        SHARED_ACQUIRE(LockMemoryPages);
+        auto unresolved = mappedPages.begin();
+        for(size_t index : mappedPages)
+        {
+            auto & page = pageVector[index];
+            duint start = (duint)page.mbi.BaseAddress;
+            auto found = memoryPages.find(std::make_pair(start, start));
+            if(found != memoryPages.end() && found->first.first == start && found->second.info[0] &&
+                    found->second.mbi.Type == MEM_MAPPED &&
+                    found->second.mbi.AllocationBase == page.mbi.AllocationBase &&
+                    found->second.mbi.RegionSize == page.mbi.RegionSize)
+                strcpy_s(page.info, found->second.info);
+            else
+                *unresolved++ = index;
+        }
+        mappedPages.erase(unresolved, mappedPages.end());
+    }
+    for(size_t index : mappedPages)
+    {
+        auto & page = pageVector[index];
+        wchar_t szMappedName[sizeof(page.info)] = L"";
+        if(GetMappedFileNameW(fdProcessInfo->hProcess, page.mbi.AllocationBase, szMappedName, MAX_MODULE_SIZE) != 0)
+        {
+            auto bFileNameOnly = false; //TODO: setting for this
+            auto fileStart = wcsrchr(szMappedName, L'\\');
+            if(bFileNameOnly && fileStart)
+                strcpy_s(page.info, StringUtils::Utf16ToUtf8(fileStart + 1).c_str());
+            else
+                strcpy_s(page.info, StringUtils::Utf16ToUtf8(szMappedName).c_str());
+        }
+    }
+
+    // Process file sections, only the last page of every module is expanded
     int pagecount = (int)pageVector.size();
+    std::vector<bool> modulePages(pagecount, false);
+    size_t moduleCount = 0;
     char curMod[MAX_MODULE_SIZE] = "";
     for(int i = pagecount - 1; i > -1; i--)
     {
         auto & currentPage = pageVector.at(i);
         if(!currentPage.info[0] || (scmp(curMod, currentPage.info) && !bListAllPages))   //there is a module
             continue; //skip non-modules
-        strcpy(curMod, pageVector.at(i).info);
-        duint base = ModBaseFromName(currentPage.info);
-        if(!base)
-            continue;
+        strcpy(curMod, currentPage.info);
+        modulePages[i] = true;
+        moduleCount++;
+    }
+
+    // The sections are spliced into a new vector, inserting in the middle of the old one is quadratic
+    std::vector<MEMPAGE> splicedVector;
+    splicedVector.reserve(pageVector.size() + 16 * moduleCount);
+    for(int i = 0; i < pagecount; i++)
+    {
+        auto & currentPage = pageVector.at(i);
         std::vector<MODSECTIONINFO> sections;
-        if(!ModSectionsFromAddr(base, &sections))
+        duint base = modulePages[i] ? ModBaseFromName(currentPage.info) : 0;
+        if(!base || !ModSectionsFromAddr(base, &sections) || sections.empty())  //no sections = skip
+        {
+            splicedVector.push_back(currentPage);
             continue;
+        }
         int SectionNumber = (int)sections.size();
-        if(!SectionNumber)  //no sections = skip
-            continue;
         if(!bListAllPages)  //normal view
         {
+            //replace the current module page (page = size of module at this point) with the module header and the module sections
             MEMPAGE newPage;
-            //remove the current module page (page = size of module at this point) and insert the module sections
-            pageVector.erase(pageVector.begin() + i); //remove the SizeOfImage page
-            for(int j = SectionNumber - 1; j > -1; j--)
+            memset(&newPage, 0, sizeof(MEMPAGE));
+            VirtualQueryEx(fdProcessInfo->hProcess, (LPCVOID)base, &newPage.mbi, sizeof(MEMORY_BASIC_INFORMATION));
+            strcpy_s(newPage.info, currentPage.info);
+            splicedVector.push_back(newPage);
+            for(int j = 0; j < SectionNumber; j++)
             {
                 const auto & currentSection = sections.at(j);
                 memset(&newPage, 0, sizeof(MEMPAGE));
@@ -133,13 +174,8 @@ void MemUpdateMap()
                 if(SectionSize)
                     newPage.mbi.RegionSize = SectionSize;
                 sprintf_s(newPage.info, " \"%s\"", currentSection.name);
-                pageVector.insert(pageVector.begin() + i, newPage);
+                splicedVector.push_back(newPage);
             }
-            //insert the module itself (the module header)
-            memset(&newPage, 0, sizeof(MEMPAGE));
-            VirtualQueryEx(fdProcessInfo->hProcess, (LPCVOID)base, &newPage.mbi, sizeof(MEMORY_BASIC_INFORMATION));
-            strcpy_s(newPage.info, curMod);
-            pageVector.insert(pageVector.begin() + i, newPage);
         }
         else //list all pages
         {
@@ -166,13 +202,43 @@ void MemUpdateMap()
                     k += sprintf_s(currentPage.info + k, MAX_MODULE_SIZE - k, " \"%s\"", currentSection.name);
                 }
             }
+            splicedVector.push_back(currentPage);
         }
     }
+    pageVector.swap(splicedVector);
 
     // Get a list of threads for information about Kernel/PEB/TEB/Stack ranges
     THREADLIST threadList;
     ThreadGetList(&threadList);
 
+    // Read the TIB of every thread once instead of once per page
+    //
+    // TebBase:      Points to 32/64 TEB
+    // TebBaseWow64: Points to 64 TEB in a 32bit process
+    std::unordered_map<duint, DWORD> tebThreads;
+#ifndef _WIN64
+    std::unordered_map<duint, DWORD> tebWow64Threads;
+#endif // ndef _WIN64
+    std::map<duint, DWORD> stackThreads;
+    for(int i = 0; i < threadList.count; i++)
+    {
+        DWORD threadId = threadList.list[i].BasicInfo.ThreadId;
+        duint tebBase = threadList.list[i].BasicInfo.ThreadLocalBase;
+        tebThreads.insert(std::make_pair(tebBase, threadId));
+#ifndef _WIN64
+        tebWow64Threads.insert(std::make_pair(tebBase - (2 * PAGE_SIZE), threadId));
+#endif // ndef _WIN64
+
+        // The stack will be a specific range only, not always the base address
+        NT_TIB tib;
+        if(ThreadGetTib(tebBase, &tib))
+            stackThreads[(duint)tib.StackLimit] = threadId;
+    }
+
+    // Only free thread data if it was allocated
+    if(threadList.list)
+        BridgeFree(threadList.list);
+
     for(auto & page : pageVector)
     {
         const duint pageBase = (duint)page.mbi.BaseAddress;
@@ -185,71 +251,64 @@ void MemUpdateMap()
             continue;
         }
 
-        // Check in threads
-        for(int i = 0; i < threadList.count; i++)
+        // Mark TEB
+        auto teb = tebThreads.find(pageBase);
+        if(teb != tebThreads.end())
         {
-            DWORD threadId = threadList.list[i].BasicInfo.ThreadId;
-
-            // Mark TEB
-            //
-            // TebBase:      Points to 32/64 TEB
-            // TebBaseWow64: Points to 64 TEB in a 32bit process
-            duint tebBase = threadList.list[i].BasicInfo.ThreadLocalBase;
-            duint tebBaseWow64 = tebBase - (2 * PAGE_SIZE);
-
-            if(pageBase == tebBase)
-            {
-                sprintf_s(page.info, "Thread %X TEB", threadId);
-                break;
-            }
-            else if(pageBase == tebBaseWow64)
-            {
+            sprintf_s(page.info, "Thread %X TEB", teb->second);
+            continue;
+        }
 #ifndef _WIN64
-                if(pageSize == (3 * PAGE_SIZE))
-                {
-                    sprintf_s(page.info, "Thread %X WoW64 TEB", threadId);
-                    break;
-                }
+        auto tebWow64 = tebWow64Threads.find(pageBase);
+        if(tebWow64 != tebWow64Threads.end() && pageSize == (3 * PAGE_SIZE))
+        {
+            sprintf_s(page.info, "Thread %X WoW64 TEB", tebWow64->second);
+            continue;
+        }
 #endif // ndef _WIN64
-            }
-
-            // Mark stack
-            //
-            // Read TEB::Tib to get stack information
-            NT_TIB tib;
-            if(!ThreadGetTib(tebBase, &tib))
-                continue;
 
-            // The stack will be a specific range only, not always the base address
-            duint stackAddr = (duint)tib.StackLimit;
+        // Mark stack
+        auto stack = stackThreads.lower_bound(pageBase);
+        if(stack != stackThreads.end() && stack->first < (pageBase + pageSize))
+            sprintf_s(page.info, "Thread %X Stack", stack->second);
+    }
 
-            if(stackAddr >= pageBase && stackAddr < (pageBase + pageSize))
-                sprintf_s(page.info, "Thread %X Stack", threadId);
+    // Only replace the map when a region was added, removed or changed
+    EXCLUSIVE_ACQUIRE(LockMemoryPages);
+    if(memoryPages.size() == pageVector.size())
+    {
+        auto found = memoryPages.begin();
+        auto page = pageVector.begin();
+        for(; page != pageVector.end(); ++page, ++found)
+        {
+            if(memcmp(&found->second.mbi, &page->mbi, sizeof(page->mbi)) != 0 || strcmp(found->second.info, page->info) != 0)
+                break;
         }
+        if(page == pageVector.end())
+            return false;
     }
 
-    // Only free thread data if it was allocated
-    if(threadList.list)
-        BridgeFree(threadList.list);
-
-    // Convert the vector to a map
-    EXCLUSIVE_ACQUIRE(LockMemoryPages);
+    // Convert the vector to a map, the pages are sorted so every insert goes to the end
     memoryPages.clear();
 
     for(auto & page : pageVector)
     {
         duint start = (duint)page.mbi.BaseAddress;
         duint size = (duint)page.mbi.RegionSize;
-        memoryPages.insert(std::make_pair(std::make_pair(start, start + size - 1), page));
+        memoryPages.emplace_hint(memoryPages.end(), std::make_pair(start, start + size - 1), page);
     }
+
+    // Whether an address is readable is part of the annotations
+    SymInvalidateAnnotations();
+    return true;
 }
 
 static DWORD WINAPI memUpdateMap()
 {
     if(DbgIsDebugging())
     {
-        MemUpdateMap();
-        GuiUpdateMemoryView();
+        if(MemUpdateMap())
+            GuiUpdateMemoryView();
     }
     return 0;
 }
@@ -338,6 +397,42 @@ bool MemRead(duint BaseAddress, void* Buffer, duint Size, duint* NumberOfBytesRe
     return (*NumberOfBytesRead > 0);
 }
 
+/**
+\brief Reads a page aligned range in one go, falling back to single pages when the read is not complete.
+       A partial MemRead leaves the unreadable pages untouched, they are zeroed and marked as unread instead.
+\param BaseAddress The page aligned start of the range.
+\param [out] Buffer Receives Size bytes.
+\param Size The size of the range.
+\param [out] PageRead Whether every page (the last one can be partial) was read.
+\return The number of pages that were read.
+*/
+duint MemReadPages(duint BaseAddress, void* Buffer, duint Size, std::vector<bool> & PageRead)
+{
+    duint pageCount = (Size + PAGE_SIZE - 1) / PAGE_SIZE;
+    duint bytesRead = 0;
+    if(MemRead(BaseAddress, Buffer, Size, &bytesRead) && bytesRead == Size)
+    {
+        PageRead.assign(size_t(pageCount), true);
+        return pageCount;
+    }
+
+    PageRead.assign(size_t(pageCount), false);
+    duint readCount = 0;
+    for(duint i = 0; i < pageCount; i++)
+    {
+        auto pageData = (unsigned char*)Buffer + i * PAGE_SIZE;
+        auto pageSize = min(duint(PAGE_SIZE), Size - i * PAGE_SIZE);
+        if(MemRead(BaseAddress + i * PAGE_SIZE, pageData, pageSize))
+        {
+            PageRead[size_t(i)] = true;
+            readCount++;
+        }
+        else
+            memset(pageData, 0, size_t(pageSize));
+    }
+    return readCount;
+}
+
 bool MemReadUnsafe(duint BaseAddress, void* Buffer, duint Size, duint* NumberOfBytesRead)
 {
     SIZE_T read;
@@ -362,6 +457,9 @@ bool MemWrite(duint BaseAddress, const void* Buffer, duint Size, duint* NumberOf
     if(!NumberOfBytesWritten)
         NumberOfBytesWritten = &bytesWrittenTemp;
 
+    // Names resolved through pointers can change
+    SymInvalidateAnnotations();
+
     // Try a regular WriteProcessMemory call
     bool ret = MemoryWriteSafe(fdProcessInfo->hProcess, (LPVOID)BaseAddress, Buffer, Size, NumberOfBytesWritten);
 
@@ -657,6 +755,169 @@ bool MemFindInMap(const std::vector<SimplePage> & pages, const std::vector<Patte
     return true;
 }
 
+/**
+\brief Collects the pages described by a search scope.
+\param Scope "modules" (or empty) for all module images, "mem" for all committed memory or a ';'-separated list of module names.
+\param [out] pages The pages to search.
+\return false if a module in the list was not found.
+*/
+bool MemFindScopePages(const char* Scope, std::vector<SimplePage> & pages)
+{
+    pages.clear();
+    if(!Scope || !*Scope || !_stricmp(Scope, "modules"))
+    {
+        ModEnum([&pages](const MODINFO & mod)
+        {
+            pages.push_back(SimplePage(mod.base, mod.size));
+        });
+        return true;
+    }
+    if(!_stricmp(Scope, "mem"))
+    {
+        SHARED_ACQUIRE(LockMemoryPages);
+        for(auto & itr : memoryPages)
+        {
+            if(itr.second.mbi.State == MEM_COMMIT)
+                pages.push_back(SimplePage(duint(itr.second.mbi.BaseAddress), itr.second.mbi.RegionSize));
+        }
+        return true;
+    }
+    for(const auto & name : StringUtils::Split(Scope, ';'))
+    {
+        auto base = ModBaseFromName(StringUtils::Trim(name).c_str());
+        if(!base)
+            return false;
+        pages.push_back(SimplePage(base, ModSizeFromAddr(base)));
+    }
+    return true;
+}
+
+/**
+\brief Searches a set of patterns in a set of pages, reading every byte once.
+\param pages The pages to search, may overlap.
+\param patterns The transformed patterns to search for.
+\param [out] results The matches ordered by address.
+\param maxresults The maximum number of matches.
+\param cbProgress Called with the new matches after every chunk, can be null.
+*/
+bool MemFindPatternsInMap(const std::vector<SimplePage> & pages, const std::vector<std::vector<PatternByte>> & patterns, std::vector<MemFindMatch> & results, duint maxresults, const MEMFINDCALLBACK & cbProgress)
+{
+    const duint chunkSize = 16 * 1024 * 1024;
+
+    if(patterns.empty())
+        return false;
+    size_t maxPatternSize = 0;
+    for(const auto & pattern : patterns)
+        maxPatternSize = max(maxPatternSize, pattern.size());
+    if(!maxPatternSize)
+        return false;
+
+    // Plan the reads: sort and merge overlapping/adjacent ranges so no byte is read twice
+    std::vector<SimplePage> ranges(pages);
+    std::sort(ranges.begin(), ranges.end(), [](const SimplePage & a, const SimplePage & b)
+    {
+        return a.address < b.address;
+    });
+    std::vector<SimplePage> plan;
+    duint bytesTotal = 0;
+    for(const auto & range : ranges)
+    {
+        if(!range.size)
+            continue;
+        if(!plan.empty() && range.address <= plan.back().address + plan.back().size)
+        {
+            auto end = max(plan.back().address + plan.back().size, range.address + range.size);
+            bytesTotal += end - (plan.back().address + plan.back().size);
+            plan.back().size = end - plan.back().address;
+        }
+        else
+        {
+            plan.push_back(range);
+            bytesTotal += range.size;
+        }
+    }
+    if(plan.empty())
+        return true;
+
+    // Chunks overlap by the longest pattern so matches crossing a chunk boundary are found
+    const duint overlap = maxPatternSize - 1;
+    Memory<unsigned char*> data(size_t(min(chunkSize + overlap, bytesTotal + overlap)), "MemFindPatternsInMap:data");
+    std::vector<std::vector<duint>> patternResults(patterns.size());
+    std::vector<MemFindMatch> chunkMatches;
+    std::vector<bool> unreadPages;
+    duint bytesDone = 0;
+    for(const auto & range : plan)
+    {
+        for(duint offset = 0; offset < range.size && results.size() < maxresults; offset += chunkSize)
+        {
+            auto chunkStart = range.address + offset;
+            auto searchSize = min(chunkSize, range.size - offset); // Matches must start in this part
+            auto readSize = min(searchSize + overlap, range.size - offset);
+            duint bytesRead = 0;
+            if(MemRead(chunkStart, data(), readSize, &bytesRead))
+            {
+                // A partial read leaves the unreadable pages untouched (stale bytes of the previous chunk),
+                // so read page by page to know which bytes are real
+                auto firstPage = chunkStart & ~duint(PAGE_SIZE - 1);
+                unreadPages.clear();
+                if(bytesRead != readSize)
+                {
+                    memset(data(), 0, size_t(readSize));
+                    for(auto page = firstPage; page < chunkStart + readSize; page += PAGE_SIZE)
+                    {
+                        auto pageStart = max(page, chunkStart);
+                        auto pageEnd = min(page + PAGE_SIZE, chunkStart + readSize);
+                        unreadPages.push_back(!MemRead(pageStart, data() + (pageStart - chunkStart), pageEnd - pageStart));
+                    }
+                }
+                auto isRead = [&](duint addr, duint size)
+                {
+                    if(unreadPages.empty())
+                        return true;
+                    for(auto page = (addr - firstPage) / PAGE_SIZE; page <= (addr + size - 1 - firstPage) / PAGE_SIZE; page++)
+                        if(unreadPages[size_t(page)])
+                            return false;
+                    return true;
+                };
+
+                concurrency::parallel_for(size_t(0), patterns.size(), [&](size_t p)
+                {
+                    auto & found = patternResults[p];
+                    found.clear();
+                    const auto & pattern = patterns[p];
+                    for(duint i = 0; i < searchSize && found.size() < maxresults;)
+                    {
+                        auto foundoffset = patternfind(data() + i, size_t(readSize - i), pattern);
+                        if(foundoffset == -1 || i + foundoffset >= searchSize)
+                            break;
+                        if(isRead(chunkStart + i + foundoffset, pattern.size()))
+                            found.push_back(chunkStart + i + foundoffset);
+                        i += foundoffset + 1;
+                    }
+                });
+
+                chunkMatches.clear();
+                for(size_t p = 0; p < patternResults.size(); p++)
+                    for(auto addr : patternResults[p])
+                        chunkMatches.push_back(MemFindMatch { addr, p });
+                std::sort(chunkMatches.begin(), chunkMatches.end(), [](const MemFindMatch & a, const MemFindMatch & b)
+                {
+                    return a.address < b.address || (a.address == b.address && a.pattern < b.pattern);
+                });
+                if(results.size() + chunkMatches.size() > maxresults)
+                    chunkMatches.resize(size_t(maxresults - results.size()));
+                results.insert(results.end(), chunkMatches.begin(), chunkMatches.end());
+            }
+            else
+                chunkMatches.clear();
+            bytesDone += searchSize;
+            if(cbProgress)
+                cbProgress(chunkMatches, bytesDone, bytesTotal);
+        }
+    }
+    return true;
+}
+
 template<class T>
 static T ror(T x, unsigned int moves)
 {
@@ -21,11 +21,12 @@ struct SimplePage
     }
 };
 
-void MemUpdateMap();
+bool MemUpdateMap();
 void MemUpdateMapAsync();
 duint MemFindBaseAddr(duint Address, duint* Size, bool Refresh = false);
 bool MemRead(duint BaseAddress, void* Buffer, duint Size, duint* NumberOfBytesRead = nullptr, bool cache = false);
 bool MemReadUnsafe(duint BaseAddress, void* Buffer, duint Size, duint* NumberOfBytesRead = nullptr);
+duint MemReadPages(duint BaseAddress, void* Buffer, duint Size, std::vector<bool> & PageRead);
 bool MemWrite(duint BaseAddress, const void* Buffer, duint Size, duint* NumberOfBytesWritten = nullptr);
 bool MemPatch(duint BaseAddress, const void* Buffer, duint Size, duint* NumberOfBytesWritten = nullptr);
 bool MemIsValidReadPtr(duint Address, bool cache = false);
@@ -41,6 +42,18 @@ bool MemPageRightsToString(DWORD Protect, char* Rights);
 bool MemPageRightsFromString(DWORD* Protect, const char* Rights);
 bool MemFindInPage(SimplePage page, duint startoffset, const std::vector<PatternByte> & pattern, std::vector<duint> & results, duint maxresults);
 bool MemFindInMap(const std::vector<SimplePage> & pages, const std::vector<PatternByte> & pattern, std::vector<duint> & results, duint maxresults, bool progress = true);
+
+struct MemFindMatch
+{
+    duint address;
+    size_t pattern; // Index in the pattern list
+};
+
+// Called after every searched chunk with the matches it produced
+typedef std::function<void(const std::vector<MemFindMatch> & matches, duint bytesDone, duint bytesTotal)> MEMFINDCALLBACK;
+
+bool MemFindScopePages(const char* Scope, std::vector<SimplePage> & pages);
+bool MemFindPatternsInMap(const std::vector<SimplePage> & pages, const std::vector<std::vector<PatternByte>> & patterns, std::vector<MemFindMatch> & results, duint maxresults, const MEMFINDCALLBACK & cbProgress = nullptr);
 bool MemDecodePointer(duint* Pointer, bool vistaPlus);
 
 #endif // _MEMORY_H
\ No newline at end of file
@@ -0,0 +1,121 @@
+/**
+ @file memsnapshot.cpp
+
+ @brief Implements the memory snapshot class.
+ */
+
+#include "memsnapshot.h"
+#include "memory.h"
+#include "module.h"
+#include "threading.h"
+
+MemSnapshot::MemSnapshot()
+    : m_Base(0),
+      m_Size(0)
+{
+}
+
+bool MemSnapshot::Snapshot(duint Base, duint Size)
+{
+    Clear();
+    if(!Size)
+        return false;
+
+    // Align the range to whole pages so validity can be tracked per page
+    duint start = Base & ~(PAGE_SIZE - 1);
+    duint end = (Base + Size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    m_Base = start;
+    m_Size = end - start;
+    m_Data.resize(m_Size);
+    m_ValidPages.resize(m_Size / PAGE_SIZE);
+
+    // Try a single read first, this is the common case for mapped images
+    duint read = 0;
+    if(MemRead(m_Base, m_Data.data(), m_Size, &read) && read == m_Size)
+    {
+        m_ValidPages.assign(m_ValidPages.size(), true);
+        return true;
+    }
+
+    // Fall back to reading page by page, remembering the unreadable ones
+    bool any = false;
+    for(size_t i = 0; i < m_ValidPages.size(); i++)
+    {
+        auto offset = i * PAGE_SIZE;
+        read = 0;
+        if(MemRead(m_Base + offset, m_Data.data() + offset, PAGE_SIZE, &read) && read == PAGE_SIZE)
+        {
+            m_ValidPages[i] = true;
+            any = true;
+        }
+        else
+            memset(m_Data.data() + offset, 0, PAGE_SIZE);
+    }
+    return any;
+}
+
+bool MemSnapshot::SnapshotModule(duint Address)
+{
+    duint base, size;
+    {
+        SHARED_ACQUIRE(LockModules);
+        auto modInfo = ModInfoFromAddr(Address);
+        if(!modInfo)
+            return false;
+        base = modInfo->base;
+        size = modInfo->size;
+    }
+    return Snapshot(base, size);
+}
+
+void MemSnapshot::Clear()
+{
+    m_Base = 0;
+    m_Size = 0;
+    std::vector<unsigned char>().swap(m_Data);
+    std::vector<bool>().swap(m_ValidPages);
+}
+
+bool MemSnapshot::Contains(duint Address, duint Size) const
+{
+    return Address >= m_Base && Size <= m_Size && Address - m_Base <= m_Size - Size;
+}
+
+bool MemSnapshot::IsValid(duint Address, duint Size) const
+{
+    if(!Size || !Contains(Address, Size))
+        return false;
+    auto first = (Address - m_Base) / PAGE_SIZE;
+    auto last = (Address - m_Base + Size - 1) / PAGE_SIZE;
+    for(auto i = first; i <= last; i++)
+        if(!m_ValidPages[i])
+            return false;
+    return true;
+}
+
+bool MemSnapshot::Read(duint Address, void* Buffer, duint Size, duint* NumberOfBytesRead) const
+{
+    // Copy the readable bytes starting at Address, stopping at the first invalid page
+    duint copied = 0;
+    if(Contains(Address))
+    {
+        auto offset = Address - m_Base;
+        while(copied < Size && offset < m_Size && m_ValidPages[offset / PAGE_SIZE])
+        {
+            auto chunk = min(Size - copied, PAGE_SIZE - (offset % PAGE_SIZE));
+            memcpy((unsigned char*)Buffer + copied, m_Data.data() + offset, chunk);
+            copied += chunk;
+            offset += chunk;
+        }
+    }
+    if(NumberOfBytesRead)
+        *NumberOfBytesRead = copied;
+    return copied == Size;
+}
+
+const unsigned char* MemSnapshot::Data(duint Address, duint Size) const
+{
+    if(!IsValid(Address, Size))
+        return nullptr;
+    return m_Data.data() + (Address - m_Base);
+}
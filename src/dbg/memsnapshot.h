@@ -0,0 +1,41 @@
+#ifndef _MEMSNAPSHOT_H
+#define _MEMSNAPSHOT_H
+
+#include "_global.h"
+
+/**
+ * @brief Local copy of a range of debuggee memory, read once and queried many times.
+ *        Pages that could not be read are tracked so lookups never return stale zeroes.
+**/
+class MemSnapshot
+{
+public:
+    MemSnapshot();
+
+    bool Snapshot(duint Base, duint Size);
+    bool SnapshotModule(duint Address);
+    void Clear();
+
+    bool Contains(duint Address, duint Size = 1) const;
+    bool IsValid(duint Address, duint Size = 1) const;
+    bool Read(duint Address, void* Buffer, duint Size, duint* NumberOfBytesRead = nullptr) const;
+    const unsigned char* Data(duint Address, duint Size) const;
+
+    duint Base() const
+    {
+        return m_Base;
+    }
+
+    duint Size() const
+    {
+        return m_Size;
+    }
+
+private:
+    duint m_Base;
+    duint m_Size;
+    std::vector<unsigned char> m_Data;
+    std::vector<bool> m_ValidPages;
+};
+
+#endif // _MEMSNAPSHOT_H
@@ -5,6 +5,11 @@
 #include "murmurhash.h"
 #include "memory.h"
 #include "label.h"
+#include "analysiscache.h"
+#include "taskthread.h"
+#include "handle.h"
+#include <deque>
+#include <memory>
 
 std::map<Range, MODINFO, RangeCompare> modinfo;
 
@@ -46,8 +51,270 @@ void GetModuleInfo(MODINFO & Info, ULONG_PTR FileMapVA)
         Info.sections.push_back(curSection);
     }
 
-    // Clear imports by default
+    // Imports are parsed when they are first needed
+    Info.importDirectoryRva = GetPE32DataFromMappedFile(FileMapVA, 0, UE_IMPORTTABLEADDRESS);
+    Info.importDirectorySize = GetPE32DataFromMappedFile(FileMapVA, 0, UE_IMPORTTABLESIZE);
+    Info.importsParsed = false;
     Info.imports.clear();
+    Info.importNames.clear();
+}
+
+static unsigned int AddImportName(MODINFO & Info, const char* Name)
+{
+    auto offset = (unsigned int)Info.importNames.size();
+    Info.importNames.append(Name);
+    Info.importNames.push_back('\0');
+    return offset;
+}
+
+// Reads the import directory from a file mapping, or from a copy of the image when ImageLayout is set
+void GetModuleImports(MODINFO & Info, ULONG_PTR FileMapVA, duint FileSize, bool ImageLayout)
+{
+    Info.importsParsed = true;
+    Info.imports.clear();
+    Info.importNames.clear();
+
+    // Translate a relative address to a pointer in the data, null when out of bounds
+    auto rvaToPtr = [&](duint Rva, duint Size) -> const unsigned char*
+    {
+        duint offset = Rva;
+        if(!ImageLayout)
+        {
+            offset = (duint)ConvertVAtoFileOffsetEx(FileMapVA, (DWORD)FileSize, 0, Rva, true, false);
+            if(!offset)
+                return nullptr;
+        }
+        if(offset >= FileSize || Size > FileSize - offset)
+            return nullptr;
+        return (const unsigned char*)(FileMapVA + offset);
+    };
+    auto rvaToString = [&](duint Rva) -> const char*
+    {
+        auto str = (const char*)rvaToPtr(Rva, 1);
+        if(!str)
+            return nullptr;
+        duint maxLength = FileSize - duint((const unsigned char*)str - (const unsigned char*)FileMapVA);
+        return strnlen(str, maxLength) < maxLength ? str : nullptr;
+    };
+
+    duint importTableRva = GetPE32DataFromMappedFile(FileMapVA, 0, UE_IMPORTTABLEADDRESS);
+    duint importTableSize = GetPE32DataFromMappedFile(FileMapVA, 0, UE_IMPORTTABLESIZE);
+    if(!importTableRva || !importTableSize)
+        return;
+
+    // Loop through all dlls
+    for(duint descriptorRva = importTableRva; ; descriptorRva += sizeof(IMAGE_IMPORT_DESCRIPTOR))
+    {
+        auto descriptor = (const IMAGE_IMPORT_DESCRIPTOR*)rvaToPtr(descriptorRva, sizeof(IMAGE_IMPORT_DESCRIPTOR));
+        if(!descriptor || !descriptor->FirstThunk)
+            break;
+        auto moduleName = rvaToString(descriptor->Name);
+        if(!moduleName)
+            break;
+        auto moduleNameOffset = AddImportName(Info, moduleName);
+
+        // Loop through all imported functions in this dll, the names come from the INT when there is one
+        duint thunkRva = descriptor->OriginalFirstThunk ? descriptor->OriginalFirstThunk : descriptor->FirstThunk;
+        for(duint i = 0; ; i++)
+        {
+            auto thunk = (const IMAGE_THUNK_DATA*)rvaToPtr(thunkRva + i * sizeof(IMAGE_THUNK_DATA), sizeof(IMAGE_THUNK_DATA));
+            if(!thunk || !thunk->u1.AddressOfData)
+                break;
+            MODIMPORT import;
+            import.iatRva = descriptor->FirstThunk + i * sizeof(IMAGE_THUNK_DATA);
+            import.moduleName = moduleNameOffset;
+            if(IMAGE_SNAP_BY_ORDINAL(thunk->u1.Ordinal))
+                import.name = AddImportName(Info, StringUtils::sprintf("Ordinal%u", unsigned(IMAGE_ORDINAL(thunk->u1.Ordinal))).c_str());
+            else
+            {
+                auto name = rvaToString(duint(thunk->u1.AddressOfData) + sizeof(WORD));
+                if(!name)
+                    break;
+                import.name = AddImportName(Info, name);
+            }
+            Info.imports.push_back(import);
+        }
+    }
+    Info.imports.shrink_to_fit();
+    Info.importNames.shrink_to_fit();
+}
+
+// Work of ModLoad that breakpoints don't need, done by the pipeline worker (or by ModPipelineWait)
+struct ModPipelineItem
+{
+    duint base;
+    bool hash;      // Hash the mapped image for the analysis cache
+    bool exports;   // Label the exports of a virtual module
+};
+
+static std::deque<ModPipelineItem> modPipelineQueue;
+static duint modPipelineBusy = 0; // Base of the item the worker is processing
+static std::shared_ptr<Handle> modPipelineBusyDone; // Event that is set when the worker is done with that item
+static DWORD modPipelineThread = 0;
+
+static const char* modStageNames[int(ModLoadStage::Count)] = { "Symbols", "Module", "Breakpoints", "Image hash", "Analysis cache", "Exports" };
+static volatile LONG64 modStageTime[int(ModLoadStage::Count)];
+static volatile LONG64 modStageCount[int(ModLoadStage::Count)];
+
+ModStageTimer::ModStageTimer(ModLoadStage Stage)
+    : stage(Stage)
+{
+    QueryPerformanceCounter(&start);
+}
+
+ModStageTimer::~ModStageTimer()
+{
+    LARGE_INTEGER end, frequency;
+    QueryPerformanceCounter(&end);
+    QueryPerformanceFrequency(&frequency);
+    ModAddStageTime(stage, duint((end.QuadPart - start.QuadPart) * 1000000 / frequency.QuadPart));
+}
+
+void ModAddStageTime(ModLoadStage Stage, duint Microseconds)
+{
+    InterlockedExchangeAdd64(&modStageTime[int(Stage)], LONG64(Microseconds));
+    InterlockedIncrement64(&modStageCount[int(Stage)]);
+}
+
+const char* ModStageName(ModLoadStage Stage)
+{
+    return modStageNames[int(Stage)];
+}
+
+void ModStageStatistics(ModLoadStage Stage, duint & Count, duint & Microseconds)
+{
+    Count = duint(modStageCount[int(Stage)]);
+    Microseconds = duint(modStageTime[int(Stage)]);
+}
+
+static void ModPipelineProcess(const ModPipelineItem & Item)
+{
+    if(Item.hash)
+    {
+        ModStageTimer timer(ModLoadStage::ImageHash);
+
+        // The mapping stays valid, ModUnload waits for the item before unmapping it
+        ULONG_PTR fileMapVA = 0;
+        DWORD loadedSize = 0;
+        {
+            SHARED_ACQUIRE(LockModules);
+            auto module = ModInfoFromAddr(Item.base);
+            if(module)
+            {
+                fileMapVA = module->fileMapVA;
+                loadedSize = module->loadedSize;
+            }
+        }
+
+        if(fileMapVA)
+        {
+            unsigned long long imageHash[2];
+            AnalysisCacheHashImage((const void*)fileMapVA, loadedSize, imageHash);
+
+            EXCLUSIVE_ACQUIRE(LockModules);
+            auto module = ModInfoFromAddr(Item.base);
+            if(module)
+                memcpy(module->imageHash, imageHash, sizeof(imageHash));
+        }
+    }
+
+    if(Item.exports)
+    {
+        ModStageTimer timer(ModLoadStage::Exports);
+        apienumexports(Item.base, [](duint base, const char* mod, const char* name, duint addr)
+        {
+            LabelSet(addr, name, false);
+        });
+    }
+
+    // Reuse earlier analysis results of an identical image
+    ModStageTimer timer(ModLoadStage::AnalysisCache);
+    AnalysisCacheLoad(Item.base);
+}
+
+static void ModPipelineWorker()
+{
+    modPipelineThread = GetCurrentThreadId();
+    while(true)
+    {
+        ModPipelineItem item;
+        {
+            EXCLUSIVE_ACQUIRE(LockModulePipeline);
+            if(modPipelineQueue.empty())
+                return;
+            item = modPipelineQueue.front();
+            modPipelineQueue.pop_front();
+            modPipelineBusy = item.base;
+            modPipelineBusyDone = std::make_shared<Handle>(CreateEventW(nullptr, TRUE, FALSE, nullptr));
+        }
+        ModPipelineProcess(item);
+        {
+            EXCLUSIVE_ACQUIRE(LockModulePipeline);
+            SetEvent(*modPipelineBusyDone);
+            modPipelineBusyDone.reset();
+            modPipelineBusy = 0;
+        }
+    }
+}
+
+static void ModPipelineQueue(const ModPipelineItem & Item)
+{
+    static auto modPipelineTask = MakeTaskThread(ModPipelineWorker, 0);
+    {
+        EXCLUSIVE_ACQUIRE(LockModulePipeline);
+        modPipelineQueue.push_back(Item);
+    }
+    modPipelineTask.WakeUp();
+}
+
+/**
+\brief Barrier for the background stages of ModLoad, call this before using the image hash or the cached analysis of a module.
+\param Base The module base, zero for all modules.
+\param Cancel Drop the queued work instead of doing it (the module is unloaded).
+*/
+void ModPipelineWait(duint Base, bool Cancel)
+{
+    // The worker never waits for itself
+    if(GetCurrentThreadId() == modPipelineThread)
+        return;
+
+    // Take the queued work over instead of waiting for the worker to get to it
+    std::vector<ModPipelineItem> items;
+    {
+        EXCLUSIVE_ACQUIRE(LockModulePipeline);
+        for(auto i = modPipelineQueue.begin(); i != modPipelineQueue.end();)
+        {
+            if(!Base || i->base == Base)
+            {
+                items.push_back(*i);
+                i = modPipelineQueue.erase(i);
+            }
+            else
+                ++i;
+        }
+    }
+    if(!Cancel)
+    {
+        for(const auto & item : items)
+            ModPipelineProcess(item);
+    }
+
+    // Wait for the item the worker is processing, no other item of the module can be started because they were taken above
+    std::shared_ptr<Handle> done;
+    {
+        SHARED_ACQUIRE(LockModulePipeline);
+        if(modPipelineBusy && (!Base || modPipelineBusy == Base))
+            done = modPipelineBusyDone;
+    }
+    if(done)
+        WaitForSingleObject(*done, INFINITE);
+}
+
+static void ModUpdateSymbolListAsync()
+{
+    // Coalesces the updates when a lot of modules are loaded at once
+    static auto modSymbolListTask = MakeTaskThread(SymUpdateModuleList, 100);
+    modSymbolListTask.WakeUp();
 }
 
 bool ModLoad(duint Base, duint Size, const char* FullPath)
@@ -56,6 +323,9 @@ bool ModLoad(duint Base, duint Size, const char* FullPath)
     if(!Base || !Size || !FullPath)
         return false;
 
+    LARGE_INTEGER loadStart, loadEnd, frequency;
+    QueryPerformanceCounter(&loadStart);
+
     // Copy the module path in the struct
     MODINFO info;
     strcpy_s(info.path, FullPath);
@@ -104,6 +374,11 @@ bool ModLoad(duint Base, duint Size, const char* FullPath)
     info.loadedSize = 0;
     info.fileMap = nullptr;
     info.fileMapVA = 0;
+    info.imageHash[0] = info.imageHash[1] = 0;
+    info.importsParsed = false;
+    info.importDirectoryRva = 0;
+    info.importDirectorySize = 0;
+    info.loadTime = 0;
 
     // Determine whether the module is located in system
     wchar_t sysdir[MAX_PATH];
@@ -145,33 +420,48 @@ bool ModLoad(duint Base, duint Size, const char* FullPath)
         Memory<unsigned char*> data(Size);
         MemRead(Base, data(), data.size());
 
-        // Get information from the local buffer
+        // Get information from the local buffer, the imports as well because the buffer is gone afterwards
         GetModuleInfo(info, (ULONG_PTR)data());
+        GetModuleImports(info, (ULONG_PTR)data(), data.size(), true);
+        if(AnalysisCacheEnabled())
+        {
+            ModStageTimer timer(ModLoadStage::ImageHash);
+            AnalysisCacheHashImage(data(), data.size(), info.imageHash);
+        }
     }
 
+    QueryPerformanceCounter(&loadEnd);
+    QueryPerformanceFrequency(&frequency);
+    info.loadTime = duint((loadEnd.QuadPart - loadStart.QuadPart) * 1000000 / frequency.QuadPart);
+    ModAddStageTime(ModLoadStage::Module, info.loadTime);
+
     // Add module to list
     EXCLUSIVE_ACQUIRE(LockModules);
     modinfo.insert(std::make_pair(Range(Base, Base + Size - 1), info));
     EXCLUSIVE_RELEASE();
+    SymInvalidateAnnotations();
 
     // Put labels for virtual module exports
-    if(virtualModule)
-    {
-        if(info.entry >= Base && info.entry < Base + Size)
-            LabelSet(info.entry, "EntryPoint", false);
-
-        apienumexports(Base, [](duint base, const char* mod, const char* name, duint addr)
-        {
-            LabelSet(addr, name, false);
-        });
-    }
-
-    SymUpdateModuleList();
+    if(virtualModule && info.entry >= Base && info.entry < Base + Size)
+        LabelSet(info.entry, "EntryPoint", false);
+
+    // Hashing the mapped image, the analysis cache and the export labels are done in the background
+    ModPipelineItem item;
+    item.base = Base;
+    item.hash = !virtualModule && info.fileMapVA && AnalysisCacheEnabled();
+    item.exports = virtualModule;
+    if(item.exports || AnalysisCacheEnabled())
+        ModPipelineQueue(item);
+
+    ModUpdateSymbolListAsync();
     return true;
 }
 
 bool ModUnload(duint Base)
 {
+    // The background stages might still use the mapped file
+    ModPipelineWait(Base, true);
+
     EXCLUSIVE_ACQUIRE(LockModules);
 
     // Find the iterator index
@@ -188,15 +478,17 @@ bool ModUnload(duint Base)
     // Remove it from the list
     modinfo.erase(found);
     EXCLUSIVE_RELEASE();
+    SymInvalidateAnnotations();
 
     // Update symbols
-    SymUpdateModuleList();
+    ModUpdateSymbolListAsync();
     return true;
 }
 
 void ModClear()
 {
     // Clean up all the modules
+    ModPipelineWait(0, true);
     EXCLUSIVE_ACQUIRE(LockModules);
 
     for(const auto & mod : modinfo)
@@ -210,6 +502,12 @@ void ModClear()
     modinfo.clear();
 
     EXCLUSIVE_RELEASE();
+    for(int i = 0; i < int(ModLoadStage::Count); i++)
+    {
+        InterlockedExchange64(&modStageTime[i], 0);
+        InterlockedExchange64(&modStageCount[i], 0);
+    }
+    SymInvalidateAnnotations();
 
     // Tell the symbol updater
     GuiSymbolUpdateModuleList(0, nullptr);
@@ -335,6 +633,16 @@ bool ModSectionsFromAddr(duint Address, std::vector<MODSECTIONINFO>* Sections)
     return true;
 }
 
+// Parses the imports of a module on first use, requires LockModules to be held exclusively
+static void ModParseImports(MODINFO & Info)
+{
+    if(Info.importsParsed)
+        return;
+    if(Info.fileMapVA)
+        GetModuleImports(Info, Info.fileMapVA, Info.loadedSize, false);
+    Info.importsParsed = true;
+}
+
 bool ModImportsFromAddr(duint Address, std::vector<MODIMPORTINFO>* Imports)
 {
     SHARED_ACQUIRE(LockModules);
@@ -344,8 +652,34 @@ bool ModImportsFromAddr(duint Address, std::vector<MODIMPORTINFO>* Imports)
     if(!module)
         return false;
 
-    // Copy vector <-> vector
-    *Imports = module->imports;
+    // Parsing the imports changes the module, this only happens on first use
+    if(!module->importsParsed)
+    {
+        SHARED_RELEASE();
+        {
+            EXCLUSIVE_ACQUIRE(LockModules);
+            module = ModInfoFromAddr(Address);
+            if(!module)
+                return false;
+            ModParseImports(*module);
+        }
+        SHARED_REACQUIRE();
+        module = ModInfoFromAddr(Address);
+        if(!module)
+            return false;
+    }
+
+    // Expand the compact entries
+    Imports->clear();
+    Imports->reserve(module->imports.size());
+    for(const auto & import : module->imports)
+    {
+        MODIMPORTINFO info;
+        info.addr = module->base + import.iatRva;
+        info.name = module->importNames.c_str() + import.name;
+        info.moduleName = module->importNames.c_str() + import.moduleName;
+        Imports->push_back(info);
+    }
     return true;
 }
 
@@ -387,35 +721,68 @@ void ModGetList(std::vector<MODINFO> & list)
         list.push_back(mod.second);
 }
 
-bool ModAddImportToModule(duint Base, const MODIMPORTINFO & importInfo)
+void ModEnum(const std::function<void(const MODINFO &)> & cbEnum)
 {
     SHARED_ACQUIRE(LockModules);
+    for(const auto & mod : modinfo)
+        cbEnum(mod.second);
+}
+
+bool ModAddImportToModule(duint Base, const MODIMPORTINFO & importInfo)
+{
+    EXCLUSIVE_ACQUIRE(LockModules);
 
     if(!Base || !importInfo.addr)
         return false;
 
     auto module = ModInfoFromAddr(Base);
 
-    if(!module)
+    if(!module || importInfo.addr < module->base)
         return false;
 
+    ModParseImports(*module);
+
     // Search in Import Vector
+    duint iatRva = importInfo.addr - module->base;
     auto pImports = &(module->imports);
-    auto it = std::find_if(pImports->begin(), pImports->end(), [&importInfo](const MODIMPORTINFO & currentImportInfo)->bool
+    auto it = std::find_if(pImports->begin(), pImports->end(), [iatRva](const MODIMPORT & currentImport)->bool
     {
-        return (importInfo.addr == currentImportInfo.addr);
+        return (iatRva == currentImport.iatRva);
     });
 
     // Import in the list already
     if(it != pImports->end())
         return false;
 
-    // Add import to imports vector
-    pImports->push_back(importInfo);
+    // Add import to imports vector, reusing the module name when it is known
+    MODIMPORT import;
+    import.iatRva = iatRva;
+    import.moduleName = (unsigned int)module->importNames.size();
+    for(const auto & currentImport : *pImports)
+    {
+        if(!_stricmp(module->importNames.c_str() + currentImport.moduleName, importInfo.moduleName.c_str()))
+        {
+            import.moduleName = currentImport.moduleName;
+            break;
+        }
+    }
+    if(import.moduleName == module->importNames.size())
+        AddImportName(*module, importInfo.moduleName.c_str());
+    import.name = AddImportName(*module, importInfo.name.c_str());
+    pImports->push_back(import);
 
     return true;
 }
 
+// Memory used for the information of a module, the file mapping is not included
+duint ModMemoryUsage(const MODINFO & Info)
+{
+    return sizeof(MODINFO) +
+           Info.sections.capacity() * sizeof(MODSECTIONINFO) +
+           Info.imports.capacity() * sizeof(MODIMPORT) +
+           Info.importNames.capacity();
+}
+
 int ModGetParty(duint Address)
 {
     SHARED_ACQUIRE(LockModules);
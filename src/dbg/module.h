@@ -12,9 +12,17 @@ struct MODSECTIONINFO
 
 struct MODIMPORTINFO
 {
-    duint addr;     // Virtual address
-    char name[MAX_IMPORT_SIZE];
-    char moduleName[MAX_MODULE_SIZE];
+    duint addr;         // Virtual address of the IAT entry
+    String name;
+    String moduleName;
+};
+
+// Compact import entry as stored in MODINFO, the names are offsets in MODINFO::importNames
+struct MODIMPORT
+{
+    duint iatRva;
+    unsigned int name;
+    unsigned int moduleName;
 };
 
 struct MODINFO
@@ -29,7 +37,11 @@ struct MODINFO
     char path[MAX_PATH];                // File path (in UTF8)
 
     std::vector<MODSECTIONINFO> sections;
-    std::vector<MODIMPORTINFO> imports;
+    bool importsParsed;                 // Imports are parsed on first use
+    std::vector<MODIMPORT> imports;
+    String importNames;                 // Zero terminated import and module names, every module name is stored once
+    duint importDirectoryRva;           // Import directory of the image the imports are parsed from
+    duint importDirectorySize;
 
     HANDLE fileHandle;
     DWORD loadedSize;
@@ -37,6 +49,34 @@ struct MODINFO
     ULONG_PTR fileMapVA;
 
     int party;  // Party. Currently used value: 0: User, 1: System
+
+    unsigned long long imageHash[2]; // Content hash of the image (zero when unknown)
+
+    duint loadTime; // Time spent in ModLoad (in microseconds), the background stages are not included
+};
+
+// Stages of loading a module, Symbols/Module/Breakpoints run in the debug event and the rest in the background
+enum class ModLoadStage
+{
+    Symbols,
+    Module,
+    Breakpoints,
+    ImageHash,
+    AnalysisCache,
+    Exports,
+    Count
+};
+
+// Adds the time between construction and destruction to the statistics of a stage
+class ModStageTimer
+{
+public:
+    explicit ModStageTimer(ModLoadStage Stage);
+    ~ModStageTimer();
+
+private:
+    ModLoadStage stage;
+    LARGE_INTEGER start;
 };
 
 bool ModLoad(duint Base, duint Size, const char* FullPath);
@@ -55,8 +95,14 @@ duint ModEntryFromAddr(duint Address);
 int ModPathFromAddr(duint Address, char* Path, int Size);
 int ModPathFromName(const char* Module, char* Path, int Size);
 void ModGetList(std::vector<MODINFO> & list);
+void ModEnum(const std::function<void(const MODINFO &)> & cbEnum);
 int ModGetParty(duint Address);
 void ModSetParty(duint Address, int Party);
 bool ModAddImportToModule(duint Base, const MODIMPORTINFO & importInfo);
+duint ModMemoryUsage(const MODINFO & Info);
+void ModPipelineWait(duint Base, bool Cancel = false);
+void ModAddStageTime(ModLoadStage Stage, duint Microseconds);
+const char* ModStageName(ModLoadStage Stage);
+void ModStageStatistics(ModLoadStage Stage, duint & Count, duint & Microseconds);
 
 #endif // _MODULE_H
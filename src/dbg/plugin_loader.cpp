@@ -25,6 +25,19 @@ static int curPluginHandle = 0;
 */
 static std::vector<PLUG_CALLBACK> pluginCallbackList;
 
+/**
+\brief Immutable snapshots of the callbacks per type, republished when a callback of that type changes.
+*/
+typedef std::vector<PLUG_CALLBACK> PLUG_CALLBACKSNAPSHOT;
+static std::shared_ptr<const PLUG_CALLBACKSNAPSHOT> pluginCallbackSnapshots[CB_SAVEDB + 1];
+
+/**
+\brief Whether the time spent in plugin callbacks is measured.
+*/
+static volatile bool pluginCallbackTiming = false;
+
+static void plugincbunregisterall(int pluginHandle);
+
 /**
 \brief List of plugin commands.
 */
@@ -190,12 +203,14 @@ void pluginload(const char* pluginDir)
         if(!pluginData.pluginit(&pluginData.initStruct))
         {
             dprintf("[PLUGIN] pluginit failed for plugin: %s\n", StringUtils::Utf16ToUtf8(foundData.cFileName).c_str());
+            plugincbunregisterall(curPluginHandle);
             FreeLibrary(pluginData.hPlugin);
             continue;
         }
         else if(pluginData.initStruct.sdkVersion < PLUG_SDKVERSION) //the plugin SDK is not compatible
         {
             dprintf("[PLUGIN] %s is incompatible with this SDK version\n", pluginData.initStruct.pluginName);
+            plugincbunregisterall(curPluginHandle);
             FreeLibrary(pluginData.hPlugin);
             continue;
         }
@@ -360,6 +375,8 @@ void pluginunload()
     {
         EXCLUSIVE_ACQUIRE(LockPluginCallbackList);
         pluginCallbackList.clear(); //remove all callbacks
+        for(auto & snapshot : pluginCallbackSnapshots)
+            snapshot.reset();
     }
     {
         EXCLUSIVE_ACQUIRE(LockPluginMenuList);
@@ -373,6 +390,22 @@ void pluginunload()
     GuiMenuClear(GUI_PLUGIN_MENU); //clear the plugin menu
 }
 
+/**
+\brief Publishes a new snapshot of the callbacks of a certain type. The lock on the callback list must be held exclusively.
+\param cbType The type of the callbacks to publish.
+*/
+static void plugincbpublish(CBTYPE cbType)
+{
+    auto snapshot = std::make_shared<PLUG_CALLBACKSNAPSHOT>();
+    for(const auto & currentCallback : pluginCallbackList)
+        if(currentCallback.cbType == cbType)
+            snapshot->push_back(currentCallback);
+    if(snapshot->empty())
+        pluginCallbackSnapshots[cbType].reset();
+    else
+        pluginCallbackSnapshots[cbType] = snapshot;
+}
+
 /**
 \brief Register a plugin callback.
 \param pluginHandle Handle of the plugin to register a callback for.
@@ -381,13 +414,19 @@ void pluginunload()
 */
 void pluginregistercallback(int pluginHandle, CBTYPE cbType, CBPLUGIN cbPlugin)
 {
+    if(cbType < 0 || cbType > CB_SAVEDB || IsBadReadPtr((const void*)cbPlugin, sizeof(duint)))
+        return;
     pluginunregistercallback(pluginHandle, cbType); //remove previous callback
     PLUG_CALLBACK cbStruct;
     cbStruct.pluginHandle = pluginHandle;
     cbStruct.cbType = cbType;
     cbStruct.cbPlugin = cbPlugin;
+    cbStruct.stats = std::make_shared<PLUG_CALLBACKSTATS>();
+    cbStruct.stats->calls = 0;
+    cbStruct.stats->ticks = 0;
     EXCLUSIVE_ACQUIRE(LockPluginCallbackList);
     pluginCallbackList.push_back(cbStruct);
+    plugincbpublish(cbType);
 }
 
 /**
@@ -404,12 +443,36 @@ bool pluginunregistercallback(int pluginHandle, CBTYPE cbType)
         if(currentCallback.pluginHandle == pluginHandle && currentCallback.cbType == cbType)
         {
             pluginCallbackList.erase(it);
+            plugincbpublish(cbType);
             return true;
         }
     }
     return false;
 }
 
+/**
+\brief Unregister all callbacks of a plugin.
+\param pluginHandle Handle of the plugin to unregister the callbacks from.
+*/
+static void plugincbunregisterall(int pluginHandle)
+{
+    EXCLUSIVE_ACQUIRE(LockPluginCallbackList);
+    bool changed[CB_SAVEDB + 1] = {};
+    for(auto it = pluginCallbackList.begin(); it != pluginCallbackList.end();)
+    {
+        if(it->pluginHandle == pluginHandle)
+        {
+            changed[it->cbType] = true;
+            it = pluginCallbackList.erase(it);
+        }
+        else
+            ++it;
+    }
+    for(int i = 0; i <= CB_SAVEDB; i++)
+        if(changed[i])
+            plugincbpublish(CBTYPE(i));
+}
+
 /**
 \brief Call all registered callbacks of a certain type.
 \param cbType The type of callbacks to call.
@@ -417,18 +480,86 @@ bool pluginunregistercallback(int pluginHandle, CBTYPE cbType)
 */
 void plugincbcall(CBTYPE cbType, void* callbackInfo)
 {
+    if(cbType < 0 || cbType > CB_SAVEDB)
+        return;
     SHARED_ACQUIRE(LockPluginCallbackList);
-    auto callbackList = pluginCallbackList; //copy for thread-safety reasons
+    auto snapshot = pluginCallbackSnapshots[cbType]; //the snapshot stays alive while the callbacks run
     SHARED_RELEASE();
-    for(const auto & currentCallback : callbackList)
+    if(!snapshot)
+        return;
+    if(!pluginCallbackTiming)
     {
-        if(currentCallback.cbType == cbType)
+        for(const auto & currentCallback : *snapshot)
+            currentCallback.cbPlugin(cbType, callbackInfo);
+        return;
+    }
+    for(const auto & currentCallback : *snapshot)
+    {
+        LARGE_INTEGER start, end;
+        QueryPerformanceCounter(&start);
+        currentCallback.cbPlugin(cbType, callbackInfo);
+        QueryPerformanceCounter(&end);
+        InterlockedIncrement64(&currentCallback.stats->calls);
+        InterlockedExchangeAdd64(&currentCallback.stats->ticks, end.QuadPart - start.QuadPart);
+    }
+}
+
+/**
+\brief Enable or disable measuring the time spent in plugin callbacks. Enabling resets the counters.
+\param enable true to enable the measurements.
+*/
+void plugincbtiming(bool enable)
+{
+    if(enable)
+    {
+        SHARED_ACQUIRE(LockPluginCallbackList);
+        for(const auto & currentCallback : pluginCallbackList)
         {
-            CBPLUGIN cbPlugin = currentCallback.cbPlugin;
-            if(!IsBadReadPtr((const void*)cbPlugin, sizeof(duint)))
-                cbPlugin(cbType, callbackInfo);
+            InterlockedExchange64(&currentCallback.stats->calls, 0);
+            InterlockedExchange64(&currentCallback.stats->ticks, 0);
         }
     }
+    pluginCallbackTiming = enable;
+}
+
+/**
+\brief Print the measured time spent in plugin callbacks, per plugin and callback type.
+*/
+void plugincbtimingprint()
+{
+    static const char* cbNames[CB_SAVEDB + 1] =
+    {
+        "CB_INITDEBUG", "CB_STOPDEBUG", "CB_CREATEPROCESS", "CB_EXITPROCESS", "CB_CREATETHREAD", "CB_EXITTHREAD",
+        "CB_SYSTEMBREAKPOINT", "CB_LOADDLL", "CB_UNLOADDLL", "CB_OUTPUTDEBUGSTRING", "CB_EXCEPTION", "CB_BREAKPOINT",
+        "CB_PAUSEDEBUG", "CB_RESUMEDEBUG", "CB_STEPPED", "CB_ATTACH", "CB_DETACH", "CB_DEBUGEVENT", "CB_MENUENTRY",
+        "CB_WINEVENT", "CB_WINEVENTGLOBAL", "CB_LOADDB", "CB_SAVEDB"
+    };
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    std::unordered_map<int, String> pluginNames;
+    {
+        SHARED_ACQUIRE(LockPluginList);
+        for(const auto & currentPlugin : pluginList)
+            pluginNames[currentPlugin.initStruct.pluginHandle] = currentPlugin.initStruct.pluginName;
+    }
+    SHARED_ACQUIRE(LockPluginCallbackList);
+    size_t count = 0;
+    for(const auto & currentCallback : pluginCallbackList)
+    {
+        auto calls = currentCallback.stats->calls;
+        if(!calls)
+            continue;
+        auto us = double(currentCallback.stats->ticks) * 1000000.0 / double(frequency.QuadPart);
+        dprintf("[PLUGIN] %s, %s: %llu call(s), %.0fus total, %.2fus/call\n",
+                pluginNames[currentCallback.pluginHandle].c_str(),
+                cbNames[currentCallback.cbType],
+                (unsigned long long)calls,
+                us,
+                us / double(calls));
+        count++;
+    }
+    if(!count)
+        dputs(pluginCallbackTiming ? "No plugin callbacks were called yet" : "Plugin callback timing is disabled");
 }
 
 /**
@@ -615,15 +746,15 @@ void pluginmenucall(int hEntry)
             PLUG_CB_MENUENTRY menuEntryInfo;
             menuEntryInfo.hEntry = currentMenu.hEntryPlugin;
             SectionLocker<LockPluginCallbackList, true> callbackLock; //shared lock
-            auto j = pluginCallbackList.begin();
-            while(j != pluginCallbackList.end())
+            auto snapshot = pluginCallbackSnapshots[CB_MENUENTRY];
+            callbackLock.Unlock();
+            if(!snapshot)
+                return;
+            for(const auto & currentCallback : *snapshot)
             {
-                const auto currentCallback = *j;
-                ++j;
-                if(currentCallback.pluginHandle == currentMenu.pluginHandle && currentCallback.cbType == CB_MENUENTRY)
+                if(currentCallback.pluginHandle == currentMenu.pluginHandle)
                 {
                     menuLock.Unlock();
-                    callbackLock.Unlock();
                     currentCallback.cbPlugin(CB_MENUENTRY, &menuEntryInfo);
                     return;
                 }
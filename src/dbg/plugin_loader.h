@@ -3,6 +3,7 @@
 
 #include "_global.h"
 #include "_plugins.h"
+#include <memory>
 
 //typedefs
 typedef bool (*PLUGINIT)(PLUG_INITSTRUCT* initStruct);
@@ -30,11 +31,18 @@ struct PLUG_DATA
     PLUG_INITSTRUCT initStruct;
 };
 
+struct PLUG_CALLBACKSTATS
+{
+    volatile LONG64 calls;
+    volatile LONG64 ticks; //performance counter ticks spent in the callback
+};
+
 struct PLUG_CALLBACK
 {
     int pluginHandle;
     CBTYPE cbType;
     CBPLUGIN cbPlugin;
+    std::shared_ptr<PLUG_CALLBACKSTATS> stats;
 };
 
 struct PLUG_COMMAND
@@ -55,6 +63,8 @@ void pluginunload();
 void pluginregistercallback(int pluginHandle, CBTYPE cbType, CBPLUGIN cbPlugin);
 bool pluginunregistercallback(int pluginHandle, CBTYPE cbType);
 void plugincbcall(CBTYPE cbType, void* callbackInfo);
+void plugincbtiming(bool enable);
+void plugincbtimingprint();
 bool plugincmdregister(int pluginHandle, const char* command, CBPLUGINCOMMAND cbCommand, bool debugonly);
 bool plugincmdunregister(int pluginHandle, const char* command);
 int pluginmenuadd(int hMenu, const char* title);
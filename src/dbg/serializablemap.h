@@ -134,7 +134,10 @@ public:
     bool Delete(const TKey & key)
     {
         EXCLUSIVE_ACQUIRE(TLock);
-        return mMap.erase(key) > 0;
+        if(!mMap.erase(key))
+            return false;
+        mRevision++;
+        return true;
     }
 
     void DeleteWhere(TValuePred predicate)
@@ -143,7 +146,10 @@ public:
         for(auto itr = mMap.begin(); itr != mMap.end();)
         {
             if(predicate(itr->second))
+            {
                 itr = mMap.erase(itr);
+                mRevision++;
+            }
             else
                 ++itr;
         }
@@ -163,15 +169,23 @@ public:
     {
         EXCLUSIVE_ACQUIRE(TLock);
         mMap.clear();
+        mRevision++;
     }
 
     void CacheSave(JSON root) const
+    {
+        CacheSaveWhere(root, nullptr);
+    }
+
+    void CacheSaveWhere(JSON root, TValuePred predicate) const
     {
         SHARED_ACQUIRE(TLock);
         auto jsonValues = json_array();
         TSerializer serializer;
         for(const auto & itr : mMap)
         {
+            if(predicate && !predicate(itr.second))
+                continue;
             auto jsonValue = json_object();
             serializer.SetJson(jsonValue);
             if(serializer.Save(itr.second))
@@ -204,6 +218,29 @@ public:
         }
     }
 
+    // Loads values without overwriting existing ones (used for cached analysis)
+    void CacheMerge(JSON root)
+    {
+        EXCLUSIVE_ACQUIRE(TLock);
+        auto jsonValues = json_object_get(root, jsonKey());
+        if(!jsonValues)
+            return;
+        size_t i;
+        JSON jsonValue;
+        TSerializer deserializer;
+        json_array_foreach(jsonValues, i, jsonValue)
+        {
+            deserializer.SetJson(jsonValue);
+            TValue value;
+            if(!deserializer.Load(value))
+                continue;
+            if(mMap.count(makeKey(value)))
+                discardValue(value);
+            else
+                addNoLock(value);
+        }
+    }
+
     void GetList(std::vector<TValue> & values) const
     {
         SHARED_ACQUIRE(TLock);
@@ -248,18 +285,38 @@ public:
         return mMap;
     }
 
+    // Call with the lock held after changing values through GetDataUnsafe
+    void MarkModified()
+    {
+        mRevision++;
+    }
+
+    // Changes with every modification, used to skip saving unchanged data
+    unsigned int Revision() const
+    {
+        SHARED_ACQUIRE(TLock);
+        return mRevision;
+    }
+
     virtual void AdjustValue(TValue & value) const = 0;
 
 protected:
     virtual const char* jsonKey() const = 0;
     virtual TKey makeKey(const TValue & value) const = 0;
 
+    // Releases resources of a loaded value that was not added (called with the lock held)
+    virtual void discardValue(TValue & value) const
+    {
+    }
+
 private:
     TMap mMap;
+    unsigned int mRevision = 0;
 
     bool addNoLock(const TValue & value)
     {
         mMap[makeKey(value)] = value;
+        mRevision++;
         return true;
     }
 
@@ -12,8 +12,33 @@
 #include "filehelper.h"
 #include "stringformat.h"
 
+enum SCRIPTOPCODE
+{
+    scriptopnone, //empty line, comment or label
+    scriptopret,
+    scriptopinvalid,
+    scriptoppause,
+    scriptopnop,
+    scriptopcommand,
+    scriptopbranch
+};
+
+//pre-resolved form of a script line, built when the script is loaded
+struct SCRIPTINSTRUCTION
+{
+    SCRIPTOPCODE op;
+    int labelline; //branch target (the line of the label)
+    CMDINVOCATION invocation; //pre-parsed command
+};
+
 static std::vector<LINEMAPENTRY> linemap;
 
+static std::vector<SCRIPTINSTRUCTION> scriptcode;
+
+static std::vector<int> scriptnext; //scriptinternalstep lookup table
+
+static std::unordered_map<String, int> scriptlabels;
+
 static std::vector<SCRIPTBP> scriptbplist;
 
 static std::vector<int> scriptstack;
@@ -51,11 +76,8 @@ static SCRIPTBRANCHTYPE scriptgetbranchtype(const char* text)
 
 static int scriptlabelfind(const char* labelname)
 {
-    int linecount = (int)linemap.size();
-    for(int i = 0; i < linecount; i++)
-        if(linemap.at(i).type == linelabel && !strcmp(linemap.at(i).u.label, labelname))
-            return i + 1;
-    return 0;
+    auto found = scriptlabels.find(labelname);
+    return found == scriptlabels.end() ? 0 : found->second;
 }
 
 static inline bool isEmptyLine(SCRIPTLINETYPE type)
@@ -68,12 +90,75 @@ static int scriptinternalstep(int fromIp) //internal step routine
     int maxIp = (int)linemap.size(); //maximum ip
     if(fromIp >= maxIp) //script end
         return fromIp;
+    if(scriptnext.size() == linemap.size()) //compiled script
+        return scriptnext[fromIp];
     while(isEmptyLine(linemap.at(fromIp).type) && fromIp < maxIp) //skip empty lines
         fromIp++;
     fromIp++;
     return fromIp;
 }
 
+static bool scriptisinternalcommand(const char* text, const char* cmd)
+{
+    int len = (int)strlen(text);
+    int cmdlen = (int)strlen(cmd);
+    if(cmdlen > len)
+        return false;
+    else if(cmdlen == len)
+        return scmp(text, cmd);
+    else if(text[cmdlen] == ' ')
+        return (!_strnicmp(text, cmd, cmdlen));
+    return false;
+}
+
+/**
+\brief Translates the line map into the instruction stream executed by the run loop.
+*/
+static void scriptcompile()
+{
+    int linecount = (int)linemap.size();
+    scriptcode.resize(linecount);
+    for(int i = 0; i < linecount; i++)
+    {
+        const auto & line = linemap.at(i);
+        auto & instr = scriptcode.at(i);
+        instr.op = scriptopnone;
+        instr.labelline = 0;
+        if(line.type == linebranch)
+        {
+            instr.op = scriptopbranch;
+            instr.labelline = scriptlabelfind(line.u.branch.branchlabel);
+        }
+        else if(line.type == linecommand)
+        {
+            const char* cmd = line.u.command;
+            if(scriptisinternalcommand(cmd, "ret"))
+                instr.op = scriptopret;
+            else if(scriptisinternalcommand(cmd, "invalid"))
+                instr.op = scriptopinvalid;
+            else if(scriptisinternalcommand(cmd, "pause"))
+                instr.op = scriptoppause;
+            else if(scriptisinternalcommand(cmd, "nop"))
+                instr.op = scriptopnop;
+            else if(cmdprepare(cmd, instr.invocation))
+                instr.op = scriptopcommand;
+        }
+    }
+
+    //the next executable line from every position, the last line is always executable
+    scriptnext.resize(linecount);
+    for(int i = linecount - 1; i >= 0; i--)
+        scriptnext[i] = isEmptyLine(linemap.at(i).type) && i + 1 < linecount ? scriptnext[i + 1] : i + 1;
+}
+
+static void scriptclear()
+{
+    std::vector<LINEMAPENTRY>().swap(linemap);
+    std::vector<SCRIPTINSTRUCTION>().swap(scriptcode);
+    std::vector<int>().swap(scriptnext);
+    scriptlabels.clear();
+}
+
 static bool scriptcreatelinemap(const char* filename)
 {
     String filedata;
@@ -86,7 +171,7 @@ static bool scriptcreatelinemap(const char* filename)
     char temp[256] = "";
     LINEMAPENTRY entry;
     memset(&entry, 0, sizeof(entry));
-    std::vector<LINEMAPENTRY>().swap(linemap);
+    scriptclear();
     for(size_t i = 0, j = 0; i < len; i++) //make raw line map
     {
         if(filedata[i] == '\r' && filedata[i + 1] == '\n') //windows file
@@ -184,7 +269,7 @@ static bool scriptcreatelinemap(const char* filename)
                 char message[256] = "";
                 sprintf(message, "Empty label detected on line %d!", i + 1);
                 GuiScriptError(0, message);
-                std::vector<LINEMAPENTRY>().swap(linemap);
+                scriptclear();
                 return false;
             }
             int foundlabel = scriptlabelfind(cur.u.label);
@@ -193,9 +278,10 @@ static bool scriptcreatelinemap(const char* filename)
                 char message[256] = "";
                 sprintf(message, "Duplicate label \"%s\" detected on lines %d and %d!", cur.u.label, foundlabel, i + 1);
                 GuiScriptError(0, message);
-                std::vector<LINEMAPENTRY>().swap(linemap);
+                scriptclear();
                 return false;
             }
+            scriptlabels[cur.u.label] = i + 1;
         }
         else if(scriptgetbranchtype(cur.raw) != scriptnobranch) //branch
         {
@@ -234,7 +320,7 @@ static bool scriptcreatelinemap(const char* filename)
                 char message[256] = "";
                 sprintf(message, "Invalid branch label \"%s\" detected on line %d!", currentLine.u.branch.branchlabel, i + 1);
                 GuiScriptError(0, message);
-                std::vector<LINEMAPENTRY>().swap(linemap);
+                scriptclear();
                 return false;
             }
             else //set the branch destination line
@@ -249,6 +335,7 @@ static bool scriptcreatelinemap(const char* filename)
         strcpy_s(entry.u.command, "ret");
         linemap.push_back(entry);
     }
+    scriptcompile();
     return true;
 }
 
@@ -286,32 +373,28 @@ static bool scriptinternalbptoggle(int line) //internal breakpoint
     return true;
 }
 
-static bool scriptisinternalcommand(const char* text, const char* cmd)
+static CMDRESULT scriptinternalret()
 {
-    int len = (int)strlen(text);
-    int cmdlen = (int)strlen(cmd);
-    if(cmdlen > len)
-        return false;
-    else if(cmdlen == len)
-        return scmp(text, cmd);
-    else if(text[cmdlen] == ' ')
-        return (!_strnicmp(text, cmd, cmdlen));
-    return false;
+    if(!scriptstack.size()) //nothing on the stack
+    {
+        GuiScriptMessage("Script finished!");
+        return STATUS_EXIT;
+    }
+    scriptIp = scriptstack.back(); //set scriptIp to the call address (scriptinternalstep will step over it)
+    scriptstack.pop_back(); //remove last stack entry
+    return STATUS_CONTINUE;
+}
+
+static void scriptwaitpaused()
+{
+    while(DbgIsDebugging() && dbgisrunning()) //while not locked (NOTE: possible deadlock)
+        Sleep(10);
 }
 
 static CMDRESULT scriptinternalcmdexec(const char* cmd)
 {
     if(scriptisinternalcommand(cmd, "ret")) //script finished
-    {
-        if(!scriptstack.size()) //nothing on the stack
-        {
-            GuiScriptMessage("Script finished!");
-            return STATUS_EXIT;
-        }
-        scriptIp = scriptstack.back(); //set scriptIp to the call address (scriptinternalstep will step over it)
-        scriptstack.pop_back(); //remove last stack entry
-        return STATUS_CONTINUE;
-    }
+        return scriptinternalret();
     else if(scriptisinternalcommand(cmd, "invalid")) //invalid command for testing
         return STATUS_ERROR;
     else if(scriptisinternalcommand(cmd, "pause")) //pause the script
@@ -337,8 +420,34 @@ static CMDRESULT scriptinternalcmdexec(const char* cmd)
         return STATUS_CONTINUE;
     }
     CMDRESULT res = cmddirectexec(command);
-    while(DbgIsDebugging() && dbgisrunning()) //while not locked (NOTE: possible deadlock)
-        Sleep(10);
+    scriptwaitpaused();
+    return res;
+}
+
+/**
+\brief Executes a compiled script line, equivalent to scriptinternalcmdexec on its text.
+*/
+static CMDRESULT scriptinstrexec(SCRIPTINSTRUCTION & instr)
+{
+    switch(instr.op)
+    {
+    case scriptopret:
+        return scriptinternalret();
+    case scriptopinvalid:
+        return STATUS_ERROR;
+    case scriptoppause:
+        return STATUS_PAUSE;
+    case scriptopcommand:
+        break;
+    default:
+        return STATUS_CONTINUE;
+    }
+
+    CMDRESULT res = cmdinvoke(instr.invocation);
+    auto cmd = instr.invocation.cmd;
+    if(!cmd || arraycontains(cmd->name, "var")) //expression or var
+        return cmd ? STATUS_CONTINUE : res;
+    scriptwaitpaused();
     return res;
 }
 
@@ -389,10 +498,11 @@ static bool scriptinternalbranch(SCRIPTBRANCHTYPE type) //determine if we should
 static bool scriptinternalcmd()
 {
     bool bContinue = true;
-    LINEMAPENTRY cur = linemap.at(scriptIp - 1);
+    const LINEMAPENTRY & cur = linemap.at(scriptIp - 1);
+    auto & instr = scriptcode.at(scriptIp - 1);
     if(cur.type == linecommand)
     {
-        switch(scriptinternalcmdexec(cur.u.command))
+        switch(scriptinstrexec(instr))
         {
         case STATUS_CONTINUE:
             break;
@@ -417,7 +527,7 @@ static bool scriptinternalcmd()
         if(cur.u.branch.type == scriptcall) //calls have a special meaning
             scriptstack.push_back(scriptIp);
         if(scriptinternalbranch(cur.u.branch.type))
-            scriptIp = scriptlabelfind(cur.u.branch.branchlabel);
+            scriptIp = instr.labelline;
     }
     return bContinue;
 }
@@ -438,9 +548,12 @@ static DWORD WINAPI scriptRunThread(void* arg)
         scriptIp--;
     scriptIp = scriptinternalstep(scriptIp);
     bool bContinue = true;
+    unsigned long long lines = 0;
+    DWORD ticks = GetTickCount();
     while(bContinue && !bAbort) //run loop
     {
         bContinue = scriptinternalcmd();
+        lines++;
         if(scriptIp == scriptinternalstep(scriptIp)) //end of script
         {
             bContinue = false;
@@ -450,8 +563,9 @@ static DWORD WINAPI scriptRunThread(void* arg)
             scriptIp = scriptinternalstep(scriptIp); //this is the next ip
         if(scriptinternalbpget(scriptIp)) //breakpoint=stop run loop
             bContinue = false;
-        Sleep(1); //don't fry the processor
     }
+    ticks = GetTickCount() - ticks;
+    dprintf("Script executed %llu lines in %ums (%llu lines/sec)\n", lines, ticks, ticks ? lines * 1000 / ticks : lines);
     bIsRunning = false; //not running anymore
     GuiScriptSetIp(scriptIp);
     return 0;
@@ -142,12 +142,35 @@ bool stackcommentget(duint addr, STACK_COMMENT* comment)
     return false;
 }
 
+// Copy of the stack memory [start, end) that a walk reads from
+struct StackSnapshot
+{
+    duint start = 0;
+    duint end = 0;
+    std::vector<unsigned char> data;
+};
+
+// Larger stacks are read page by page like before
+#define MAX_STACK_SNAPSHOT (64 * 1024 * 1024)
+
+// Only used during a walk, walks are serialized by LockCallstackWalk
+static const StackSnapshot* walkSnapshot = nullptr;
+
 BOOL CALLBACK StackReadProcessMemoryProc64(HANDLE hProcess, DWORD64 lpBaseAddress, PVOID lpBuffer, DWORD nSize, LPDWORD lpNumberOfBytesRead)
 {
+    auto address = (duint)lpBaseAddress;
+    if(walkSnapshot && address >= walkSnapshot->start && address < walkSnapshot->end && nSize <= walkSnapshot->end - address)
+    {
+        memcpy(lpBuffer, walkSnapshot->data.data() + (address - walkSnapshot->start), nSize);
+        if(lpNumberOfBytesRead)
+            *lpNumberOfBytesRead = nSize;
+        return true;
+    }
+
     // Fix for 64-bit sizes
     SIZE_T bytesRead = 0;
 
-    if(MemRead((duint)lpBaseAddress, lpBuffer, nSize, &bytesRead))
+    if(MemRead(address, lpBuffer, nSize, &bytesRead))
     {
         if(lpNumberOfBytesRead)
             *lpNumberOfBytesRead = (DWORD)bytesRead;
@@ -174,46 +197,130 @@ void StackEntryFromFrame(CALLSTACKENTRY* Entry, duint Address, duint From, duint
     Entry->addr = Address;
     Entry->from = From;
     Entry->to = To;
+}
+
+// Resolves the names of the entries starting at First in one batch
+static void StackEntryComments(std::vector<CALLSTACKENTRY> & Entries, size_t First)
+{
+    if(First >= Entries.size())
+        return;
+    std::vector<duint> addresses;
+    addresses.reserve((Entries.size() - First) * 2);
+    for(size_t i = First; i < Entries.size(); i++)
+    {
+        addresses.push_back(Entries[i].to);
+        addresses.push_back(Entries[i].from);
+    }
+    std::vector<String> names;
+    SymGetSymbolicNames(addresses, names);
 
-    auto getSymAddrName = [](duint addr)
+    auto getSymAddrName = [&](size_t index)
     {
-        auto symname = SymGetSymbolicName(addr);
-        if(!symname.length())
-            symname = StringUtils::sprintf(fhex, addr);
-        return symname;
+        if(names[index].empty())
+            return StringUtils::sprintf(fhex, addresses[index]);
+        return names[index];
     };
 
-    char returnToAddr[MAX_COMMENT_SIZE] = "";
-    strncpy_s(returnToAddr, getSymAddrName(Entry->to).c_str(), _TRUNCATE);
+    for(size_t i = First; i < Entries.size(); i++)
+    {
+        auto & entry = Entries[i];
+        auto index = (i - First) * 2;
+        char returnToAddr[MAX_COMMENT_SIZE] = "";
+        strncpy_s(returnToAddr, getSymAddrName(index).c_str(), _TRUNCATE);
 
-    if(Entry->from)
-        sprintf_s(Entry->comment, "return to %s from %s", returnToAddr, getSymAddrName(Entry->from).c_str());
-    else
-        sprintf_s(Entry->comment, "return to %s from ???", returnToAddr);
+        if(entry.from)
+            sprintf_s(entry.comment, "return to %s from %s", returnToAddr, getSymAddrName(index + 1).c_str());
+        else
+            sprintf_s(entry.comment, "return to %s from ???", returnToAddr);
+    }
 }
 
+// The part of the STACKFRAME64 that identifies a frame
+struct CallstackFrame
+{
+    DWORD64 pc;
+    DWORD64 ret;
+    DWORD64 frame;
+    DWORD64 stack;
+};
+
+// Result of the last walk of a thread, published results are never modified
+struct CallstackThreadCache
+{
+    duint csp = 0;
+    bool complete = false; // false while a progressive walk is still running
+    std::vector<CALLSTACKENTRY> entries;
+    std::vector<CallstackFrame> frames;
+    StackSnapshot snapshot;
+};
+
 #define MAX_CALLSTACK_CACHE 20
-using CallstackMap = std::unordered_map<duint, std::vector<CALLSTACKENTRY>>;
+using CallstackMap = std::unordered_map<DWORD, std::shared_ptr<const CallstackThreadCache>>;
 static CallstackMap CallstackCache;
 
-void stackupdatecallstack(duint csp)
+// Interval in which a progressive walk publishes the frames found so far
+#define CALLSTACK_PROGRESS_INTERVAL 100
+
+static void stackpublish(DWORD threadId, std::shared_ptr<const CallstackThreadCache> result)
 {
-    std::vector<CALLSTACKENTRY> callstack;
-    stackgetcallstack(csp, callstack, false);
+    EXCLUSIVE_ACQUIRE(LockCallstackCache);
+    if(CallstackCache.size() > MAX_CALLSTACK_CACHE)
+        CallstackCache.clear();
+    CallstackCache[threadId] = std::move(result);
 }
 
-void stackgetcallstack(duint csp, std::vector<CALLSTACKENTRY> & callstackVector, bool cache)
+static std::shared_ptr<const CallstackThreadCache> stackcached(DWORD threadId)
 {
-    if(cache)
+    SHARED_ACQUIRE(LockCallstackCache);
+    auto found = CallstackCache.find(threadId);
+    if(found == CallstackCache.end())
+        return nullptr;
+    return found->second;
+}
+
+static void stacksnapshot(DWORD threadId, duint csp, StackSnapshot & snapshot)
+{
+    duint end = 0;
+    NT_TIB tib;
+    if(ThreadGetTib(ThreadGetLocalBase(threadId), &tib))
+        end = (duint)tib.StackBase;
+    if(end <= csp)
     {
-        SHARED_ACQUIRE(LockCallstackCache);
-        auto found = CallstackCache.find(csp);
-        if(found != CallstackCache.end())
-        {
-            callstackVector = found->second;
-            return;
-        }
+        duint size = 0;
+        duint base = MemFindBaseAddr(csp, &size);
+        end = base ? base + size : 0;
+    }
+    if(end <= csp || end - csp > MAX_STACK_SNAPSHOT)
+        return;
+    snapshot.data.resize(end - csp);
+    if(!MemRead(csp, snapshot.data.data(), snapshot.data.size()))
+    {
+        snapshot.data.clear();
+        return;
     }
+    snapshot.start = csp;
+    snapshot.end = end;
+}
+
+static void stackwalk(duint csp, std::vector<CALLSTACKENTRY> & callstackVector, bool cache, bool progressive)
+{
+    DWORD threadId = ThreadGetId(hActiveThread);
+    auto getCached = [&](bool completeOnly)
+    {
+        auto cached = stackcached(threadId);
+        if(!cached || cached->csp != csp || (completeOnly && !cached->complete))
+            return false;
+        callstackVector = cached->entries;
+        return true;
+    };
+    if(cache && getCached(false))
+        return;
+
+    EXCLUSIVE_ACQUIRE(LockCallstackWalk);
+
+    // Another walk of the same stack might have finished in the meantime
+    if(cache && getCached(true))
+        return;
 
     // Gather context data
     CONTEXT context;
@@ -252,10 +359,37 @@ void stackgetcallstack(duint csp, std::vector<CALLSTACKENTRY> & callstackVector,
     frame.AddrStack.Mode = AddrModeFlat;
 #endif
 
+    // Read the whole stack at once, StackWalk64 reads it in small pieces
+    auto result = std::make_shared<CallstackThreadCache>();
+    result->csp = csp;
+    stacksnapshot(threadId, csp, result->snapshot);
+
+    // The walk only depends on the stack memory at and above the frame's stack pointer, so the frames of the
+    // previous walk can be reused from the first frame that is identical and has no changed memory above it
+    auto previous = stackcached(threadId);
+    std::unordered_map<DWORD64, size_t> previousFrames;
+    duint unchangedStart = 0;
+    if(previous && previous->complete && !previous->snapshot.data.empty() && !result->snapshot.data.empty() && previous->snapshot.end == result->snapshot.end)
+    {
+        auto overlap = max(previous->snapshot.start, result->snapshot.start);
+        auto oldData = previous->snapshot.data.data() + (overlap - previous->snapshot.start);
+        auto newData = result->snapshot.data.data() + (overlap - result->snapshot.start);
+        auto size = result->snapshot.end - overlap;
+        while(size && oldData[size - 1] == newData[size - 1])
+            size--;
+        unchangedStart = overlap + size;
+        previousFrames.reserve(previous->frames.size());
+        for(size_t i = 0; i < previous->frames.size(); i++)
+            previousFrames.emplace(previous->frames[i].stack, i);
+    }
+
     // Container for each callstack entry (20 pre-allocated entries)
     callstackVector.clear();
     callstackVector.reserve(20);
 
+    walkSnapshot = &result->snapshot;
+    size_t commented = 0;
+    auto lastProgress = GetTickCount();
     while(true)
     {
         if(!StackWalk64(
@@ -281,6 +415,33 @@ void stackgetcallstack(duint csp, std::vector<CALLSTACKENTRY> & callstackVector,
 
             StackEntryFromFrame(&entry, (duint)frame.AddrFrame.Offset + sizeof(duint), (duint)frame.AddrPC.Offset, (duint)frame.AddrReturn.Offset);
             callstackVector.push_back(entry);
+            CallstackFrame current = { frame.AddrPC.Offset, frame.AddrReturn.Offset, frame.AddrFrame.Offset, frame.AddrStack.Offset };
+            result->frames.push_back(current);
+
+            auto found = previousFrames.find(current.stack);
+            if(found != previousFrames.end() && current.stack >= unchangedStart)
+            {
+                const auto & old = previous->frames[found->second];
+                if(old.pc == current.pc && old.ret == current.ret && old.frame == current.frame)
+                {
+                    // The rest of the walk would repeat the previous one
+                    callstackVector.insert(callstackVector.end(), previous->entries.begin() + found->second + 1, previous->entries.end());
+                    result->frames.insert(result->frames.end(), previous->frames.begin() + found->second + 1, previous->frames.end());
+                    break;
+                }
+            }
+
+            if(progressive && GetTickCount() - lastProgress >= CALLSTACK_PROGRESS_INTERVAL)
+            {
+                StackEntryComments(callstackVector, commented);
+                commented = callstackVector.size();
+                auto partial = std::make_shared<CallstackThreadCache>();
+                partial->csp = csp;
+                partial->entries = callstackVector;
+                stackpublish(threadId, partial);
+                GuiUpdateCallStack();
+                lastProgress = GetTickCount();
+            }
         }
         else
         {
@@ -288,11 +449,30 @@ void stackgetcallstack(duint csp, std::vector<CALLSTACKENTRY> & callstackVector,
             break;
         }
     }
+    walkSnapshot = nullptr;
+
+    // Reused entries are commented again, labels might have changed
+    StackEntryComments(callstackVector, commented);
+    result->entries = callstackVector;
+    result->complete = true;
+    stackpublish(threadId, result);
+}
+
+void stackupdatecallstack(duint csp)
+{
+    std::vector<CALLSTACKENTRY> callstack;
+    stackwalk(csp, callstack, false, true);
+}
+
+void stackgetcallstack(duint csp, std::vector<CALLSTACKENTRY> & callstackVector, bool cache)
+{
+    stackwalk(csp, callstackVector, cache, false);
+}
 
+void stackclearcallstack()
+{
     EXCLUSIVE_ACQUIRE(LockCallstackCache);
-    if(CallstackCache.size() > MAX_CALLSTACK_CACHE)
-        CallstackCache.clear();
-    CallstackCache[csp] = callstackVector;
+    CallstackCache.clear();
 }
 
 void stackgetcallstack(duint csp, CALLSTACK* callstack)
@@ -2,6 +2,7 @@
 #include "value.h"
 #include "symbolinfo.h"
 #include "module.h"
+#include "expressionparser.h"
 
 namespace ValueType
 {
@@ -14,7 +15,8 @@ namespace ValueType
         Pointer,
         String,
         AddrInfo,
-        Module
+        Module,
+        Literal
     };
 }
 
@@ -179,17 +181,42 @@ String stringformat(String format, const FormatValueVector & values)
     return output;
 }
 
-static String handleFormatStringInline(const String & formatString)
+static void appendLiteral(FormatTemplate & compiled, const String & text)
+{
+    if(!compiled.empty() && compiled.back().type == ValueType::Literal)
+    {
+        compiled.back().text += text;
+        return;
+    }
+    FormatSegment segment;
+    segment.text = text;
+    segment.type = ValueType::Literal;
+    compiled.push_back(segment);
+}
+
+static void compileFormatStringInline(FormatTemplate & compiled, const String & formatString)
 {
     auto type = ValueType::Unknown;
     auto value = getArgExpressionType(formatString, type);
-    if(value && *value)
-        return printValue(value, type);
-    return "[Formatting Error]";
+    if(!value || !*value)
+    {
+        appendLiteral(compiled, "[Formatting Error]");
+        return;
+    }
+    FormatSegment segment;
+    segment.type = type;
+    segment.expression = std::make_shared<ExpressionParser>(value);
+    compiled.push_back(segment);
 }
 
-String stringformatinline(String format)
+/**
+\brief Splits an inline format string into literal text and value expressions, so it can be formatted repeatedly without parsing it again.
+\param format The format string.
+\param [out] compiled The compiled template.
+*/
+void stringformatcompile(String format, FormatTemplate & compiled)
 {
+    compiled.clear();
     StringUtils::ReplaceAll(format, "\\n", "\n");
     int len = (int)format.length();
     String output;
@@ -221,7 +248,10 @@ String stringformatinline(String format)
             inFormatter = false;
             if(formatString.length())
             {
-                output += handleFormatStringInline(formatString);
+                if(output.length())
+                    appendLiteral(compiled, output);
+                output.clear();
+                compileFormatStringInline(compiled, formatString);
                 formatString.clear();
             }
         }
@@ -231,8 +261,119 @@ String stringformatinline(String format)
             output += format[i];
     }
     if(inFormatter && formatString.size())
-        output += handleFormatStringInline(formatString);
+    {
+        if(output.length())
+            appendLiteral(compiled, output);
+        output.clear();
+        compileFormatStringInline(compiled, formatString);
+    }
     else if(inFormatter)
         output += "{";
+    if(output.length())
+        appendLiteral(compiled, output);
+}
+
+/**
+\brief Evaluates the expressions of a compiled template. Strings, symbols and modules are formatted immediately, numbers are formatted by stringformatrender.
+\param compiled The compiled template.
+\param [out] values The values, one for each segment of the template.
+*/
+void stringformatevaluate(const FormatTemplate & compiled, FormatValues & values)
+{
+    values.resize(compiled.size());
+    for(size_t i = 0; i < compiled.size(); i++)
+    {
+        const auto & segment = compiled[i];
+        auto & value = values[i];
+        value.text.clear();
+        value.valid = segment.expression && segment.expression->Calculate(value.value, valuesignedcalc(), false);
+        if(!value.valid)
+            continue;
+        char string[MAX_STRING_SIZE] = "";
+        switch(segment.type)
+        {
+        case ValueType::String:
+            value.text = DbgGetStringAt(value.value, string) ? string : "???";
+            break;
+        case ValueType::AddrInfo:
+            if(DbgGetStringAt(value.value, string))
+                value.text = string;
+            else
+                value.text = SymGetSymbolicName(value.value);
+            break;
+        case ValueType::Module:
+        {
+            char mod[MAX_MODULE_SIZE] = "";
+            ModNameFromAddr(value.value, mod, true);
+            value.text = mod;
+        }
+        break;
+        default:
+            break;
+        }
+    }
+}
+
+/**
+\brief Formats the evaluated values of a compiled template.
+\param compiled The compiled template.
+\param values The values from stringformatevaluate.
+\return The formatted string.
+*/
+String stringformatrender(const FormatTemplate & compiled, const FormatValues & values)
+{
+    String output;
+    for(size_t i = 0; i < compiled.size(); i++)
+    {
+        const auto & segment = compiled[i];
+        if(segment.type == ValueType::Literal)
+        {
+            output += segment.text;
+            continue;
+        }
+        const auto & value = values[i];
+        if(!value.valid)
+        {
+            output += "???";
+            continue;
+        }
+        switch(segment.type)
+        {
+        case ValueType::SignedDecimal:
+            output += StringUtils::sprintf("%" fext "d", value.value);
+            break;
+        case ValueType::UnsignedDecimal:
+            output += StringUtils::sprintf("%" fext "u", value.value);
+            break;
+        case ValueType::Hex:
+            output += StringUtils::sprintf("%" fext "X", value.value);
+            break;
+        case ValueType::Pointer:
+            output += StringUtils::sprintf(fhex, value.value);
+            break;
+        case ValueType::String:
+        case ValueType::AddrInfo:
+        case ValueType::Module:
+            output += value.text;
+            break;
+        default:
+            output += "???";
+            break;
+        }
+    }
     return output;
 }
+
+String stringformatinline(const FormatTemplate & compiled)
+{
+    FormatValues values;
+    stringformatevaluate(compiled, values);
+    return stringformatrender(compiled, values);
+}
+
+String stringformatinline(String format)
+{
+    FormatTemplate compiled;
+    stringformatcompile(format, compiled);
+    return stringformatinline(compiled);
+}
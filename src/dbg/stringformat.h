@@ -2,11 +2,38 @@
 #define _STRINGFORMAT_H
 
 #include "_global.h"
+#include <memory>
+
+class ExpressionParser;
 
 typedef const char* FormatValueType;
 typedef std::vector<FormatValueType> FormatValueVector;
 
+//an inline format string split into literal text and pre-parsed value expressions
+struct FormatSegment
+{
+    String text; //literal text (only used when there is no expression)
+    int type;
+    std::shared_ptr<ExpressionParser> expression;
+};
+
+typedef std::vector<FormatSegment> FormatTemplate;
+
+//the evaluated values of a template, types that depend on the debuggee state are formatted immediately
+struct FormatValue
+{
+    bool valid;
+    duint value;
+    String text;
+};
+
+typedef std::vector<FormatValue> FormatValues;
+
 String stringformat(String format, const FormatValueVector & values);
 String stringformatinline(String format);
+void stringformatcompile(String format, FormatTemplate & compiled);
+void stringformatevaluate(const FormatTemplate & compiled, FormatValues & values);
+String stringformatrender(const FormatTemplate & compiled, const FormatValues & values);
+String stringformatinline(const FormatTemplate & compiled);
 
 #endif //_STRINGFORMAT_H
\ No newline at end of file
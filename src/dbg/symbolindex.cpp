@@ -0,0 +1,389 @@
+/**
+@file symbolindex.cpp
+
+@brief Implements a per-module index of the dbghelp symbols, built once in the background and cached on disk.
+*/
+
+#include "symbolindex.h"
+#include "debugger.h"
+#include "module.h"
+#include "analysiscache.h"
+#include "filehelper.h"
+#include "murmurhash.h"
+#include "taskthread.h"
+#include "threading.h"
+#include "symbolinfo.h"
+#include <deque>
+#include <memory>
+
+#ifdef _WIN64
+#define SYMBOL_INDEX_TYPE "si64"
+#else
+#define SYMBOL_INDEX_TYPE "si32"
+#endif // _WIN64
+
+struct SymbolIndexEntry
+{
+    unsigned int rva;
+    unsigned int name; // offset of the decorated name in SymbolIndex::names
+};
+
+// Cache file layout: header, entries, names
+struct SymbolIndexHeader
+{
+    char magic[4]; // "XSI1"
+    unsigned int version;
+    unsigned int symType; // SYM_TYPE the symbols were loaded with, a different PDB invalidates the cache
+    unsigned int pdbAge;
+    GUID pdbSig70;
+    unsigned int entryCount;
+    unsigned int namesSize;
+};
+
+struct SymbolIndex
+{
+    bool ready = false;
+    std::vector<SymbolIndexEntry> entries; // sorted by rva
+    std::vector<char> names; // zero-terminated decorated names
+    std::vector<unsigned int> nameTable; // open addressing on the name hash, entry index + 1 (0 is empty)
+    std::unordered_map<unsigned int, String> undecorated; // entry index -> undecorated name (empty when it can't be undecorated), filled on demand
+};
+
+static std::map<duint, std::shared_ptr<SymbolIndex>> symbolIndexes;
+static std::deque<duint> symbolIndexQueue;
+
+static unsigned int symindexhash(const char* name)
+{
+    unsigned int hash;
+    MurmurHash3_x86_32(name, int(strlen(name)), 0x1337, &hash);
+    return hash;
+}
+
+static BOOL CALLBACK symindexenumsymbols(PSYMBOL_INFO SymInfo, ULONG SymbolSize, PVOID UserContext)
+{
+    auto index = (SymbolIndex*)UserContext;
+
+    // Skip bad ordinals
+    if(SymInfo->Address == SymInfo->ModBase && strstr(SymInfo->Name, "Ordinal"))
+        return TRUE;
+    if(SymInfo->Address < SymInfo->ModBase || SymInfo->Address - SymInfo->ModBase > 0xFFFFFFFF)
+        return TRUE;
+
+    SymbolIndexEntry entry;
+    entry.rva = (unsigned int)(SymInfo->Address - SymInfo->ModBase);
+    entry.name = (unsigned int)index->names.size();
+    index->entries.push_back(entry);
+    index->names.insert(index->names.end(), SymInfo->Name, SymInfo->Name + strnlen(SymInfo->Name, SymInfo->NameLen));
+    index->names.push_back('\0');
+    return TRUE;
+}
+
+static bool symindexmoduleinfo(duint base, IMAGEHLP_MODULEW64 & modInfo)
+{
+    memset(&modInfo, 0, sizeof(modInfo));
+    modInfo.SizeOfStruct = sizeof(modInfo);
+    return !!SafeSymGetModuleInfoW64(fdProcessInfo->hProcess, (DWORD64)base, &modInfo);
+}
+
+static void symindexfinish(SymbolIndex & index)
+{
+    // Symbols at the same address keep the dbghelp order, the first one is used for lookups
+    std::stable_sort(index.entries.begin(), index.entries.end(), [](const SymbolIndexEntry & a, const SymbolIndexEntry & b)
+    {
+        return a.rva < b.rva;
+    });
+
+    size_t tableSize = 16;
+    while(tableSize < index.entries.size() * 2)
+        tableSize *= 2;
+    index.nameTable.assign(tableSize, 0);
+    for(unsigned int i = 0; i < (unsigned int)index.entries.size(); i++)
+    {
+        auto name = index.names.data() + index.entries[i].name;
+        for(auto slot = symindexhash(name) & (tableSize - 1); ; slot = (slot + 1) & (tableSize - 1))
+        {
+            auto & current = index.nameTable[slot];
+            if(!current)
+            {
+                current = i + 1;
+                break;
+            }
+            if(!strcmp(index.names.data() + index.entries[current - 1].name, name))
+                break; // the lowest address wins for duplicate names
+        }
+    }
+}
+
+static bool symindexloadcache(duint base, const IMAGEHLP_MODULEW64 & modInfo, SymbolIndex & index)
+{
+    String fileName;
+    if(!AnalysisCacheFileName(base, SYMBOL_INDEX_TYPE, fileName) || !FileExists(fileName.c_str()))
+        return false;
+    std::vector<unsigned char> data;
+    if(!FileHelper::ReadAllData(fileName, data) || data.size() < sizeof(SymbolIndexHeader))
+        return false;
+    auto header = (const SymbolIndexHeader*)data.data();
+    if(memcmp(header->magic, "XSI1", sizeof(header->magic)) || header->version != SYMBOL_INDEX_VERSION)
+        return false;
+    if(header->symType != modInfo.SymType || header->pdbAge != modInfo.PdbAge || memcmp(&header->pdbSig70, &modInfo.PdbSig70, sizeof(GUID)))
+        return false;
+    auto entriesSize = size_t(header->entryCount) * sizeof(SymbolIndexEntry);
+    if(data.size() != sizeof(SymbolIndexHeader) + entriesSize + header->namesSize)
+        return false;
+
+    auto entries = (const SymbolIndexEntry*)(data.data() + sizeof(SymbolIndexHeader));
+    auto names = (const char*)entries + entriesSize;
+    if(header->namesSize && names[header->namesSize - 1])
+        return false;
+    for(unsigned int i = 0; i < header->entryCount; i++)
+        if(entries[i].name >= header->namesSize)
+            return false;
+    index.entries.assign(entries, entries + header->entryCount);
+    index.names.assign(names, names + header->namesSize);
+    return true;
+}
+
+static void symindexsavecache(duint base, const IMAGEHLP_MODULEW64 & modInfo, const SymbolIndex & index)
+{
+    String fileName;
+    if(!AnalysisCacheFileName(base, SYMBOL_INDEX_TYPE, fileName))
+        return;
+    auto entriesSize = index.entries.size() * sizeof(SymbolIndexEntry);
+    std::vector<char> data(sizeof(SymbolIndexHeader) + entriesSize + index.names.size());
+    auto header = (SymbolIndexHeader*)data.data();
+    memcpy(header->magic, "XSI1", sizeof(header->magic));
+    header->version = SYMBOL_INDEX_VERSION;
+    header->symType = modInfo.SymType;
+    header->pdbAge = modInfo.PdbAge;
+    header->pdbSig70 = modInfo.PdbSig70;
+    header->entryCount = (unsigned int)index.entries.size();
+    header->namesSize = (unsigned int)index.names.size();
+    if(entriesSize)
+        memcpy(data.data() + sizeof(SymbolIndexHeader), index.entries.data(), entriesSize);
+    if(!index.names.empty())
+        memcpy(data.data() + sizeof(SymbolIndexHeader) + entriesSize, index.names.data(), index.names.size());
+    FileHelper::WriteAllData(fileName, data.data(), data.size());
+}
+
+static void symindexworker()
+{
+    while(true)
+    {
+        duint base;
+        std::shared_ptr<SymbolIndex> pending;
+        {
+            EXCLUSIVE_ACQUIRE(LockSymbolIndex);
+            if(symbolIndexQueue.empty())
+                return;
+            base = symbolIndexQueue.front();
+            symbolIndexQueue.pop_front();
+            auto found = symbolIndexes.find(base);
+            if(found == symbolIndexes.end() || found->second->ready)
+                continue; // unloaded or built already
+            pending = found->second;
+        }
+
+        // The enumeration holds the dbghelp lock, lookups fall back to dbghelp until the index is published
+        auto index = std::make_shared<SymbolIndex>();
+        IMAGEHLP_MODULEW64 modInfo;
+        if(!symindexmoduleinfo(base, modInfo))
+            continue; // the index stays unavailable, lookups keep asking dbghelp
+        if(!symindexloadcache(base, modInfo, *index))
+        {
+            index->entries.clear();
+            index->names.clear();
+            if(!SafeSymEnumSymbols(fdProcessInfo->hProcess, base, "*", symindexenumsymbols, index.get()))
+                continue;
+            symindexsavecache(base, modInfo, *index);
+        }
+        symindexfinish(*index);
+        index->ready = true;
+
+        EXCLUSIVE_ACQUIRE(LockSymbolIndex);
+        auto found = symbolIndexes.find(base);
+        if(found != symbolIndexes.end() && found->second == pending)
+        {
+            found->second = index;
+            SymInvalidateAnnotations();
+        }
+    }
+}
+
+/**
+\brief Queues a (re)build of the symbol index of a module, call this after the symbols were (re)loaded.
+\param Base The module base.
+*/
+void SymIndexLoad(duint Base)
+{
+    static auto symIndexTask = MakeTaskThread(symindexworker, 0);
+    {
+        EXCLUSIVE_ACQUIRE(LockSymbolIndex);
+        symbolIndexes[Base] = std::make_shared<SymbolIndex>();
+        symbolIndexQueue.push_back(Base);
+    }
+    symIndexTask.WakeUp();
+}
+
+void SymIndexUnload(duint Base)
+{
+    EXCLUSIVE_ACQUIRE(LockSymbolIndex);
+    symbolIndexes.erase(Base);
+    SymInvalidateAnnotations();
+}
+
+void SymIndexClear()
+{
+    EXCLUSIVE_ACQUIRE(LockSymbolIndex);
+    symbolIndexes.clear();
+    symbolIndexQueue.clear();
+    SymInvalidateAnnotations();
+}
+
+static std::shared_ptr<SymbolIndex> symindexget(duint base)
+{
+    SHARED_ACQUIRE(LockSymbolIndex);
+    auto found = symbolIndexes.find(base);
+    if(found == symbolIndexes.end() || !found->second->ready)
+        return nullptr;
+    return found->second;
+}
+
+static String symindexundecorate(SymbolIndex & index, unsigned int i)
+{
+    {
+        SHARED_ACQUIRE(LockSymbolIndex);
+        auto found = index.undecorated.find(i);
+        if(found != index.undecorated.end())
+            return found->second;
+    }
+    String result;
+    char undecorated[MAX_SYM_NAME];
+    if(SafeUnDecorateSymbolName(index.names.data() + index.entries[i].name, undecorated, MAX_SYM_NAME, UNDNAME_COMPLETE))
+        result = undecorated;
+    EXCLUSIVE_ACQUIRE(LockSymbolIndex);
+    index.undecorated.emplace(i, result);
+    return result;
+}
+
+/**
+\brief Finds the nearest symbol at or below an address.
+\param Address The address to look up.
+\param [out] Displacement The distance from the symbol to the address.
+\param [out] Decorated The decorated symbol name. Can be null.
+\param [out] Undecorated The undecorated symbol name, empty if the name could not be undecorated. Can be null.
+\return SymIndexResult::Unavailable if dbghelp should be asked instead.
+*/
+SymIndexResult SymIndexFromAddr(duint Address, duint & Displacement, String* Decorated, String* Undecorated)
+{
+    auto base = ModBaseFromAddr(Address);
+    if(!base)
+        return SymIndexResult::Unavailable;
+    auto index = symindexget(base);
+    if(!index)
+        return SymIndexResult::Unavailable;
+
+    auto rva = Address - base;
+    auto found = std::upper_bound(index->entries.begin(), index->entries.end(), rva, [](duint value, const SymbolIndexEntry & entry)
+    {
+        return value < entry.rva;
+    });
+    if(found == index->entries.begin())
+        return SymIndexResult::NotFound;
+    --found;
+    found = std::lower_bound(index->entries.begin(), found, found->rva, [](const SymbolIndexEntry & entry, unsigned int value)
+    {
+        return entry.rva < value;
+    });
+
+    Displacement = rva - found->rva;
+    if(Decorated)
+        *Decorated = index->names.data() + found->name;
+    if(Undecorated)
+        *Undecorated = symindexundecorate(*index, (unsigned int)(found - index->entries.begin()));
+    return SymIndexResult::Found;
+}
+
+static bool symindexfindname(const SymbolIndex & index, const char* name, unsigned int hash, unsigned int & rva)
+{
+    auto mask = (unsigned int)index.nameTable.size() - 1;
+    for(auto slot = hash & mask; index.nameTable[slot]; slot = (slot + 1) & mask)
+    {
+        const auto & entry = index.entries[index.nameTable[slot] - 1];
+        if(!strcmp(index.names.data() + entry.name, name))
+        {
+            rva = entry.rva;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+\brief Finds a symbol by its decorated name, "module!name" restricts the search to one module.
+\param Name The symbol name.
+\param [out] Address The symbol address.
+\return SymIndexResult::Unavailable if dbghelp should be asked instead.
+*/
+SymIndexResult SymIndexFromName(const char* Name, duint & Address)
+{
+    unsigned int rva;
+    auto separator = strchr(Name, '!');
+    if(separator)
+    {
+        String moduleName(Name, separator - Name);
+        auto base = moduleName.length() < MAX_MODULE_SIZE ? ModBaseFromName(moduleName.c_str()) : 0;
+        auto index = base ? symindexget(base) : nullptr;
+        if(!index)
+            return SymIndexResult::Unavailable;
+        if(!symindexfindname(*index, separator + 1, symindexhash(separator + 1), rva))
+            return SymIndexResult::NotFound;
+        Address = base + rva;
+        return SymIndexResult::Found;
+    }
+
+    auto hash = symindexhash(Name);
+    auto result = SymIndexResult::NotFound;
+    SHARED_ACQUIRE(LockSymbolIndex);
+    for(const auto & it : symbolIndexes)
+    {
+        if(!it.second->ready)
+            result = SymIndexResult::Unavailable;
+        else if(symindexfindname(*it.second, Name, hash, rva))
+        {
+            Address = it.first + rva;
+            return SymIndexResult::Found;
+        }
+    }
+    return result;
+}
+
+/**
+\brief Enumerates the indexed symbols of a module in address order.
+\param Base The module base.
+\param EnumCallback The callback.
+\param UserData The user data passed to the callback.
+\return SymIndexResult::Unavailable if dbghelp should be asked instead.
+*/
+SymIndexResult SymIndexEnum(duint Base, CBSYMBOLENUM EnumCallback, void* UserData)
+{
+    auto index = symindexget(Base);
+    if(!index)
+        return SymIndexResult::Unavailable;
+
+    String undecorated;
+    SYMBOLINFO symbol;
+    memset(&symbol, 0, sizeof(SYMBOLINFO));
+    for(unsigned int i = 0; i < (unsigned int)index->entries.size(); i++)
+    {
+        const auto & entry = index->entries[i];
+        symbol.addr = Base + entry.rva;
+        symbol.decoratedSymbol = index->names.data() + entry.name;
+        undecorated = symindexundecorate(*index, i);
+        if(undecorated.empty() || undecorated == symbol.decoratedSymbol)
+            symbol.undecoratedSymbol = nullptr;
+        else
+            symbol.undecoratedSymbol = (char*)undecorated.c_str();
+        EnumCallback(&symbol, UserData);
+    }
+    return SymIndexResult::Found;
+}
@@ -0,0 +1,23 @@
+#ifndef _SYMBOLINDEX_H
+#define _SYMBOLINDEX_H
+
+#include "_global.h"
+
+// Bump when the layout of the index cache files changes
+#define SYMBOL_INDEX_VERSION 1
+
+enum class SymIndexResult
+{
+    Unavailable, // the index of the module is not built (yet), ask dbghelp
+    NotFound,
+    Found
+};
+
+void SymIndexLoad(duint Base);
+void SymIndexUnload(duint Base);
+void SymIndexClear();
+SymIndexResult SymIndexFromAddr(duint Address, duint & Displacement, String* Decorated, String* Undecorated);
+SymIndexResult SymIndexFromName(const char* Name, duint & Address);
+SymIndexResult SymIndexEnum(duint Base, CBSYMBOLENUM EnumCallback, void* UserData);
+
+#endif // _SYMBOLINDEX_H
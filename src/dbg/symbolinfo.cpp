@@ -9,7 +9,11 @@
 #include "console.h"
 #include "module.h"
 #include "label.h"
+#include "function.h"
 #include "addrinfo.h"
+#include "symbolindex.h"
+#include "threading.h"
+#include "memory.h"
 
 struct SYMBOLCBDATA
 {
@@ -51,30 +55,87 @@ BOOL CALLBACK EnumSymbols(PSYMBOL_INFO SymInfo, ULONG SymbolSize, PVOID UserCont
     return TRUE;
 }
 
+// Packed or self-modifying images rebuild their import table at runtime, the parsed imports only apply while the import directory is unchanged
+static bool SymImportsRebuilt(duint Base)
+{
+    duint importDirectoryRva, importDirectorySize;
+    {
+        SHARED_ACQUIRE(LockModules);
+        auto module = ModInfoFromAddr(Base);
+        if(!module)
+            return false;
+        importDirectoryRva = module->importDirectoryRva;
+        importDirectorySize = module->importDirectorySize;
+    }
+    Memory<unsigned char*> header(PAGE_SIZE, "SymImportsRebuilt:header");
+    if(!MemRead(Base, header(), header.size()))
+        return false;
+    return GetPE32DataFromMappedFile(ULONG_PTR(header()), 0, UE_IMPORTTABLEADDRESS) != importDirectoryRva ||
+           GetPE32DataFromMappedFile(ULONG_PTR(header()), 0, UE_IMPORTTABLESIZE) != importDirectorySize;
+}
+
 void SymEnumImports(duint Base, CBSYMBOLENUM EnumCallback, void* UserData)
 {
     SYMBOLINFO symbol;
     memset(&symbol, 0, sizeof(SYMBOLINFO));
     symbol.isImported = true;
-    apienumimports(Base, [&](duint base, duint addr, char* name, char* moduleName)
+
+    // Read the whole import table from the process
+    if(SymImportsRebuilt(Base))
+    {
+        apienumimports(Base, [&](duint base, duint addr, char* name, char* moduleName)
+        {
+            symbol.addr = addr;
+            symbol.decoratedSymbol = name;
+            EnumCallback(&symbol, UserData);
+        });
+        return;
+    }
+
+    std::vector<MODIMPORTINFO> imports;
+    if(!ModImportsFromAddr(Base, &imports) || imports.empty())
+        return;
+
+    // The names are parsed once per module, only the IAT is read from the process (in one go when possible)
+    duint iatStart = imports.front().addr;
+    duint iatEnd = iatStart;
+    for(const auto & import : imports)
     {
+        iatStart = min(iatStart, import.addr);
+        iatEnd = max(iatEnd, import.addr + sizeof(duint));
+    }
+    std::vector<unsigned char> iat(iatEnd - iatStart);
+    bool iatRead = MemRead(iatStart, iat.data(), iat.size());
+
+    for(const auto & import : imports)
+    {
+        duint addr = 0;
+        if(iatRead)
+            memcpy(&addr, iat.data() + (import.addr - iatStart), sizeof(addr));
+        else if(!MemRead(import.addr, &addr, sizeof(addr)))
+            continue;
+        if(!addr)
+            continue;
         symbol.addr = addr;
-        symbol.decoratedSymbol = name;
+        symbol.decoratedSymbol = (char*)import.name.c_str();
         EnumCallback(&symbol, UserData);
-    });
+    }
 }
 
 void SymEnum(duint Base, CBSYMBOLENUM EnumCallback, void* UserData)
 {
-    SYMBOLCBDATA symbolCbData;
-    symbolCbData.cbSymbolEnum = EnumCallback;
-    symbolCbData.user = UserData;
-    symbolCbData.decoratedSymbol.resize(MAX_SYM_NAME + 1);
-    symbolCbData.undecoratedSymbol.resize(MAX_SYM_NAME + 1);
-
-    // Enumerate every single symbol for the module in 'base'
-    if(!SafeSymEnumSymbols(fdProcessInfo->hProcess, Base, "*", EnumSymbols, &symbolCbData))
-        dputs("SymEnumSymbols failed!");
+    // Enumerate every single symbol for the module in 'base', dbghelp is only asked while the index is being built
+    if(SymIndexEnum(Base, EnumCallback, UserData) == SymIndexResult::Unavailable)
+    {
+        SYMBOLCBDATA symbolCbData;
+        symbolCbData.cbSymbolEnum = EnumCallback;
+        symbolCbData.user = UserData;
+        symbolCbData.decoratedSymbol.resize(MAX_SYM_NAME + 1);
+        symbolCbData.undecoratedSymbol.resize(MAX_SYM_NAME + 1);
+
+        if(!SafeSymEnumSymbols(fdProcessInfo->hProcess, Base, "*", EnumSymbols, &symbolCbData))
+            dputs("SymEnumSymbols failed!");
+    }
 
     // Emit pseudo entry point symbol
     SYMBOLINFO symbol;
@@ -203,6 +264,8 @@ void SymDownloadAllSymbols(const char* SymbolStore)
             dprintf("SymLoadModuleEx(" fhex ") failed!\n", module.base);
             continue;
         }
+
+        SymIndexLoad(module.base);
     }
 
     SafeSymSetOptions(symOptions);
@@ -224,6 +287,16 @@ bool SymAddrFromName(const char* Name, duint* Address)
     if(!_strnicmp(Name, "Ordinal", 7))
         return false;
 
+    switch(SymIndexFromName(Name, *Address))
+    {
+    case SymIndexResult::Found:
+        return true;
+    case SymIndexResult::NotFound:
+        return false;
+    default:
+        break;
+    }
+
     // According to MSDN:
     // Note that the total size of the data is the SizeOfStruct + (MaxNameLen - 1) * sizeof(TCHAR)
     char buffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME * sizeof(char)];
@@ -239,7 +312,7 @@ bool SymAddrFromName(const char* Name, duint* Address)
     return true;
 }
 
-String SymGetSymbolicName(duint Address)
+static String symbolicnameresolve(duint Address)
 {
     //
     // This resolves an address to a module and symbol:
@@ -263,6 +336,132 @@ String SymGetSymbolicName(duint Address)
     return StringUtils::sprintf("<%s>", label);
 }
 
+// Resolved names are cached per address until one of the inputs changes
+#define SYMBOLIC_CACHE_SIZE 4096
+
+struct SymbolicRevision
+{
+    LONG state; // debug events, memory writes, modules and symbols
+    unsigned int labels;
+    unsigned int functions;
+
+    bool operator==(const SymbolicRevision & other) const
+    {
+        return state == other.state && labels == other.labels && functions == other.functions;
+    }
+};
+
+struct SymbolicCacheEntry
+{
+    bool valid = false;
+    duint address;
+    SymbolicRevision revision;
+    String name;
+};
+
+static volatile LONG symbolicStateRevision = 0;
+static SymbolicCacheEntry symbolicCache[SYMBOLIC_CACHE_SIZE];
+
+static SymbolicRevision symbolicrevision()
+{
+    SymbolicRevision revision;
+    revision.state = symbolicStateRevision;
+    revision.labels = LabelCacheRevision();
+    revision.functions = FunctionCacheRevision();
+    return revision;
+}
+
+static SymbolicCacheEntry & symboliccacheentry(duint Address)
+{
+    return symbolicCache[(Address ^ (Address >> 12)) & (SYMBOLIC_CACHE_SIZE - 1)];
+}
+
+static bool symboliccacheget(duint Address, const SymbolicRevision & Revision, String & Name)
+{
+    const auto & entry = symboliccacheentry(Address);
+    if(!entry.valid || entry.address != Address || !(entry.revision == Revision))
+        return false;
+    Name = entry.name;
+    return true;
+}
+
+static void symboliccacheset(duint Address, const SymbolicRevision & Revision, const String & Name)
+{
+    auto & entry = symboliccacheentry(Address);
+    entry.valid = true;
+    entry.address = Address;
+    entry.revision = Revision;
+    entry.name = Name;
+}
+
+/**
+\brief Invalidates all cached symbolic names, call this when memory, modules or symbols change. Label and function changes are picked up through their revisions.
+*/
+void SymInvalidateSymbolicNames()
+{
+    InterlockedIncrement(&symbolicStateRevision);
+}
+
+static volatile LONG annotationStateRevision = 0;
+
+/**
+\brief Invalidates the annotations (labels, module names and address types) the GUI shows in instructions, call this when memory, modules, symbols or settings change. Unlike SymInvalidateSymbolicNames this is not done for every debug event.
+*/
+void SymInvalidateAnnotations()
+{
+    InterlockedIncrement(&annotationStateRevision);
+    SymInvalidateSymbolicNames();
+}
+
+/**
+\brief Gets a number that changes every time an annotation might have changed.
+\return The annotation revision.
+*/
+unsigned int SymAnnotationRevision()
+{
+    return (unsigned int)annotationStateRevision + LabelCacheRevision();
+}
+
+String SymGetSymbolicName(duint Address)
+{
+    String name;
+    auto revision = symbolicrevision();
+    {
+        SHARED_ACQUIRE(LockSymbolicNameCache);
+        if(symboliccacheget(Address, revision, name))
+            return name;
+    }
+    name = symbolicnameresolve(Address);
+    EXCLUSIVE_ACQUIRE(LockSymbolicNameCache);
+    symboliccacheset(Address, revision, name);
+    return name;
+}
+
+/**
+\brief Resolves many addresses at once, taking the cache locks only twice.
+\param Addresses The addresses to resolve.
+\param [out] Names The symbolic name of every address (empty when there is none).
+*/
+void SymGetSymbolicNames(const std::vector<duint> & Addresses, std::vector<String> & Names)
+{
+    Names.resize(Addresses.size());
+    std::vector<size_t> misses;
+    auto revision = symbolicrevision();
+    {
+        SHARED_ACQUIRE(LockSymbolicNameCache);
+        for(size_t i = 0; i < Addresses.size(); i++)
+            if(!symboliccacheget(Addresses[i], revision, Names[i]))
+                misses.push_back(i);
+    }
+    if(misses.empty())
+        return;
+    for(auto i : misses)
+        Names[i] = symbolicnameresolve(Addresses[i]);
+    EXCLUSIVE_ACQUIRE(LockSymbolicNameCache);
+    for(auto i : misses)
+        symboliccacheset(Addresses[i], revision, Names[i]);
+}
+
 bool SymGetSourceLine(duint Cip, char* FileName, int* Line, DWORD* disp)
 {
     IMAGEHLP_LINEW64 lineInfo;
@@ -10,6 +10,10 @@ void SymUpdateModuleList();
 void SymDownloadAllSymbols(const char* SymbolStore);
 bool SymAddrFromName(const char* Name, duint* Address);
 String SymGetSymbolicName(duint Address);
+void SymGetSymbolicNames(const std::vector<duint> & Addresses, std::vector<String> & Names);
+void SymInvalidateSymbolicNames();
+void SymInvalidateAnnotations();
+unsigned int SymAnnotationRevision();
 
 /**
 \brief Gets the source code file name and line from an address.
@@ -62,9 +62,16 @@ enum SectionLock
     LockArguments,
     LockEncodeMaps,
     LockCallstackCache,
+    LockCallstackWalk,
     LockRunToUserCode,
     LockWatch,
     LockExpressionFunctions,
+    LockSymbolIndex,
+    LockSymbolicNameCache,
+    LockModulePipeline,
+    LockHitLog,
+    LockBreakpointLog,
+    LockCommands,
 
     // Number of elements in this enumeration. Must always be the last
     // index.
@@ -28,6 +28,8 @@
 #include "exception.h"
 #include "expressionfunctions.h"
 #include "historycontext.h"
+#include "analysiscache.h"
+#include "hitlog.h"
 
 static MESSAGE_STACK* gMsgStack = 0;
 static HANDLE hCommandLoopThread = 0;
@@ -149,6 +151,8 @@ static void registercommands()
     dbgcmdnew("SetBreakpointSilent", cbDebugSetBPXSilent, true); //set breakpoint fast resume
     dbgcmdnew("GetBreakpointHitCount", cbDebugGetBPXHitCount, true); //get breakpoint hit count
     dbgcmdnew("ResetBreakpointHitCount", cbDebugResetBPXHitCount, true); //reset breakpoint hit count
+    dbgcmdnew("bphitlog", cbDebugHitLog, false); //write breakpoint hits to a binary file
+    dbgcmdnew("bphitlogstats", cbDebugHitLogStats, false); //aggregate the hits in a binary hit log
     dbgcmdnew("SetHardwareBreakpointName\1bphwname", cbDebugSetBPXHardwareName, true); //set breakpoint name
     dbgcmdnew("SetHardwareBreakpointCondition\1bphwcond", cbDebugSetBPXHardwareCondition, true); //set breakpoint breakCondition
     dbgcmdnew("SetHardwareBreakpointLog\1bphwlog", cbDebugSetBPXHardwareLog, true); //set breakpoint logText
@@ -242,6 +246,7 @@ static void registercommands()
 
     //plugins
     dbgcmdnew("StartScylla\1scylla\1imprec", cbDebugStartScylla, false); //start scylla
+    dbgcmdnew("plugintiming", cbDebugPluginTiming, false); //measure the time spent in plugin callbacks
 
     //general purpose
     dbgcmdnew("cmp", cbInstrCmp, false); //compare
@@ -304,6 +309,11 @@ static void registercommands()
     dbgcmdnew("analyse_nukem\1analyze_nukem\1anal_nukem", cbInstrAnalyseNukem, true); //secret analysis command #2
     dbgcmdnew("exanal\1exanalyse\1exanalyze", cbInstrExanalyse, true); //exception directory analysis
     dbgcmdnew("findallmem\1findmemall", cbInstrFindMemAll, true); //memory map pattern find
+    dbgcmdnew("findallmulti\1findmulti", cbInstrFindAllMulti, true); //multiple patterns in modules/memory
+    dbgcmdnew("entropymap", cbInstrEntropyMap, true); //entropy of every committed page
+    dbgcmdnew("modstats", cbInstrModStats, true); //load time and memory usage of the modules
+    dbgcmdnew("hashbench", cbInstrHashBench, false); //throughput of the hash functions
+    dbgcmdnew("graphbench", cbInstrGraphBench, false); //graph layout time of synthetic control flow graphs
     dbgcmdnew("setmaxfindresult\1findsetmaxresult", cbInstrSetMaxFindResult, false); //set the maximum number of occurences found
     dbgcmdnew("savedata", cbInstrSavedata, true); //save data to disk
     dbgcmdnew("scriptdll\1dllscript", cbScriptDll, false); //execute a script DLL
@@ -494,6 +504,7 @@ extern "C" DLL_EXPORT const char* _dbg_dbginit()
 
     // Create database directory in the local debugger folder
     DbSetPath(StringUtils::sprintf("%s\\db", dir).c_str(), nullptr);
+    AnalysisCacheSetPath(StringUtils::sprintf("%s\\db", dir).c_str());
 
     char szLocalSymbolPath[MAX_PATH] = "";
     strcpy_s(szLocalSymbolPath, dir);
@@ -591,6 +602,7 @@ extern "C" DLL_EXPORT void _dbg_dbgexitsignal()
     wait(WAITID_STOP); //after this, debugging stopped
     dputs("Unloading plugins...");
     pluginunload();
+    HitLogStop();
     dputs("Stopping command thread...");
     bStopCommandLoopThread = true;
     MsgFreeStack(gMsgStack);
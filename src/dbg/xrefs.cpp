@@ -94,6 +94,7 @@ bool XrefAdd(duint Address, duint From)
         found->second.references.insert({ xrefRecord.addr, xrefRecord });
         found->second.type = max(found->second.type, xrefRecord.type);
     }
+    xrefs.MarkModified();
     return true;
 }
 
@@ -153,6 +154,24 @@ void XrefCacheLoad(JSON Root)
     xrefs.CacheLoad(Root);
 }
 
+unsigned int XrefCacheRevision()
+{
+    return xrefs.Revision();
+}
+
+void XrefCacheSaveModule(JSON Root, const char* Module)
+{
+    xrefs.CacheSaveWhere(Root, [Module](const XREFSINFO & value)
+    {
+        return !value.manual && !_stricmp(value.mod, Module);
+    });
+}
+
+void XrefCacheMerge(JSON Root)
+{
+    xrefs.CacheMerge(Root);
+}
+
 void XrefClear()
 {
     xrefs.Clear();
@@ -11,6 +11,9 @@ bool XrefDeleteAll(duint Address);
 void XrefDelRange(duint Start, duint End);
 void XrefCacheSave(JSON Root);
 void XrefCacheLoad(JSON Root);
+unsigned int XrefCacheRevision();
+void XrefCacheSaveModule(JSON Root, const char* Module);
+void XrefCacheMerge(JSON Root);
 void XrefClear();
 
 #endif // _FUNCTION_H
\ No newline at end of file
@@ -23,6 +23,7 @@ Disassembly::Disassembly(QWidget* parent) : AbstractTableView(parent), mDisassem
     mHighlightToken.text = "";
     mHighlightingMode = false;
     mShowMnemonicBrief = false;
+    mShowTokenCacheStatistics = ConfigBool("Disassembler", "ShowTokenCacheStatistics");
 
     int maxModuleSize = (int)ConfigUint("Disassembler", "MaxModuleSize");
     Config()->writeUints();
@@ -126,6 +127,7 @@ void Disassembly::updateFonts()
 void Disassembly::tokenizerConfigUpdatedSlot()
 {
     mDisasm->UpdateConfig();
+    mShowTokenCacheStatistics = ConfigBool("Disassembler", "ShowTokenCacheStatistics");
 }
 
 /************************************************************************************
@@ -588,6 +590,28 @@ QString Disassembly::paintContent(QPainter* painter, dsint rowBase, int rowOffse
     return "";
 }
 
+/**
+ * @brief       This method has been reimplemented. It paints the table and, when enabled, the token cache statistics on top of it.
+ *
+ * @param[in]   event       Paint event
+ *
+ * @return      Nothing.
+ */
+void Disassembly::paintEvent(QPaintEvent* event)
+{
+    AbstractTableView::paintEvent(event);
+    if(!mShowTokenCacheStatistics)
+        return;
+
+    QPainter painter(this->viewport());
+    QString text = CapstoneTokenizer::CacheStatistics();
+    QRect rect = painter.fontMetrics().boundingRect(text).adjusted(-4, -2, 4, 2);
+    rect.moveBottomRight(this->viewport()->rect().bottomRight() - QPoint(4, 4));
+    painter.fillRect(rect, mAddressBackgroundColor.alpha() ? mAddressBackgroundColor : backgroundColor);
+    painter.setPen(mAddressColor);
+    painter.drawText(rect, Qt::AlignCenter, text);
+}
+
 /************************************************************************************
                             Mouse Management
 ************************************************************************************/
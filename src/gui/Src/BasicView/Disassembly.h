@@ -21,6 +21,7 @@ public:
 
     // Reimplemented Functions
     QString paintContent(QPainter* painter, dsint rowBase, int rowOffset, int col, int x, int y, int w, int h);
+    void paintEvent(QPaintEvent* event);
 
     // Mouse Management
     void mouseMoveEvent(QMouseEvent* event);
@@ -211,6 +212,7 @@ protected:
     MemoryPage* mMemPage;
     QBeaEngine* mDisasm;
     bool mShowMnemonicBrief;
+    bool mShowTokenCacheStatistics;
     XREF_INFO mXrefInfo;
     CodeFoldingHelper* mCodeFoldingManager;
     DisassemblyPopup mDisassemblyPopup;
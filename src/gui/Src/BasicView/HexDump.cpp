@@ -4,6 +4,38 @@
 #include "StringUtil.h"
 #include <QMessageBox>
 
+static const char HexDigits[] = "0123456789ABCDEF";
+
+static QString ToHexDigits(uint64 value, int digits)
+{
+    QString result(digits, Qt::Uninitialized);
+    QChar* data = result.data();
+    for(int i = digits - 1; i >= 0; i--, value >>= 4)
+        data[i] = QChar(HexDigits[value & 0xF]);
+    return result;
+}
+
+static QString ToDecimal(uint64 value, bool negative = false)
+{
+    char buffer[24];
+    char* end = buffer + sizeof(buffer);
+    char* p = end;
+    do
+    {
+        *--p = char('0' + value % 10);
+        value /= 10;
+    }
+    while(value);
+    if(negative)
+        *--p = '-';
+    return QString::fromLatin1(p, int(end - p));
+}
+
+static QString ToSignedDecimal(long long value)
+{
+    return value < 0 ? ToDecimal(0 - (uint64)value, true) : ToDecimal((uint64)value);
+}
+
 HexDump::HexDump(QWidget* parent)
     : AbstractTableView(parent)
 {
@@ -23,6 +55,12 @@ HexDump::HexDump(QWidget* parent)
     backgroundColor = ConfigColor("HexDumpBackgroundColor");
     textColor = ConfigColor("HexDumpTextColor");
     selectionColor = ConfigColor("HexDumpSelectionColor");
+    mModifiedBytesColor = ConfigColor("HexDumpModifiedBytesColor");
+
+    mViewBase = 0;
+    mViewRva = 0;
+    mViewRows = 0;
+    mViewBytePerRow = 0;
 
     mRvaDisplayEnabled = false;
     mSyncAddrExpression = "";
@@ -49,6 +87,7 @@ void HexDump::updateColors()
     backgroundColor = ConfigColor("HexDumpBackgroundColor");
     textColor = ConfigColor("HexDumpTextColor");
     selectionColor = ConfigColor("HexDumpSelectionColor");
+    mModifiedBytesColor = ConfigColor("HexDumpModifiedBytesColor");
     reloadData();
 }
 
@@ -451,6 +490,123 @@ void HexDump::mouseReleaseEvent(QMouseEvent* event)
         AbstractTableView::mouseReleaseEvent(event);
 }
 
+void HexDump::prepareData()
+{
+    AbstractTableView::prepareData();
+
+    // Read all visible rows at once
+    int wBytePerRowCount = getBytePerRowCount();
+    dsint wRva = getTableOffset() * wBytePerRowCount - mByteOffset;
+    int wRows = getNbrOfLineToPrint();
+    if(wRva < 0)
+    {
+        wRva += wBytePerRowCount;
+        wRows--;
+    }
+    dsint wPageSize = mMemPage->getSize();
+    if(wRows > 0 && wRva + (dsint)wRows * wBytePerRowCount > wPageSize)
+        wRows = int((wPageSize - wRva) / wBytePerRowCount);
+    if(wRows < 0 || !wBytePerRowCount)
+        wRows = 0;
+
+    // Formatted cells stay valid while the same window is shown in the same layout and their bytes don't change
+    std::vector<int> wLayout;
+    for(const auto & desc : mDescriptor)
+    {
+        wLayout.push_back(desc.isData);
+        wLayout.push_back(desc.itemCount);
+        wLayout.push_back(desc.data.itemSize);
+        wLayout.push_back(desc.data.byteMode);
+        wLayout.push_back(desc.separator);
+        wLayout.push_back(desc.textCodec != nullptr);
+    }
+    bool wSameWindow = mViewBase == mMemPage->getBase() && mViewRva == wRva && mViewRows == wRows && mViewBytePerRow == wBytePerRowCount && mViewLayout == wLayout;
+    if(!wSameWindow)
+        mViewCells.clear();
+    mViewBase = mMemPage->getBase();
+    mViewRva = wRva;
+    mViewRows = wRows;
+    mViewBytePerRow = wBytePerRowCount;
+    mViewLayout = std::move(wLayout);
+
+    mPrevViewData.swap(mViewData);
+    mViewData.resize(wRows * wBytePerRowCount);
+    if(mViewData.empty() || !mMemPage->read(mViewData.data(), wRva, mViewData.size()))
+    {
+        mViewRows = 0;
+        mViewCells.clear();
+        return;
+    }
+    if(mPrevViewData.size() != mViewData.size())
+        mViewCells.clear();
+
+    mViewCells.resize(mDescriptor.size());
+    for(int col = 0; col < mDescriptor.size(); col++)
+    {
+        const ColumnDescriptor_t & desc = mDescriptor.at(col);
+        if(!desc.isData)
+            continue;
+        int wByteCount = getSizeOf(desc.data.itemSize);
+        int wRowByteCount = desc.textCodec ? wBytePerRowCount : desc.itemCount * wByteCount;
+        if(wRowByteCount > wBytePerRowCount)
+            continue; // not cached, the row would read past the window
+        int wItemCount = desc.textCodec ? 1 : desc.itemCount;
+        int wMaxLen = getStringMaxLength(desc.data);
+        CellColumn_t & cells = mViewCells[col];
+        bool wReuse = !cells.text.empty();
+        cells.text.resize(wRows * wItemCount);
+        cells.patched.assign(wRows * wItemCount, false);
+        for(int row = 0; row < wRows; row++)
+        {
+            int wRowOffset = row * wBytePerRowCount;
+            duint wRowVa = rvaToVa(wRva + wRowOffset);
+            bool wRowPatched = !desc.textCodec && DbgFunctions()->PatchInRange(wRowVa, wRowVa + wRowByteCount - 1);
+            for(int i = 0; i < wItemCount; i++)
+            {
+                int wOffset = wRowOffset + i * wByteCount;
+                int wSize = desc.textCodec ? wRowByteCount : wByteCount;
+                QString & text = cells.text[row * wItemCount + i];
+                if(wRowPatched)
+                    cells.patched[row * wItemCount + i] = DbgFunctions()->PatchInRange(wRowVa + i * wByteCount, wRowVa + i * wByteCount + wByteCount - 1);
+                if(wReuse && !memcmp(mViewData.data() + wOffset, mPrevViewData.data() + wOffset, wSize))
+                    continue;
+                if(desc.textCodec)
+                    text = codecToString(desc.textCodec, mViewData.data() + wOffset, wSize);
+                else
+                {
+                    text = toString(desc.data, mViewData.data() + wOffset).rightJustified(wMaxLen, ' ');
+                    if(wMaxLen)
+                        text += ' ';
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Returns the row of the bulk read window that starts at an rva.
+ * @return -1 if the row is not in the window.
+ */
+int HexDump::viewRowFromRva(dsint rva)
+{
+    if(!mViewRows || mViewBase != mMemPage->getBase() || rva < mViewRva || (rva - mViewRva) % mViewBytePerRow)
+        return -1;
+    dsint row = (rva - mViewRva) / mViewBytePerRow;
+    return row < mViewRows ? int(row) : -1;
+}
+
+QString HexDump::codecToString(QTextCodec* codec, const byte_t* data, int size)
+{
+    //This might produce invalid characters in variables-width encodings. This is currently ignored.
+    QString text = codec->toUnicode(QByteArray((const char*)data, size));
+    text.replace('\t', "\\t");
+    text.replace('\f', "\\f");
+    text.replace('\v', "\\v");
+    text.replace('\n', "\\n");
+    text.replace('\r', "\\r");
+    return text;
+}
+
 QString HexDump::paintContent(QPainter* painter, dsint rowBase, int rowOffset, int col, int x, int y, int w, int h)
 {
     // Reset byte offset when base address is reached
@@ -571,6 +727,22 @@ void HexDump::getColumnRichText(int col, dsint rva, RichTextPainter::List & rich
     else if(mDescriptor.at(col - 1).isData == true)
     {
         const ColumnDescriptor_t & desc = mDescriptor.at(col - 1);
+
+        // Use the cells formatted in prepareData
+        int wRow = viewRowFromRva(rva);
+        if(wRow != -1 && col - 1 < (int)mViewCells.size() && !mViewCells[col - 1].text.empty())
+        {
+            const CellColumn_t & cells = mViewCells[col - 1];
+            int wItemCount = desc.textCodec ? 1 : desc.itemCount;
+            for(int i = 0; i < wItemCount; i++)
+            {
+                curData.text = cells.text[wRow * wItemCount + i];
+                curData.textColor = cells.patched[wRow * wItemCount + i] ? mModifiedBytesColor : textColor;
+                richText.push_back(curData);
+            }
+            return;
+        }
+
         int wI;
         QString wStr = "";
 
@@ -579,26 +751,18 @@ void HexDump::getColumnRichText(int col, dsint rva, RichTextPainter::List & rich
 
         wBufferByteCount = wBufferByteCount > (dsint)(mMemPage->getSize() - rva) ? mMemPage->getSize() - rva : wBufferByteCount;
 
-        byte_t* wData = new byte_t[wBufferByteCount];
-        //byte_t wData[mDescriptor.at(col).itemCount * wByteCount];
+        mRowData.resize(wBufferByteCount);
+        byte_t* wData = mRowData.data();
 
         mMemPage->read(wData, rva, wBufferByteCount);
 
         if(desc.textCodec) //convert the row bytes to unicode
         {
-            //This might produce invalid characters in variables-width encodings. This is currently ignored.
-            curData.text = desc.textCodec->toUnicode(QByteArray((const char*)wData, wBufferByteCount));
-            curData.text.replace('\t', "\\t");
-            curData.text.replace('\f', "\\f");
-            curData.text.replace('\v', "\\v");
-            curData.text.replace('\n', "\\n");
-            curData.text.replace('\r', "\\r");
+            curData.text = codecToString(desc.textCodec, wData, wBufferByteCount);
             richText.push_back(curData);
         }
         else
         {
-            QColor highlightColor = ConfigColor("HexDumpModifiedBytesColor");
-
             for(wI = 0; wI < desc.itemCount && (rva + wI) < (dsint)mMemPage->getSize(); wI++)
             {
                 int maxLen = getStringMaxLength(mDescriptor.at(col - 1).data);
@@ -613,14 +777,12 @@ void HexDump::getColumnRichText(int col, dsint rva, RichTextPainter::List & rich
                 dsint start = rvaToVa(rva + wI * wByteCount);
                 dsint end = start + wByteCount - 1;
                 if(DbgFunctions()->PatchInRange(start, end))
-                    curData.textColor = highlightColor;
+                    curData.textColor = mModifiedBytesColor;
                 else
                     curData.textColor = textColor;
                 richText.push_back(curData);
             }
         }
-
-        delete[] wData;
     }
 }
 
@@ -678,7 +840,7 @@ QString HexDump::byteToString(byte_t byte, ByteViewMode_e mode)
     {
     case HexByte:
     {
-        wStr = QString("%1").arg((unsigned char)byte, 2, 16, QChar('0')).toUpper();
+        wStr = ToHexDigits(byte, 2);
     }
     break;
 
@@ -695,13 +857,13 @@ QString HexDump::byteToString(byte_t byte, ByteViewMode_e mode)
 
     case SignedDecByte:
     {
-        wStr = QString::number((int)((char)byte));
+        wStr = ToSignedDecimal((char)byte);
     }
     break;
 
     case UnsignedDecByte:
     {
-        wStr = QString::number((unsigned int)byte);
+        wStr = ToDecimal(byte);
     }
     break;
 
@@ -723,7 +885,7 @@ QString HexDump::wordToString(uint16 word, WordViewMode_e mode)
     {
     case HexWord:
     {
-        wStr = QString("%1").arg((unsigned short)word, 4, 16, QChar('0')).toUpper();
+        wStr = ToHexDigits(word, 4);
     }
     break;
 
@@ -739,13 +901,13 @@ QString HexDump::wordToString(uint16 word, WordViewMode_e mode)
 
     case SignedDecWord:
     {
-        wStr = QString::number((int)((short)word));
+        wStr = ToSignedDecimal((short)word);
     }
     break;
 
     case UnsignedDecWord:
     {
-        wStr = QString::number((unsigned int)word);
+        wStr = ToDecimal(word);
     }
     break;
 
@@ -767,19 +929,19 @@ QString HexDump::dwordToString(uint32 dword, DwordViewMode_e mode)
     {
     case HexDword:
     {
-        wStr = QString("%1").arg((unsigned int)dword, 8, 16, QChar('0')).toUpper();
+        wStr = ToHexDigits(dword, 8);
     }
     break;
 
     case SignedDecDword:
     {
-        wStr = QString::number((int)dword);
+        wStr = ToSignedDecimal((int)dword);
     }
     break;
 
     case UnsignedDecDword:
     {
-        wStr = QString::number((unsigned int)dword);
+        wStr = ToDecimal(dword);
     }
     break;
 
@@ -807,19 +969,19 @@ QString HexDump::qwordToString(uint64 qword, QwordViewMode_e mode)
     {
     case HexQword:
     {
-        wStr = QString("%1").arg((unsigned long long)qword, 16, 16, QChar('0')).toUpper();
+        wStr = ToHexDigits(qword, 16);
     }
     break;
 
     case SignedDecQword:
     {
-        wStr = QString::number((long long)qword);
+        wStr = ToSignedDecimal((long long)qword);
     }
     break;
 
     case UnsignedDecQword:
     {
-        wStr = QString::number((unsigned long long)qword);
+        wStr = ToDecimal(qword);
     }
     break;
 
@@ -1216,6 +1378,9 @@ void HexDump::clearDescriptors()
 {
     deleteAllColumns();
     mDescriptor.clear();
+    // The new descriptors can have the same layout with a different text codec
+    mViewLayout.clear();
+    mViewCells.clear();
     int charwidth = getCharWidth();
     addColumnAt(8 + charwidth * 2 * sizeof(duint), tr("Address"), false); //address
 }
@@ -96,6 +96,7 @@ public:
     void mousePressEvent(QMouseEvent* event);
     void mouseReleaseEvent(QMouseEvent* event);
 
+    void prepareData() override;
     QString paintContent(QPainter* painter, dsint rowBase, int rowOffset, int col, int x, int y, int w, int h);
     void paintGraphicDump(QPainter* painter, int x, int y, int addr);
 
@@ -113,6 +114,7 @@ public:
     int getSizeOf(DataSize_e size);
 
     QString toString(DataDescriptor_t desc, void* data);
+    QString codecToString(QTextCodec* codec, const byte_t* data, int size);
 
     QString byteToString(byte_t byte, ByteViewMode_e mode);
     QString wordToString(uint16 word, WordViewMode_e mode);
@@ -182,7 +184,29 @@ private:
     QList<dsint> mVaHistory;
     int mCurrentVa;
 
+    // Formatted cells of one column in the bulk read window
+    struct CellColumn_t
+    {
+        std::vector<QString> text;
+        std::vector<bool> patched;
+    };
+
+    std::vector<byte_t> mViewData;
+    std::vector<byte_t> mPrevViewData;
+    std::vector<byte_t> mRowData;
+    std::vector<int> mViewLayout;
+    std::vector<CellColumn_t> mViewCells;
+    duint mViewBase;
+    QColor mModifiedBytesColor;
+
 protected:
+    int viewRowFromRva(dsint rva);
+
+    // Visible rows read in one go by prepareData, starting at mViewRva
+    dsint mViewRva;
+    int mViewRows;
+    int mViewBytePerRow;
+
     MemoryPage* mMemPage;
     int mByteOffset;
     QList<ColumnDescriptor_t> mDescriptor;
@@ -3,6 +3,7 @@
 #include "QBeaEngine.h"
 #include "main.h"
 #include "Exports.h"
+#include "GraphLayoutBenchmark.h"
 
 /************************************************************************************
                             Global Variables
@@ -22,6 +23,8 @@ Bridge::Bridge(QObject* parent) : QObject(parent)
     bridgeResult = 0;
     hasBridgeResult = false;
     dbgStopped = false;
+    mLogClear = false;
+    mLogFlushQueued = false;
 }
 
 Bridge::~Bridge()
@@ -75,6 +78,23 @@ void Bridge::setDbgStopped()
     dbgStopped = true;
 }
 
+void Bridge::flushLogSlot()
+{
+    QString msg;
+    bool clear;
+    {
+        QMutexLocker locker(&mLogMutex);
+        msg.swap(mLogPending);
+        clear = mLogClear;
+        mLogClear = false;
+        mLogFlushQueued = false;
+    }
+    if(clear)
+        emit clearLog();
+    if(msg.length())
+        emit addMsgToLog(msg);
+}
+
 /************************************************************************************
                             Message processing
 ************************************************************************************/
@@ -94,12 +114,24 @@ void* Bridge::processMessage(GUIMSG type, void* param1, void* param2)
         break;
 
     case GUI_ADD_MSG_TO_LOG:
-        emit addMsgToLog(QString((const char*)param1));
-        break;
-
     case GUI_CLEAR_LOG:
-        emit clearLog();
-        break;
+    {
+        //coalesce the messages that arrive before the GUI thread gets to process them
+        QMutexLocker locker(&mLogMutex);
+        if(type == GUI_CLEAR_LOG)
+        {
+            mLogPending.clear();
+            mLogClear = true;
+        }
+        else
+            mLogPending += QString((const char*)param1);
+        if(!mLogFlushQueued)
+        {
+            mLogFlushQueued = true;
+            QMetaObject::invokeMethod(this, "flushLogSlot", Qt::QueuedConnection);
+        }
+    }
+    break;
 
     case GUI_UPDATE_REGISTER_VIEW:
         emit updateRegisters();
@@ -650,6 +682,14 @@ void* Bridge::processMessage(GUIMSG type, void* param1, void* param2)
         emit foldDisassembly(duint(param1), duint(param2));
         break;
 
+    case GUI_BENCHMARK_GRAPH_LAYOUT:
+    {
+        //the layout has no GUI dependencies, so it runs on the calling thread
+        QByteArray text = QString::fromStdString(GraphLayoutBenchmark(int(dsint(param1)))).toUtf8();
+        processMessage(GUI_ADD_MSG_TO_LOG, (void*)text.constData(), nullptr);
+    }
+    break;
+
     }
 
     return nullptr;
@@ -133,11 +133,20 @@ signals:
     void setFavouriteItemShortcut(int type, const QString & name, const QString & shortcut);
     void foldDisassembly(duint startAddr, duint length);
 
+private slots:
+    void flushLogSlot();
+
 private:
     QMutex* mBridgeMutex;
     dsint bridgeResult;
     volatile bool hasBridgeResult;
     volatile bool dbgStopped;
+
+    //log messages waiting to be delivered to the GUI thread in one batch
+    QMutex mLogMutex;
+    QString mLogPending;
+    bool mLogClear;
+    bool mLogFlushQueued;
 };
 
 #endif // BRIDGE_H
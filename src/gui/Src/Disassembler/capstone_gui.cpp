@@ -13,6 +13,14 @@ CapstoneTokenizer::CapstoneTokenizer(int maxModuleLength)
 std::map<CapstoneTokenizer::TokenType, CapstoneTokenizer::TokenColor> CapstoneTokenizer::colorNamesMap;
 QHash<QString, int> CapstoneTokenizer::stringPoolMap;
 int CapstoneTokenizer::poolId = 0;
+CapstoneTokenizer::CacheList CapstoneTokenizer::cacheList;
+std::unordered_map<duint, CapstoneTokenizer::CacheList::iterator> CapstoneTokenizer::cacheMap;
+QSet<QString> CapstoneTokenizer::cacheStrings;
+QMutex CapstoneTokenizer::cacheMutex;
+unsigned int CapstoneTokenizer::cacheHits = 0;
+unsigned int CapstoneTokenizer::cacheMisses = 0;
+
+#define TOKEN_CACHE_SIZE 4096
 
 void CapstoneTokenizer::addColorName(TokenType type, QString color, QString backgroundColor)
 {
@@ -98,6 +106,13 @@ bool CapstoneTokenizer::Tokenize(duint addr, const unsigned char* data, int data
     _inst = InstructionToken();
 
     _success = _cp.DisassembleSafe(addr, data, datasize);
+
+    //labels and module names only have to be looked up again when the debugger changed them
+    bool cache = _success && _cp.Size() <= int(sizeof(CacheEntry::data)) && DbgFunctions()->GetAnnotationRevision;
+    unsigned int revision = cache ? DbgFunctions()->GetAnnotationRevision() : 0;
+    if(cache && cacheGet(addr, data, _cp.Size(), revision, instruction))
+        return true;
+
     if(_success)
     {
         if(!tokenizeMnemonic())
@@ -118,6 +133,9 @@ bool CapstoneTokenizer::Tokenize(duint addr, const unsigned char* data, int data
     else
         addToken(TokenType::Uncategorized, "???");
 
+    if(cache)
+        cachePut(addr, data, _cp.Size(), revision, _inst);
+
     instruction = _inst;
 
     return true;
@@ -248,6 +266,75 @@ bool CapstoneTokenizer::TokenEquals(const SingleToken* a, const SingleToken* b,
     return tokenTextPoolEquals(a->text, b->text);
 }
 
+QString CapstoneTokenizer::CacheStatistics()
+{
+    QMutexLocker locker(&cacheMutex);
+    unsigned int total = cacheHits + cacheMisses;
+    return QString("Token cache: %1 entries, %2% hits (%3/%4)")
+           .arg(cacheList.size())
+           .arg(total ? cacheHits * 100 / total : 0)
+           .arg(cacheHits)
+           .arg(total);
+}
+
+unsigned int CapstoneTokenizer::cacheConfig() const
+{
+    return (_bUppercase ? 1 : 0) | (_bTabbedMnemonic ? 2 : 0) | (_bArgumentSpaces ? 4 : 0) | (_bMemorySpaces ? 8 : 0) | ((_maxModuleLength + 1) << 4);
+}
+
+bool CapstoneTokenizer::cacheGet(duint addr, const unsigned char* data, int size, unsigned int revision, InstructionToken & instruction)
+{
+    QMutexLocker locker(&cacheMutex);
+    auto found = cacheMap.find(addr);
+    if(found == cacheMap.end())
+    {
+        cacheMisses++;
+        return false;
+    }
+    const CacheEntry & entry = *found->second;
+    if(entry.revision != revision || entry.config != cacheConfig() || entry.size != size || memcmp(entry.data, data, size) != 0)
+    {
+        cacheMisses++;
+        return false;
+    }
+    cacheList.splice(cacheList.begin(), cacheList, found->second);
+    instruction = entry.instruction;
+    cacheHits++;
+    return true;
+}
+
+void CapstoneTokenizer::cachePut(duint addr, const unsigned char* data, int size, unsigned int revision, InstructionToken & instruction)
+{
+    QMutexLocker locker(&cacheMutex);
+    auto found = cacheMap.find(addr);
+    if(found != cacheMap.end())
+    {
+        cacheList.erase(found->second);
+        cacheMap.erase(found);
+    }
+    else if(cacheList.size() >= TOKEN_CACHE_SIZE)
+    {
+        cacheMap.erase(cacheList.back().addr);
+        cacheList.pop_back();
+    }
+
+    //intern the token texts so the cached instructions share the same strings
+    if(cacheStrings.size() >= TOKEN_CACHE_SIZE * 4)
+        cacheStrings.clear();
+    for(auto & token : instruction.tokens)
+        token.text = *cacheStrings.insert(token.text);
+
+    CacheEntry entry;
+    entry.addr = addr;
+    memcpy(entry.data, data, size);
+    entry.size = size;
+    entry.config = cacheConfig();
+    entry.revision = revision;
+    entry.instruction = instruction;
+    cacheList.push_front(entry);
+    cacheMap[addr] = cacheList.begin();
+}
+
 void CapstoneTokenizer::addToken(TokenType type, QString text, const TokenValue & value)
 {
     switch(type)
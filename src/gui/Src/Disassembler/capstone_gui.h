@@ -5,6 +5,8 @@
 #include "RichTextPainter.h"
 #include "Configuration.h"
 #include <map>
+#include <list>
+#include <unordered_map>
 #include <QHash>
 #include <QtCore>
 
@@ -117,18 +119,18 @@ public:
             if(color.length() && backgroundColor.length())
             {
                 this->flags = RichTextPainter::FlagAll;
-                this->color = ConfigColor(color);
-                this->backgroundColor = ConfigColor(backgroundColor);
+                this->color = Config()->getColor(color);
+                this->backgroundColor = Config()->getColor(backgroundColor);
             }
             else if(color.length())
             {
                 this->flags = RichTextPainter::FlagColor;
-                this->color = ConfigColor(color);
+                this->color = Config()->getColor(color);
             }
             else if(backgroundColor.length())
             {
                 this->flags = RichTextPainter::FlagBackground;
-                this->backgroundColor = ConfigColor(backgroundColor);
+                this->backgroundColor = Config()->getColor(backgroundColor);
             }
             else
                 this->flags = RichTextPainter::FlagNone;
@@ -149,6 +151,7 @@ public:
     static bool TokenFromX(const InstructionToken & instr, SingleToken & token, int x, CachedFontMetrics* fontMetrics);
     static bool IsHighlightableToken(const SingleToken & token);
     static bool TokenEquals(const SingleToken* a, const SingleToken* b, bool ignoreSize = true);
+    static QString CacheStatistics();
 
 private:
     static void addColorName(TokenType type, QString color, QString backgroundColor);
@@ -173,6 +176,29 @@ private:
     static QHash<QString, int> stringPoolMap;
     static int poolId;
 
+    //tokenized instructions shared by all tokenizers, an entry is only valid for the same bytes, settings and annotations
+    struct CacheEntry
+    {
+        duint addr;
+        unsigned char data[16];
+        int size;
+        unsigned int config;
+        unsigned int revision;
+        InstructionToken instruction;
+    };
+
+    typedef std::list<CacheEntry> CacheList;
+    static CacheList cacheList; //most recently used first
+    static std::unordered_map<duint, CacheList::iterator> cacheMap;
+    static QSet<QString> cacheStrings; //token texts are shared between the entries
+    static QMutex cacheMutex; //the bridge tokenizes outside of the GUI thread
+    static unsigned int cacheHits;
+    static unsigned int cacheMisses;
+
+    unsigned int cacheConfig() const;
+    bool cacheGet(duint addr, const unsigned char* data, int size, unsigned int revision, InstructionToken & instruction);
+    void cachePut(duint addr, const unsigned char* data, int size, unsigned int revision, InstructionToken & instruction);
+
     bool tokenizePrefix();
     bool tokenizeMnemonic();
     bool tokenizeMnemonic(TokenType type, const QString & mnemonic);
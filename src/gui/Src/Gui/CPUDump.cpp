@@ -1303,14 +1303,11 @@ void CPUDump::entropySlot()
 {
     dsint selStart = getSelectionStart();
     dsint selSize = getSelectionEnd() - selStart + 1;
-    QVector<byte_t> data;
-    data.resize(selSize);
-    mMemPage->read(data.data(), selStart, selSize);
 
     EntropyDialog entropyDialog(this);
     entropyDialog.setWindowTitle(tr("Entropy (Address: %1, Size: %2)").arg(ToPtrString(selStart)).arg(ToPtrString(selSize)));
     entropyDialog.show();
-    entropyDialog.GraphMemory(data.constData(), data.size());
+    entropyDialog.GraphMemoryRegion(rvaToVa(selStart), selSize);
     entropyDialog.exec();
 }
 
@@ -64,6 +64,15 @@ void CPUStack::updateColors()
     mStackSEHChainColor = ConfigColor("StackSEHChainColor");
     mUserStackFrameColor = ConfigColor("StackFrameColor");
     mSystemStackFrameColor = ConfigColor("StackFrameSystemColor");
+    mStackInactiveTextColor = ConfigColor("StackInactiveTextColor");
+    mStackCspColor = ConfigColor("StackCspColor");
+    mStackCspBackgroundColor = ConfigColor("StackCspBackgroundColor");
+    mStackLabelColor = ConfigColor("StackLabelColor");
+    mStackLabelBackgroundColor = ConfigColor("StackLabelBackgroundColor");
+    mStackSelectedAddressColor = ConfigColor("StackSelectedAddressColor");
+    mStackSelectedAddressBackgroundColor = ConfigColor("StackSelectedAddressBackgroundColor");
+    mStackAddressColor = ConfigColor("StackAddressColor");
+    mStackAddressBackgroundColor = ConfigColor("StackAddressBackgroundColor");
 }
 
 void CPUStack::updateFonts()
@@ -338,6 +347,40 @@ void CPUStack::refreshShortcutsSlot()
     mGotoNext->setShortcut(ConfigShortcut("ActionGotoNext"));
 }
 
+void CPUStack::prepareData()
+{
+    HexDump::prepareData();
+
+    // Query the comment and label of every visible row once instead of on every paint
+    mRowInfo.resize(mViewRows);
+    for(int row = 0; row < mViewRows; row++)
+    {
+        duint wVa = rvaToVa(mViewRva + row * mViewBytePerRow);
+        RowInfo_t & info = mRowInfo[row];
+        info.hasComment = DbgStackCommentGet(wVa, &info.comment);
+        info.hasLabel = DbgGetLabelAt(wVa, SEG_DEFAULT, nullptr);
+    }
+}
+
+bool CPUStack::getStackComment(dsint rva, STACK_COMMENT* comment)
+{
+    int wRow = viewRowFromRva(rva);
+    if(wRow == -1 || wRow >= (int)mRowInfo.size())
+        return DbgStackCommentGet(rvaToVa(rva), comment);
+    if(!mRowInfo[wRow].hasComment)
+        return false;
+    *comment = mRowInfo[wRow].comment;
+    return true;
+}
+
+bool CPUStack::hasLabel(dsint rva)
+{
+    int wRow = viewRowFromRva(rva);
+    if(wRow == -1 || wRow >= (int)mRowInfo.size())
+        return DbgGetLabelAt(rvaToVa(rva), SEG_DEFAULT, nullptr);
+    return mRowInfo[wRow].hasLabel;
+}
+
 void CPUStack::getColumnRichText(int col, dsint rva, RichTextPainter::List & richText)
 {
     // Compute VA
@@ -356,15 +399,14 @@ void CPUStack::getColumnRichText(int col, dsint rva, RichTextPainter::List & ric
         HexDump::getColumnRichText(col, rva, richText);
         if(!wActiveStack)
         {
-            QColor inactiveColor = ConfigColor("StackInactiveTextColor");
             for(int i = 0; i < int(richText.size()); i++)
             {
                 richText[i].flags = RichTextPainter::FlagColor;
-                richText[i].textColor = inactiveColor;
+                richText[i].textColor = mStackInactiveTextColor;
             }
         }
     }
-    else if(col && DbgStackCommentGet(wVa, &comment)) //paint stack comments
+    else if(col && getStackComment(rva, &comment)) //paint stack comments
     {
         if(wActiveStack)
         {
@@ -386,7 +428,7 @@ void CPUStack::getColumnRichText(int col, dsint rva, RichTextPainter::List & ric
                 curData.textColor = textColor;
         }
         else
-            curData.textColor = ConfigColor("StackInactiveTextColor");
+            curData.textColor = mStackInactiveTextColor;
         curData.text = comment.comment;
         richText.push_back(curData);
     }
@@ -412,35 +454,35 @@ QString CPUStack::paintContent(QPainter* painter, dsint rowBase, int rowOffset,
     if(col == 0) // paint stack address
     {
         QColor background;
-        if(DbgGetLabelAt(wVa, SEG_DEFAULT, nullptr)) //label
+        if(hasLabel(wRva)) //label
         {
             if(wVa == mCsp) //CSP
             {
-                background = ConfigColor("StackCspBackgroundColor");
-                painter->setPen(QPen(ConfigColor("StackCspColor")));
+                background = mStackCspBackgroundColor;
+                painter->setPen(QPen(mStackCspColor));
             }
             else //no CSP
             {
-                background = ConfigColor("StackLabelBackgroundColor");
-                painter->setPen(ConfigColor("StackLabelColor"));
+                background = mStackLabelBackgroundColor;
+                painter->setPen(mStackLabelColor);
             }
         }
         else //no label
         {
             if(wVa == mCsp) //CSP
             {
-                background = ConfigColor("StackCspBackgroundColor");
-                painter->setPen(QPen(ConfigColor("StackCspColor")));
+                background = mStackCspBackgroundColor;
+                painter->setPen(QPen(mStackCspColor));
             }
             else if(wIsSelected) //selected normal address
             {
-                background = ConfigColor("StackSelectedAddressBackgroundColor");
-                painter->setPen(QPen(ConfigColor("StackSelectedAddressColor"))); //black address (DisassemblySelectedAddressColor)
+                background = mStackSelectedAddressBackgroundColor;
+                painter->setPen(QPen(mStackSelectedAddressColor)); //black address (DisassemblySelectedAddressColor)
             }
             else //normal address
             {
-                background = ConfigColor("StackAddressBackgroundColor");
-                painter->setPen(QPen(ConfigColor("StackAddressColor")));
+                background = mStackAddressBackgroundColor;
+                painter->setPen(QPen(mStackAddressColor));
             }
         }
         if(background.alpha())
@@ -18,6 +18,7 @@ public:
     virtual void updateColors();
     virtual void updateFonts();
 
+    void prepareData() override;
     void getColumnRichText(int col, dsint rva, RichTextPainter::List & richText) override;
     QString paintContent(QPainter* painter, dsint rowBase, int rowOffset, int col, int x, int y, int w, int h) override;
     void contextMenuEvent(QContextMenuEvent* event);
@@ -136,6 +137,25 @@ private:
     QColor mSystemStackFrameColor;
     QColor mStackReturnToColor;
     QColor mStackSEHChainColor;
+    QColor mStackInactiveTextColor;
+    QColor mStackCspColor;
+    QColor mStackCspBackgroundColor;
+    QColor mStackLabelColor;
+    QColor mStackLabelBackgroundColor;
+    QColor mStackSelectedAddressColor;
+    QColor mStackSelectedAddressBackgroundColor;
+    QColor mStackAddressColor;
+    QColor mStackAddressBackgroundColor;
+    struct RowInfo_t
+    {
+        bool hasComment;
+        bool hasLabel;
+        STACK_COMMENT comment;
+    };
+
+    std::vector<RowInfo_t> mRowInfo;
+    bool getStackComment(dsint rva, STACK_COMMENT* comment);
+    bool hasLabel(dsint rva);
     struct CPUCallStack
     {
         duint addr;
@@ -5,6 +5,7 @@
 #include <QClipboard>
 #include <QApplication>
 #include <QMimeData>
+#include <QThread>
 
 DisassemblerGraphView::DisassemblerGraphView(QWidget* parent)
     : QAbstractScrollArea(parent),
@@ -19,6 +20,7 @@ DisassemblerGraphView::DisassemblerGraphView(QWidget* parent)
     this->desired_pos = nullptr;
     this->highlight_token = nullptr;
     this->cur_instr = 0;
+    this->layoutEntry = 0;
     this->scroll_base_x = 0;
     this->scroll_base_y = 0;
     this->scroll_mode = false;
@@ -303,7 +305,11 @@ void DisassemblerGraphView::paintEvent(QPaintEvent* event)
     p.setBrush(Qt::black);
 
     if(!this->ready || !DbgIsDebugging())
+    {
+        if(this->layoutJob && DbgIsDebugging())
+            p.drawText(viewportRect, Qt::AlignCenter, this->status);
         return;
+    }
 
     if(drawOverview)
         paintOverview(p, viewportRect, xofs, yofs);
@@ -600,470 +606,124 @@ void DisassemblerGraphView::prepareGraphNode(DisassemblerBlock & block)
     block.height = (height * this->charHeight) + extra;
 }
 
-void DisassemblerGraphView::adjustGraphLayout(DisassemblerBlock & block, int col, int row)
-{
-    block.col += col;
-    block.row += row;
-    for(duint edge : block.new_exits)
-        this->adjustGraphLayout(this->blocks[edge], col, row);
-}
-
-void DisassemblerGraphView::computeGraphLayout(DisassemblerBlock & block)
+//Runs the layout of a function graph off the GUI thread
+class GraphLayoutThread : public QThread
 {
-    //Compute child node layouts and arrange them horizontally
-    int col = 0;
-    int row_count = 1;
-    for(duint edge : block.new_exits)
+public:
+    explicit GraphLayoutThread(std::shared_ptr<GraphLayout> layout)
+        : mLayout(layout)
     {
-        this->computeGraphLayout(this->blocks[edge]);
-        this->adjustGraphLayout(this->blocks[edge], col, 1);
-        col += this->blocks[edge].col_count;
-        if((this->blocks[edge].row_count + 1) > row_count)
-            row_count = this->blocks[edge].row_count + 1;
     }
 
-    block.row = 0;
-    if(col >= 2)
+protected:
+    void run() override
     {
-        //Place this node centered over the child nodes
-        block.col = (col - 2) / 2;
-        block.col_count = col;
+        mLayout->Compute();
     }
-    else
-    {
-        //No child nodes, set single node's width (nodes are 2 columns wide to allow
-        //centering over a branch)
-        block.col = 0;
-        block.col_count = 2;
-    }
-    block.row_count = row_count;
-}
 
-bool DisassemblerGraphView::isEdgeMarked(EdgesVector & edges, int row, int col, int index)
-{
-    if(index >= int(edges[row][col].size()))
-        return false;
-    return edges[row][col][index];
-}
+private:
+    std::shared_ptr<GraphLayout> mLayout;
+};
 
-void DisassemblerGraphView::markEdge(EdgesVector & edges, int row, int col, int index)
-{
-    while(int(edges[row][col].size()) <= index)
-        edges[row][col].push_back(false);
-    edges[row][col][index] = true;
-}
-
-int DisassemblerGraphView::findHorizEdgeIndex(EdgesVector & edges, int row, int min_col, int max_col)
-{
-    //Find a valid index
-    int i = 0;
-    while(true)
-    {
-        bool valid = true;
-        for(int col = min_col; col < max_col + 1; col++) //TODO: use max_col+1 ?
-            if(isEdgeMarked(edges, row, col, i))
-            {
-                valid = false;
-                break;
-            }
-        if(valid)
-            break;
-        i++;
-    }
-
-    //Mark chosen index as used
-    for(int col = min_col; col < max_col + 1; col++) //TODO: use max_col+1 ?
-        this->markEdge(edges, row, col, i);
-    return i;
-}
-
-int DisassemblerGraphView::findVertEdgeIndex(EdgesVector & edges, int col, int min_row, int max_row)
-{
-    //Find a valid index
-    int i = 0;
-    while(true)
-    {
-        bool valid = true;
-        for(int row = min_row; row < max_row + 1; row++) //TODO: use max_row+1 ?
-            if(isEdgeMarked(edges, row, col, i))
-            {
-                valid = false;
-                break;
-            }
-        if(valid)
-            break;
-        i++;
-    }
-
-    //Mark chosen index as used
-    for(int row = min_row; row < max_row + 1; row++) //TODO: use max_row+1 ?
-        this->markEdge(edges, row, col, i);
-    return i;
-}
-
-DisassemblerGraphView::DisassemblerEdge DisassemblerGraphView::routeEdge(EdgesVector & horiz_edges, EdgesVector & vert_edges, Matrix<bool> & edge_valid, DisassemblerBlock & start, DisassemblerBlock & end, QColor color)
+void DisassemblerGraphView::renderFunction(Function & func)
 {
-    DisassemblerEdge edge;
-    edge.color = color;
-    edge.dest = &end;
-
-    //Find edge index for initial outgoing line
-    int i = 0;
-    while(true)
-    {
-        if(!this->isEdgeMarked(vert_edges, start.row + 1, start.col + 1, i))
-            break;
-        i += 1;
-    }
-    this->markEdge(vert_edges, start.row + 1, start.col + 1, i);
-    edge.addPoint(start.row + 1, start.col + 1);
-    edge.start_index = i;
-    bool horiz = false;
-
-    //Find valid column for moving vertically to the target node
-    int min_row, max_row;
-    if(end.row < (start.row + 1))
-    {
-        min_row = end.row;
-        max_row = start.row + 1;
-    }
-    else
-    {
-        min_row = start.row + 1;
-        max_row = end.row;
-    }
-    int col = start.col + 1;
-    if(min_row != max_row)
-    {
-        int ofs = 0;
-        while(true)
-        {
-            col = start.col + 1 - ofs;
-            if(col >= 0)
-            {
-                bool valid = true;
-                for(int row = min_row; row < max_row + 1; row++)
-                {
-                    if(!edge_valid[row][col])
-                    {
-                        valid = false;
-                        break;
-                    }
-                }
-                if(valid)
-                    break;
-            }
-
-            col = start.col + 1 + ofs;
-            if(col < int(edge_valid[min_row].size()))
-            {
-                bool valid = true;
-                for(int row = min_row; row < max_row + 1; row++)
-                {
-                    if(!edge_valid[row][col])
-                    {
-                        valid = false;
-                        break;
-                    }
-                }
-                if(valid)
-                    break;
-            }
-
-            ofs += 1;
-        }
-    }
-
-    if(col != (start.col + 1))
-    {
-        //Not in same column, need to generate a line for moving to the correct column
-        int min_col, max_col;
-        if(col < (start.col + 1))
-        {
-            min_col = col;
-            max_col = start.col + 1;
-        }
-        else
-        {
-            min_col = start.col + 1;
-            max_col = col;
-        }
-        int index = this->findHorizEdgeIndex(horiz_edges, start.row + 1, min_col, max_col);
-        edge.addPoint(start.row + 1, col, index);
-        horiz = true;
-    }
-
-    if(end.row != (start.row + 1))
+    //Create render nodes
+    std::unordered_map<duint, DisassemblerBlock> blocks;
+    std::vector<duint> entries;
+    for(Block & block : func.blocks)
     {
-        //Not in same row, need to generate a line for moving to the correct row
-        int index = this->findVertEdgeIndex(vert_edges, col, min_row, max_row);
-        edge.addPoint(end.row, col, index);
-        horiz = false;
+        blocks[block.entry] = DisassemblerBlock(block);
+        this->prepareGraphNode(blocks[block.entry]);
+        entries.push_back(block.entry);
     }
+    if(!blocks.count(func.entry))
+        return;
 
-    if(col != (end.col + 1))
+    //Hand the graph to the layout engine, nodes sorted by address
+    std::sort(entries.begin(), entries.end());
+    std::unordered_map<duint, int> indices;
+    for(int i = 0; i < int(entries.size()); i++)
+        indices[entries[i]] = i;
+    auto layout = std::make_shared<GraphLayout>();
+    layout->nodes.resize(entries.size());
+    for(int i = 0; i < int(entries.size()); i++)
     {
-        //Not in ending column, need to generate a line for moving to the correct column
-        int min_col, max_col;
-        if(col < (end.col + 1))
-        {
-            min_col = col;
-            max_col = end.col + 1;
-        }
-        else
+        const DisassemblerBlock & block = blocks[entries[i]];
+        GraphLayout::Node & node = layout->nodes[i];
+        node.width = block.width;
+        node.height = block.height;
+        for(duint exit : block.block.exits)
         {
-            min_col = end.col + 1;
-            max_col = col;
+            auto found = indices.find(exit);
+            if(found != indices.end())
+                node.exits.push_back(found->second);
         }
-        int index = this->findHorizEdgeIndex(horiz_edges, end.row, min_col, max_col);
-        edge.addPoint(end.row, end.col + 1, index);
-        horiz = true;
     }
+    layout->entry = indices[func.entry];
+
+    //The current graph stays on screen until the new layout is done
+    if(this->layoutJob)
+        this->layoutJob->Cancel();
+    this->layoutJob = layout;
+    this->layoutBlocks = std::move(blocks);
+    this->layoutEntries = std::move(entries);
+    this->layoutEntry = func.entry;
+    this->analysis.update_id = this->update_id = func.update_id;
 
-    //If last line was horizontal, choose the ending edge index for the incoming edge
-    if(horiz)
-    {
-        int index = this->findVertEdgeIndex(vert_edges, end.col + 1, end.row, end.row);
-        edge.points[int(edge.points.size()) - 1].index = index;
-    }
-
-    return edge;
-}
-
-template<class T>
-static void removeFromVec(std::vector<T> & vec, T elem)
-{
-    vec.erase(std::remove(vec.begin(), vec.end(), elem), vec.end());
-}
-
-template<class T>
-static void initVec(std::vector<T> & vec, size_t size, T value)
-{
-    vec.resize(size);
-    for(size_t i = 0; i < size; i++)
-        vec[i] = value;
+    auto thread = new GraphLayoutThread(layout);
+    connect(thread, SIGNAL(finished()), this, SLOT(layoutFinishedSlot()));
+    connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
+    thread->start();
 }
 
-void DisassemblerGraphView::renderFunction(Function & func)
+void DisassemblerGraphView::layoutFinishedSlot()
 {
-    puts("Starting renderFunction");
+    //Cancelled layouts finish as well, only the current one is applied
+    if(!this->layoutJob || !this->layoutJob->IsDone())
+        return;
+    auto layout = this->layoutJob;
+    this->layoutJob.reset();
 
-    //Create render nodes
-    this->blocks.clear();
-    for(Block & block : func.blocks)
+    this->blocks = std::move(this->layoutBlocks);
+    this->layoutBlocks.clear();
+    for(int i = 0; i < int(this->layoutEntries.size()); i++)
     {
-        this->blocks[block.entry] = DisassemblerBlock(block);
-        this->prepareGraphNode(this->blocks[block.entry]);
+        const GraphLayout::Node & node = layout->nodes[i];
+        DisassemblerBlock & block = this->blocks[this->layoutEntries[i]];
+        block.row = node.row;
+        block.col = node.col;
+        block.x = node.x;
+        block.y = node.y;
     }
-    puts("Create render nodes");
+    this->col_edge_x = layout->col_edge_x;
+    this->row_edge_y = layout->row_edge_y;
+    this->width = layout->width;
+    this->height = layout->height;
 
-    //Populate incoming lists
-    for(auto & blockIt : this->blocks)
-    {
-        DisassemblerBlock & block = blockIt.second;
-        for(auto & edge : block.block.exits)
-            this->blocks[edge].incoming.push_back(block.block.entry);
-    }
-    puts("Populate incoming lists");
-
-    //Construct acyclic graph where each node is used as an edge exactly once
-    //auto block = func.blocks[func.entry];
-    std::unordered_set<duint> visited;
-    visited.insert(func.entry);
-    std::queue<duint> queue;
-    queue.push(this->blocks[func.entry].block.entry);
-    auto changed = true;
-
-    int best_edges;
-    duint best_parent;
-    while(changed)
+    //Precompute coordinates for edges
+    for(int n = 0; n < int(this->layoutEntries.size()); n++)
     {
-        changed = false;
-
-        //First pick nodes that have single entry points
-        while(!queue.empty())
+        DisassemblerBlock & block = this->blocks[this->layoutEntries[n]];
+        for(const GraphLayout::Edge & layoutEdge : layout->nodes[n].edges)
         {
-            DisassemblerBlock & block = this->blocks[queue.front()];
-            queue.pop();
-
-            for(duint edge : block.block.exits)
+            DisassemblerEdge edge;
+            duint dest = this->layoutEntries[layoutEdge.dest];
+            edge.color = jmpColor;
+            if(dest == block.block.true_path)
+                edge.color = brtrueColor;
+            else if(dest == block.block.false_path)
+                edge.color = brfalseColor;
+            edge.dest = &this->blocks[dest];
+            edge.start_index = layoutEdge.start_index;
+            for(const GraphLayout::Point & layoutPoint : layoutEdge.points)
             {
-                if(visited.count(edge))
-                    continue;
-
-                //If node has no more unseen incoming edges, add it to the graph layout now
-                if(int(this->blocks[edge].incoming.size()) == 1)
-                {
-                    removeFromVec(this->blocks[edge].incoming, block.block.entry);
-                    block.new_exits.push_back(edge);
-                    queue.push(this->blocks[edge].block.entry);
-                    visited.insert(edge);
-                    changed = true;
-                }
+                Point point;
+                point.row = layoutPoint.row;
+                point.col = layoutPoint.col;
+                point.index = layoutPoint.index;
+                edge.points.push_back(point);
             }
-        }
-
-        //No more nodes satisfy constraints, pick a node to continue constructing the graph
-        duint best = 0;
-        for(auto & blockIt : this->blocks)
-        {
-            DisassemblerBlock & block = blockIt.second;
-            if(!visited.count(block.block.entry))
-                continue;
-            for(duint edge : block.block.exits)
-            {
-                if(visited.count(edge))
-                    continue;
-                if((best == 0) || (int(this->blocks[edge].incoming.size()) < best_edges) || (
-                            (int(this->blocks[edge].incoming.size()) == best_edges) && (edge < best)))
-                {
-                    best = edge;
-                    best_edges = int(this->blocks[edge].incoming.size());
-                    best_parent = block.block.entry;
-                }
-            }
-        }
-
-        if(best != 0)
-        {
-            DisassemblerBlock & best_parentb = this->blocks[best_parent];
-            removeFromVec(this->blocks[best].incoming, best_parentb.block.entry);
-            best_parentb.new_exits.push_back(best);
-            visited.insert(best);
-            changed = true;
-        }
-    }
-    puts("Construct acyclic graph where each node is used as an edge exactly once");
-
-    //Compute graph layout from bottom up
-    this->computeGraphLayout(this->blocks[func.entry]);
-    puts("Compute graph layout from bottom up");
-
-    //Prepare edge routing
-    EdgesVector horiz_edges, vert_edges;
-    horiz_edges.resize(this->blocks[func.entry].row_count + 1);
-    vert_edges.resize(this->blocks[func.entry].row_count + 1);
-    Matrix<bool> edge_valid;
-    edge_valid.resize(this->blocks[func.entry].row_count + 1);
-    for(int row = 0; row < this->blocks[func.entry].row_count + 1; row++)
-    {
-        horiz_edges[row].resize(this->blocks[func.entry].col_count + 1);
-        vert_edges[row].resize(this->blocks[func.entry].col_count + 1);
-        initVec(edge_valid[row], this->blocks[func.entry].col_count + 1, true);
-        for(int col = 0; col < this->blocks[func.entry].col_count + 1; col++)
-        {
-            horiz_edges[row][col].clear();
-            vert_edges[row][col].clear();
-        }
-    }
-    for(auto & blockIt : this->blocks)
-    {
-        DisassemblerBlock & block = blockIt.second;
-        edge_valid[block.row][block.col + 1] = false;
-    }
-    puts("Prepare edge routing");
-
-    //Perform edge routing
-    for(auto & blockIt : this->blocks)
-    {
-        DisassemblerBlock & block = blockIt.second;
-        DisassemblerBlock & start = block;
-        for(duint edge : block.block.exits)
-        {
-            DisassemblerBlock & end = this->blocks[edge];
-            QColor color = jmpColor;
-            if(edge == block.block.true_path)
-                color = brtrueColor;
-            else if(edge == block.block.false_path)
-                color = brfalseColor;
-            start.edges.push_back(this->routeEdge(horiz_edges, vert_edges, edge_valid, start, end, color));
-        }
-    }
-    puts("Perform edge routing");
-
-    //Compute edge counts for each row and column
-    std::vector<int> col_edge_count, row_edge_count;
-    initVec(col_edge_count, this->blocks[func.entry].col_count + 1, 0);
-    initVec(row_edge_count, this->blocks[func.entry].row_count + 1, 0);
-    for(int row = 0; row < this->blocks[func.entry].row_count + 1; row++)
-    {
-        for(int col = 0; col < this->blocks[func.entry].col_count + 1; col++)
-        {
-            if(int(horiz_edges[row][col].size()) > row_edge_count[row])
-                row_edge_count[row] = int(horiz_edges[row][col].size());
-            if(int(vert_edges[row][col].size()) > col_edge_count[col])
-                col_edge_count[col] = int(vert_edges[row][col].size());
-        }
-    }
-    puts("Compute edge counts for each row and column");
 
-    //Compute row and column sizes
-    std::vector<int> col_width, row_height;
-    initVec(col_width, this->blocks[func.entry].col_count + 1, 0);
-    initVec(row_height, this->blocks[func.entry].row_count + 1, 0);
-    for(auto & blockIt : this->blocks)
-    {
-        DisassemblerBlock & block = blockIt.second;
-        if((int(block.width / 2)) > col_width[block.col])
-            col_width[block.col] = int(block.width / 2);
-        if((int(block.width / 2)) > col_width[block.col + 1])
-            col_width[block.col + 1] = int(block.width / 2);
-        if(int(block.height) > row_height[block.row])
-            row_height[block.row] = int(block.height);
-    }
-    puts("Compute row and column sizes");
-
-    //Compute row and column positions
-    std::vector<int> col_x, row_y;
-    initVec(col_x, this->blocks[func.entry].col_count, 0);
-    initVec(row_y, this->blocks[func.entry].row_count, 0);
-    initVec(this->col_edge_x, this->blocks[func.entry].col_count + 1, 0);
-    initVec(this->row_edge_y, this->blocks[func.entry].row_count + 1, 0);
-    int x = 16;
-    for(int i = 0; i < this->blocks[func.entry].col_count; i++)
-    {
-        this->col_edge_x[i] = x;
-        x += 8 * col_edge_count[i];
-        col_x[i] = x;
-        x += col_width[i];
-    }
-    int y = 16;
-    for(int i = 0; i < this->blocks[func.entry].row_count; i++)
-    {
-        this->row_edge_y[i] = y;
-        y += 8 * row_edge_count[i];
-        row_y[i] = y;
-        y += row_height[i];
-    }
-    this->col_edge_x[this->blocks[func.entry].col_count] = x;
-    this->row_edge_y[this->blocks[func.entry].row_count] = y;
-    this->width = x + 16 + (8 * col_edge_count[this->blocks[func.entry].col_count]);
-    this->height = y + 16 + (8 * row_edge_count[this->blocks[func.entry].row_count]);
-    puts("Compute row and column positions");
-
-    //Compute node positions
-    for(auto & blockIt : this->blocks)
-    {
-        DisassemblerBlock & block = blockIt.second;
-        block.x = int(
-                      (col_x[block.col] + col_width[block.col] + 4 * col_edge_count[block.col + 1]) - (block.width / 2));
-        if((block.x + block.width) > (
-                    col_x[block.col] + col_width[block.col] + col_width[block.col + 1] + 8 * col_edge_count[
-                        block.col + 1]))
-        {
-            block.x = int((col_x[block.col] + col_width[block.col] + col_width[block.col + 1] + 8 * col_edge_count[
-                               block.col + 1]) - block.width);
-        }
-        block.y = row_y[block.row];
-    }
-    puts("Compute node positions");
-
-    //Precompute coordinates for edges
-    for(auto & blockIt : this->blocks)
-    {
-        DisassemblerBlock & block = blockIt.second;
-        for(DisassemblerEdge & edge : block.edges)
-        {
             auto start = edge.points[0];
             auto start_col = start.col;
             auto last_index = edge.start_index;
@@ -1097,14 +757,15 @@ void DisassemblerGraphView::renderFunction(Function & func)
             pts.append(QPoint(new_pt.x() + 3, new_pt.y() - 6));
             pts.append(new_pt);
             edge.arrow = pts;
+
+            block.edges.push_back(edge);
         }
     }
-    puts("Precompute coordinates for edges");
+    this->layoutEntries.clear();
 
     //Adjust scroll bars for new size
     auto areaSize = this->viewport()->size();
     this->adjustSize(areaSize.width(), areaSize.height());
-    puts("Adjust scroll bars for new size");
 
     if(this->desired_pos)
     {
@@ -1117,20 +778,20 @@ void DisassemblerGraphView::renderFunction(Function & func)
     else
     {
         //Ensure start node is visible
-        auto start_x = this->blocks[func.entry].x + this->renderXOfs + int(this->blocks[func.entry].width / 2);
+        auto start_x = this->blocks[this->layoutEntry].x + this->renderXOfs + int(this->blocks[this->layoutEntry].width / 2);
         this->horizontalScrollBar()->setValue(start_x - int(areaSize.width() / 2));
         this->verticalScrollBar()->setValue(0);
     }
 
-    this->analysis.update_id = this->update_id = func.update_id;
     this->ready = true;
     this->viewport()->update(0, 0, areaSize.width(), areaSize.height());
-    puts("Finished");
 }
 
 void DisassemblerGraphView::updateTimerEvent()
 {
     auto status = this->analysis.status;
+    if(this->layoutJob)
+        status = tr("Computing layout... %1%").arg(this->layoutJob->Progress());
     if(status != this->status)
     {
         this->status = status;
@@ -1149,6 +810,8 @@ void DisassemblerGraphView::updateTimerEvent()
     }
 
     //View not up to date, check to see if active function is ready
+    if(this->layoutJob && this->update_id == this->analysis.update_id)
+        return; //already being laid out
     if(this->analysis.functions.count(this->function))
     {
         if(this->analysis.functions[this->function].ready)
@@ -1202,6 +865,21 @@ bool DisassemblerGraphView::navigate(duint addr)
         }
     }
 
+    //Check the function that is being laid out
+    for(auto & blockIt : this->layoutBlocks)
+    {
+        for(Instr & instr : blockIt.second.block.instrs)
+        {
+            if((addr >= instr.addr) && (addr < (instr.addr + int(instr.opcode.size()))))
+            {
+                //Shown when the layout is done
+                this->cur_instr = instr.addr;
+                this->desired_pos = nullptr;
+                return true;
+            }
+        }
+    }
+
     //Check other functions for this address
     duint func, instr;
     if(this->analysis.find_instr(addr, func, instr))
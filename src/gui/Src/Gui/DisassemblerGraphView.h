@@ -13,8 +13,10 @@
 #include <unordered_set>
 #include <queue>
 #include <algorithm>
+#include <memory>
 #include <QMutex>
 #include "Bridge.h"
+#include "GraphLayout.h"
 #include "QBeaEngine.h"
 #include "CachedFontMetrics.h"
 #include "MenuBuilder.h"
@@ -230,18 +232,7 @@ public:
     void mouseReleaseEvent(QMouseEvent* event);
     void mouseDoubleClickEvent(QMouseEvent* event);
     void prepareGraphNode(DisassemblerBlock & block);
-    void adjustGraphLayout(DisassemblerBlock & block, int col, int row);
-    void computeGraphLayout(DisassemblerBlock & block);
     void setupContextMenu();
-
-    template<typename T>
-    using Matrix = std::vector<std::vector<T>>;
-    using EdgesVector = Matrix<std::vector<bool>>;
-    bool isEdgeMarked(EdgesVector & edges, int row, int col, int index);
-    void markEdge(EdgesVector & edges, int row, int col, int index);
-    int findHorizEdgeIndex(EdgesVector & edges, int row, int min_col, int max_col);
-    int findVertEdgeIndex(EdgesVector & edges, int col, int min_row, int max_row);
-    DisassemblerEdge routeEdge(EdgesVector & horiz_edges, EdgesVector & vert_edges, Matrix<bool> & edge_valid, DisassemblerBlock & start, DisassemblerBlock & end, QColor color);
     void renderFunction(Function & func);
     void show_cur_instr();
     bool navigate(duint addr);
@@ -249,6 +240,7 @@ public:
 
 public slots:
     void updateTimerEvent();
+    void layoutFinishedSlot();
     void loadGraphSlot(BridgeCFGraphList* graph, duint addr);
     void graphAtSlot(duint addr);
     void updateGraphSlot();
@@ -285,6 +277,10 @@ private:
     bool ready;
     int* desired_pos;
     std::unordered_map<duint, DisassemblerBlock> blocks;
+    std::shared_ptr<GraphLayout> layoutJob; //layout running on a worker thread
+    std::unordered_map<duint, DisassemblerBlock> layoutBlocks;
+    std::vector<duint> layoutEntries;
+    duint layoutEntry;
     HighlightToken* highlight_token;
     std::vector<int> col_edge_x;
     std::vector<int> row_edge_y;
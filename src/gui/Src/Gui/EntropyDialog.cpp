@@ -25,6 +25,16 @@ void EntropyDialog::GraphMemory(const unsigned char* data, int dataSize, QColor
     ui->entropyView->GraphMemory(data, dataSize, mBlockSize, mPointCount, color);
 }
 
+void EntropyDialog::GraphMemoryRegion(duint addr, duint size, QColor color)
+{
+    initializeGraph();
+    //Read from the debuggee on demand, only the bytes around the sampled points are needed
+    ui->entropyView->GraphStream([addr](size_t offset, unsigned char* buffer, size_t size)
+    {
+        return DbgMemRead(addr + offset, buffer, size);
+    }, size, mBlockSize, mPointCount, color);
+}
+
 void EntropyDialog::GraphFile(const QString & fileName, QColor color)
 {
     initializeGraph();
@@ -2,6 +2,7 @@
 #define ENTROPYDIALOG_H
 
 #include <QDialog>
+#include "Imports.h"
 
 namespace Ui
 {
@@ -16,6 +17,7 @@ public:
     explicit EntropyDialog(QWidget* parent = 0);
     ~EntropyDialog();
     void GraphMemory(const unsigned char* data, int dataSize, QColor color = Qt::darkGreen);
+    void GraphMemoryRegion(duint addr, duint size, QColor color = Qt::darkGreen);
     void GraphFile(const QString & fileName, QColor color = Qt::darkGreen);
 
 private:
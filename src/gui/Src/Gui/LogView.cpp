@@ -2,16 +2,25 @@
 #include "Configuration.h"
 #include "Bridge.h"
 #include "BrowseDialog.h"
+#include "LineEditDialog.h"
+#include "LogRedirectThread.h"
 
-LogView::LogView(QWidget* parent) : QTextEdit(parent), logRedirection(NULL)
+LogView::LogView(QWidget* parent) : AbstractTableView(parent), logRedirection(NULL)
 {
-    updateStyle();
-    this->setUndoRedoEnabled(false);
-    this->setReadOnly(true);
+    mLineStart = 0;
+    mLineCount = 0;
+    mLastLineOpen = false;
+    mLongestLine = 0;
+    mGuiState = LogView::NoState;
+    mSelectionStart = mSelectionFrom = mSelectionTo = -1;
+    mLines.resize(int(qMax(duint(1000), ConfigUint("Gui", "LogMaxLines"))));
+
+    setDrawDebugOnly(false);
+    setShowHeader(false);
+    addColumnAt(0, "", false);
+    Initialize();
     this->setLoggingEnabled(true);
 
-    connect(Config(), SIGNAL(colorsUpdated()), this, SLOT(updateStyle()));
-    connect(Config(), SIGNAL(fontsUpdated()), this, SLOT(updateStyle()));
     connect(Bridge::getBridge(), SIGNAL(addMsgToLog(QString)), this, SLOT(addMsgToLogSlot(QString)));
     connect(Bridge::getBridge(), SIGNAL(clearLog()), this, SLOT(clearLogSlot()));
     connect(Bridge::getBridge(), SIGNAL(setLogEnabled(bool)), this, SLOT(setLoggingEnabled(bool)));
@@ -21,15 +30,18 @@ LogView::LogView(QWidget* parent) : QTextEdit(parent), logRedirection(NULL)
 
 LogView::~LogView()
 {
-    if(logRedirection != NULL)
-        fclose(logRedirection);
+    delete logRedirection;
     logRedirection = NULL;
 }
 
-void LogView::updateStyle()
+void LogView::updateFonts()
 {
     setFont(ConfigFont("Log"));
-    setStyleSheet(QString("QTextEdit { color: %1; background-color: %2 }").arg(ConfigColor("AbstractTableViewTextColor").name(), ConfigColor("AbstractTableViewBackgroundColor").name()));
+    invalidateCachedFont();
+    mLongestLine = 0;
+    for(dsint i = 0; i < mLineCount; i++)
+        mLongestLine = qMax(mLongestLine, lineAt(i).length());
+    updateColumnWidth();
 }
 
 void LogView::setupContextMenu()
@@ -39,13 +51,17 @@ void LogView::setupContextMenu()
     actionClear->setShortcutContext(Qt::WidgetShortcut);
     this->addAction(actionClear);
     actionCopy = new QAction(tr("&Copy"), this);
-    connect(actionCopy, SIGNAL(triggered()), this, SLOT(copy()));
+    connect(actionCopy, SIGNAL(triggered()), this, SLOT(copySlot()));
     actionCopy->setShortcutContext(Qt::WidgetShortcut);
     this->addAction(actionCopy);
     actionSelectAll = new QAction(tr("Select &All"), this);
-    connect(actionSelectAll, SIGNAL(triggered()), this, SLOT(selectAll()));
+    connect(actionSelectAll, SIGNAL(triggered()), this, SLOT(selectAllSlot()));
     actionSelectAll->setShortcutContext(Qt::WidgetShortcut);
     this->addAction(actionSelectAll);
+    actionFind = new QAction(tr("&Find..."), this);
+    connect(actionFind, SIGNAL(triggered()), this, SLOT(findSlot()));
+    actionFind->setShortcutContext(Qt::WidgetShortcut);
+    this->addAction(actionFind);
     actionSave = new QAction(tr("&Save"), this);
     actionSave->setShortcutContext(Qt::WidgetShortcut);
     connect(actionSave, SIGNAL(triggered()), this, SLOT(saveSlot()));
@@ -65,6 +81,8 @@ void LogView::setupContextMenu()
 void LogView::refreshShortcutsSlot()
 {
     actionCopy->setShortcut(ConfigShortcut("ActionCopy"));
+    actionSelectAll->setShortcut(QKeySequence::SelectAll);
+    actionFind->setShortcut(ConfigShortcut("ActionFind"));
     actionToggleLogging->setShortcut(ConfigShortcut("ActionToggleLogging"));
 }
 
@@ -74,6 +92,7 @@ void LogView::contextMenuEvent(QContextMenuEvent* event)
     wMenu.addAction(actionClear);
     wMenu.addAction(actionSelectAll);
     wMenu.addAction(actionCopy);
+    wMenu.addAction(actionFind);
     wMenu.addAction(actionSave);
     if(getLoggingEnabled())
         actionToggleLogging->setText(tr("Disable &Logging"));
@@ -85,60 +104,299 @@ void LogView::contextMenuEvent(QContextMenuEvent* event)
     wMenu.exec(event->globalPos());
 }
 
+QString LogView::paintContent(QPainter* painter, dsint rowBase, int rowOffset, int col, int x, int y, int w, int h)
+{
+    Q_UNUSED(col);
+    dsint index = rowBase + rowOffset;
+    if(index < 0 || index >= mLineCount)
+        return QString();
+    if(index >= mSelectionFrom && index <= mSelectionTo)
+        painter->fillRect(QRect(x, y, w, h), QBrush(selectionColor));
+    return lineAt(index);
+}
+
+/************************************************************************************
+                                Line Management
+************************************************************************************/
+const QString & LogView::lineAt(dsint index) const
+{
+    return mLines.at(int((mLineStart + index) % mLines.size()));
+}
+
+void LogView::appendLine(const QString & line)
+{
+    if(mLineCount == mLines.size()) //drop the oldest line
+    {
+        mLines[int(mLineStart)] = line;
+        mLineStart = (mLineStart + 1) % mLines.size();
+    }
+    else
+        mLines[int((mLineStart + mLineCount++) % mLines.size())] = line;
+    mLongestLine = qMax(mLongestLine, line.length());
+}
+
+/**
+ * @brief       Appends a message to the ring buffer, splitting it into lines.
+ *
+ * @param[in]   msg      Message text
+ *
+ * @return      Number of old lines that were dropped to make space.
+ */
+dsint LogView::appendText(const QString & msg)
+{
+    dsint dropped = 0;
+    int pos = 0;
+    while(pos < msg.length())
+    {
+        int newline = msg.indexOf(QChar('\n'), pos);
+        int end = newline == -1 ? msg.length() : newline;
+        int len = end - pos;
+        if(len && msg.at(end - 1) == QChar('\r'))
+            len--;
+        QString line = msg.mid(pos, len);
+        if(mLastLineOpen && mLineCount)
+        {
+            QString & last = mLines[int((mLineStart + mLineCount - 1) % mLines.size())];
+            last += line;
+            mLongestLine = qMax(mLongestLine, last.length());
+        }
+        else
+        {
+            if(mLineCount == mLines.size())
+                dropped++;
+            appendLine(line);
+        }
+        mLastLineOpen = newline == -1;
+        pos = end + 1;
+    }
+    return dropped;
+}
+
+void LogView::updateColumnWidth()
+{
+    int width = qMax(this->viewport()->width(), mLongestLine * getCharWidth() + 8);
+    if(width != getColumnWidth(0))
+    {
+        setColumnWidth(0, width);
+        horizontalScrollBar()->setRange(0, width - this->viewport()->width());
+    }
+}
+
 void LogView::addMsgToLogSlot(QString msg)
 {
-    // fix Unix-style line endings.
-    msg.replace(QString("\r\n"), QString("\n"));
-    msg.replace(QChar('\n'), QString("\r\n"));
     // redirect the log
     if(logRedirection != NULL)
+        logRedirection->write(msg);
+    if(!loggingEnabled)
+        return;
+    bool atBottom = getTableOffset() + getViewableRowsCount() > getRowCount();
+    dsint dropped = appendText(msg);
+    setRowCount(mLineCount);
+    if(dropped && mSelectionTo != -1)
+    {
+        mSelectionStart = qMax(dsint(0), mSelectionStart - dropped);
+        mSelectionFrom = qMax(dsint(0), mSelectionFrom - dropped);
+        mSelectionTo -= dropped;
+        if(mSelectionTo < 0)
+            mSelectionStart = mSelectionFrom = mSelectionTo = -1;
+    }
+    // This keeps the newest line visible, unless the user scrolled up
+    if(atBottom)
+        setTableOffset(getRowCount());
+    else if(dropped)
+        setTableOffset(qMax(dsint(0), getTableOffset() - dropped));
+    updateColumnWidth();
+    reloadData();
+}
+
+void LogView::clearLogSlot()
+{
+    mLines.fill(QString());
+    mLines.resize(int(qMax(duint(1000), ConfigUint("Gui", "LogMaxLines"))));
+    mLineStart = 0;
+    mLineCount = 0;
+    mLastLineOpen = false;
+    mLongestLine = 0;
+    mSelectionStart = mSelectionFrom = mSelectionTo = -1;
+    setRowCount(0);
+    setTableOffset(0);
+    updateColumnWidth();
+    reloadData();
+}
+
+/************************************************************************************
+                                Selection Management
+************************************************************************************/
+void LogView::setSelection(dsint start, dsint end)
+{
+    mSelectionStart = start;
+    mSelectionFrom = qMin(start, end);
+    mSelectionTo = qMax(start, end);
+}
+
+void LogView::scrollToLine(dsint index)
+{
+    if(index < getTableOffset() || index >= getTableOffset() + getViewableRowsCount() - 1)
+        setTableOffset(qMax(dsint(0), index - getViewableRowsCount() / 2));
+}
+
+void LogView::mouseMoveEvent(QMouseEvent* event)
+{
+    if(mGuiState == LogView::SelectionState && transY(event->y()) >= 0 && transY(event->y()) <= this->getTableHeigth())
     {
-        if(!fwrite(msg.data_ptr()->data(), msg.size() * 2, 1, logRedirection))
+        dsint wRowIndex = getTableOffset() + getIndexOffsetFromY(transY(event->y()));
+        if(wRowIndex < getRowCount())
         {
-            fclose(logRedirection);
-            logRedirection = NULL;
-            msg += tr("fwrite() failed (GetLastError()= %1 ). Log redirection stopped.\r\n").arg(GetLastError());
+            setSelection(mSelectionStart, wRowIndex);
+            updateViewport();
+            return;
         }
     }
-    if(!loggingEnabled)
+    AbstractTableView::mouseMoveEvent(event);
+}
+
+void LogView::mousePressEvent(QMouseEvent* event)
+{
+    if((event->buttons() & Qt::LeftButton) != 0 && (event->buttons() & Qt::RightButton) == 0 && getGuiState() == AbstractTableView::NoState)
+    {
+        dsint wRowIndex = getTableOffset() + getIndexOffsetFromY(transY(event->y()));
+        if(wRowIndex < getRowCount())
+        {
+            if((event->modifiers() & Qt::ShiftModifier) && mSelectionStart != -1)
+                setSelection(mSelectionStart, wRowIndex);
+            else
+                setSelection(wRowIndex, wRowIndex);
+            mGuiState = LogView::SelectionState;
+            updateViewport();
+            return;
+        }
+    }
+    AbstractTableView::mousePressEvent(event);
+}
+
+void LogView::mouseReleaseEvent(QMouseEvent* event)
+{
+    if((event->buttons() & Qt::LeftButton) == 0 && mGuiState == LogView::SelectionState)
+    {
+        mGuiState = LogView::NoState;
+        updateViewport();
         return;
-    if(this->document()->characterCount() > 10000 * 100) //limit the log to ~100mb
-        this->clear();
-    // This sets the cursor to the end for the next insert
-    this->moveCursor(QTextCursor::End);
-    this->insertPlainText(msg);
-    // This sets the cursor to the end to display the new text
-    this->moveCursor(QTextCursor::End);
+    }
+    AbstractTableView::mouseReleaseEvent(event);
 }
 
-void LogView::clearLogSlot()
+void LogView::keyPressEvent(QKeyEvent* event)
 {
-    this->clear();
+    int key = event->key();
+    if((key == Qt::Key_Up || key == Qt::Key_Down) && mSelectionStart != -1)
+    {
+        dsint wNext = mSelectionTo == mSelectionStart ? mSelectionFrom : mSelectionTo;
+        wNext += key == Qt::Key_Up ? -1 : 1;
+        wNext = qMax(dsint(0), qMin(wNext, getRowCount() - 1));
+        if(event->modifiers() & Qt::ShiftModifier)
+            setSelection(mSelectionStart, wNext);
+        else
+            setSelection(wNext, wNext);
+        scrollToLine(wNext);
+        updateViewport();
+    }
+    else if(key == Qt::Key_Home && (event->modifiers() & Qt::ControlModifier))
+        setTableOffset(0);
+    else if(key == Qt::Key_End && (event->modifiers() & Qt::ControlModifier))
+        setTableOffset(getRowCount());
+    else
+        AbstractTableView::keyPressEvent(event);
+}
+
+void LogView::resizeEvent(QResizeEvent* event)
+{
+    AbstractTableView::resizeEvent(event);
+    updateColumnWidth();
+}
+
+QString LogView::getSelectedText(dsint from, dsint to)
+{
+    QString text;
+    for(dsint i = from; i <= to && i < mLineCount; i++)
+    {
+        text += lineAt(i);
+        text += "\r\n";
+    }
+    return text;
+}
+
+void LogView::copySlot()
+{
+    if(mSelectionFrom == -1)
+        return;
+    Bridge::CopyToClipboard(getSelectedText(mSelectionFrom, mSelectionTo));
+}
+
+void LogView::selectAllSlot()
+{
+    if(!mLineCount)
+        return;
+    setSelection(0, mLineCount - 1);
+    updateViewport();
+}
+
+void LogView::findSlot()
+{
+    LineEditDialog mLineEdit(this);
+    mLineEdit.setWindowTitle(tr("Find"));
+    mLineEdit.setText(mLastSearch);
+    mLineEdit.selectAllText();
+    if(mLineEdit.exec() != QDialog::Accepted || !mLineEdit.editText.length())
+        return;
+    mLastSearch = mLineEdit.editText;
+    // search the buffer after the selection, wrapping around
+    dsint start = mSelectionFrom == -1 ? 0 : mSelectionFrom + 1;
+    for(dsint i = 0; i < mLineCount; i++)
+    {
+        dsint index = (start + i) % mLineCount;
+        if(lineAt(index).contains(mLastSearch, Qt::CaseInsensitive))
+        {
+            setSelection(index, index);
+            scrollToLine(index);
+            updateViewport();
+            return;
+        }
+    }
+    GuiAddStatusBarMessage(tr("\"%1\" not found in the log\n").arg(mLastSearch).toUtf8().constData());
 }
 
 void LogView::redirectLogSlot()
 {
-    if(logRedirection != NULL)
-        fclose(logRedirection);
+    delete logRedirection;
     logRedirection = NULL;
     BrowseDialog browse(this, tr("Redirect log to file"), tr("Enter the file to which you want to redirect log messages."), tr("Log files(*.txt);;All files(*.*)"), QCoreApplication::applicationDirPath(), true);
     if(browse.exec() == QDialog::Accepted)
     {
-        logRedirection = _wfopen(browse.path.toStdWString().c_str(), L"ab");
-        if(logRedirection == NULL)
+        FILE* file = _wfopen(browse.path.toStdWString().c_str(), L"ab");
+        if(file == NULL)
             GuiAddLogMessage(tr("_wfopen() failed. Log will not be redirected to %1.\n").arg(browse.path).toUtf8().constData());
         else
         {
-            if(ftell(logRedirection) == 0)
+            if(ftell(file) == 0)
             {
                 unsigned short BOM = 0xfeff;
-                fwrite(&BOM, 2, 1, logRedirection);
+                fwrite(&BOM, 2, 1, file);
             }
+            logRedirection = new LogRedirectThread(file);
+            connect(logRedirection, SIGNAL(writeFailed(unsigned int)), this, SLOT(redirectFailedSlot(unsigned int)), Qt::QueuedConnection);
+            logRedirection->start();
             GuiAddLogMessage(tr("Log will be redirected to %1.\n").arg(browse.path).toUtf8().constData());
         }
     }
 }
 
+void LogView::redirectFailedSlot(unsigned int lastError)
+{
+    delete logRedirection;
+    logRedirection = NULL;
+    GuiAddLogMessage(tr("fwrite() failed (GetLastError()= %1 ). Log redirection stopped.\n").arg(lastError).toUtf8().constData());
+}
+
 void LogView::setLoggingEnabled(bool enabled)
 {
     if(enabled)
@@ -170,7 +428,14 @@ void LogView::saveSlot()
     }
     else
     {
-        savedLog.write(this->document()->toPlainText().toUtf8().constData());
+        // QIODevice::Text converts the line endings again
+        QString text;
+        for(dsint i = 0; i < mLineCount; i++)
+        {
+            text += lineAt(i);
+            text += '\n';
+        }
+        savedLog.write(text.toUtf8().constData());
         savedLog.close();
         GuiAddLogMessage(tr("Log have been saved as %1\n").arg(fileName).toUtf8().constData());
     }
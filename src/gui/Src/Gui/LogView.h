@@ -1,10 +1,11 @@
 #ifndef LOGVIEW_H
 #define LOGVIEW_H
 
-#include <QTextEdit>
-#include <cstdio>
+#include "AbstractTableView.h"
 
-class LogView : public QTextEdit
+class LogRedirectThread;
+
+class LogView : public AbstractTableView
 {
     Q_OBJECT
     Q_PROPERTY(int viewId MEMBER m_viewId)
@@ -13,16 +14,27 @@ public:
     ~LogView();
     void setupContextMenu();
     void contextMenuEvent(QContextMenuEvent* event);
+    void updateFonts();
+    QString paintContent(QPainter* painter, dsint rowBase, int rowOffset, int col, int x, int y, int w, int h);
+
+    void mouseMoveEvent(QMouseEvent* event);
+    void mousePressEvent(QMouseEvent* event);
+    void mouseReleaseEvent(QMouseEvent* event);
+    void keyPressEvent(QKeyEvent* event);
+    void resizeEvent(QResizeEvent* event);
 
 public slots:
     void refreshShortcutsSlot();
-    void updateStyle();
     void addMsgToLogSlot(QString msg);
     void redirectLogSlot();
+    void redirectFailedSlot(unsigned int lastError);
     void setLoggingEnabled(bool enabled);
     bool getLoggingEnabled();
 
     void clearLogSlot();
+    void copySlot();
+    void selectAllSlot();
+    void findSlot();
     void saveSlot();
     void toggleLoggingSlot();
 private:
@@ -32,11 +44,34 @@ private:
     QAction* actionCopy;
     QAction* actionSelectAll;
     QAction* actionClear;
+    QAction* actionFind;
     QAction* actionSave;
     QAction* actionToggleLogging;
     QAction* actionRedirectLog;
 
-    FILE* logRedirection;
+    LogRedirectThread* logRedirection;
+
+    //ring buffer of log lines, the oldest lines are dropped when it is full
+    QVector<QString> mLines;
+    dsint mLineStart;
+    dsint mLineCount;
+    bool mLastLineOpen; //the last message did not end with a newline
+    int mLongestLine;
+
+    enum GuiState_t {NoState, SelectionState};
+    GuiState_t mGuiState;
+    dsint mSelectionStart;
+    dsint mSelectionFrom;
+    dsint mSelectionTo;
+    QString mLastSearch;
+
+    const QString & lineAt(dsint index) const;
+    dsint appendText(const QString & msg);
+    void appendLine(const QString & line);
+    void setSelection(dsint start, dsint end);
+    void scrollToLine(dsint index);
+    void updateColumnWidth();
+    QString getSelectedText(dsint from, dsint to);
 };
 
 #endif // LOGVIEW_H
@@ -279,82 +279,108 @@ QString MemoryMapView::paintContent(QPainter* painter, dsint rowBase, int rowOff
     return StdTable::paintContent(painter, rowBase, rowOffset, col, x, y, w, h);
 }
 
-void MemoryMapView::refreshMap()
+MemoryMapView::MemoryRow MemoryMapView::makeRow(const MEMPAGE & page)
 {
-    MEMMAP wMemMapStruct;
-    int wI;
+    MemoryRow row;
+    row.page = page;
+    const MEMORY_BASIC_INFORMATION & wMbi = page.mbi;
+    QString wS;
 
-    memset(&wMemMapStruct, 0, sizeof(MEMMAP));
+    // Base address
+    row.cells.append(QString("%1").arg((duint)wMbi.BaseAddress, sizeof(duint) * 2, 16, QChar('0')).toUpper());
 
-    DbgMemMap(&wMemMapStruct);
-    mCipBase = DbgMemFindBaseAddr(DbgValFromString("cip"), nullptr);
+    // Size
+    row.cells.append(QString("%1").arg((duint)wMbi.RegionSize, sizeof(duint) * 2, 16, QChar('0')).toUpper());
 
-    setRowCount(wMemMapStruct.count);
+    // Information
+    row.cells.append(QString(page.info));
 
-    for(wI = 0; wI < wMemMapStruct.count; wI++)
+    // Type
+    switch(wMbi.Type)
     {
-        QString wS;
-        MEMORY_BASIC_INFORMATION wMbi = (wMemMapStruct.page)[wI].mbi;
+    case MEM_IMAGE:
+        wS = QString("IMG");
+        break;
+    case MEM_MAPPED:
+        wS = QString("MAP");
+        break;
+    case MEM_PRIVATE:
+        wS = QString("PRV");
+        break;
+    default:
+        wS = QString("N/A");
+        break;
+    }
+    row.cells.append(wS);
 
-        // Base address
-        wS = QString("%1").arg((duint)wMbi.BaseAddress, sizeof(duint) * 2, 16, QChar('0')).toUpper();
-        setCellContent(wI, 0, wS);
+    // current access protection
+    row.cells.append(getProtectionString(wMbi.Protect));
 
-        // Size
-        wS = QString("%1").arg((duint)wMbi.RegionSize, sizeof(duint) * 2, 16, QChar('0')).toUpper();
-        setCellContent(wI, 1, wS);
+    // allocation protection
+    row.cells.append(getProtectionString(wMbi.AllocationProtect));
+    return row;
+}
 
-        // Information
-        wS = QString((wMemMapStruct.page)[wI].info);
-        setCellContent(wI, 2, wS);
+void MemoryMapView::refreshMap()
+{
+    MEMMAP wMemMapStruct;
 
-        // State
-        switch(wMbi.State)
-        {
-        case MEM_FREE:
-            wS = QString("FREE");
-            break;
-        case MEM_COMMIT:
-            wS = QString("COMM");
-            break;
-        case MEM_RESERVE:
-            wS = QString("RESV");
-            break;
-        default:
-            wS = QString("????");
-        }
-        setCellContent(wI, 3, wS);
+    memset(&wMemMapStruct, 0, sizeof(MEMMAP));
 
-        // Type
-        switch(wMbi.Type)
+    DbgMemMap(&wMemMapStruct);
+    mCipBase = DbgMemFindBaseAddr(DbgValFromString("cip"), nullptr);
+
+    // Both maps are sorted by address, only the pages that were added or changed are formatted again
+    std::vector<MemoryRow> rows;
+    rows.reserve(wMemMapStruct.count);
+    bool changed = wMemMapStruct.count != int(mRows.size());
+    size_t wOld = 0;
+    for(int wI = 0; wI < wMemMapStruct.count; wI++)
+    {
+        const MEMPAGE & page = (wMemMapStruct.page)[wI];
+        while(wOld < mRows.size() && duint(mRows[wOld].page.mbi.BaseAddress) < duint(page.mbi.BaseAddress))
+            wOld++;
+        if(wOld < mRows.size() &&
+                memcmp(&mRows[wOld].page.mbi, &page.mbi, sizeof(page.mbi)) == 0 &&
+                strcmp(mRows[wOld].page.info, page.info) == 0)
+            rows.push_back(mRows[wOld++]);
+        else
         {
-        case MEM_IMAGE:
-            wS = QString("IMG");
-            break;
-        case MEM_MAPPED:
-            wS = QString("MAP");
-            break;
-        case MEM_PRIVATE:
-            wS = QString("PRV");
-            break;
-        default:
-            wS = QString("N/A");
-            break;
+            rows.push_back(makeRow(page));
+            changed = true;
         }
-        setCellContent(wI, 3, wS);
+    }
+    if(wMemMapStruct.page != 0)
+        BridgeFree(wMemMapStruct.page);
 
-        // current access protection
-        wS = getProtectionString(wMbi.Protect);
-        setCellContent(wI, 4, wS);
+    if(!changed)
+    {
+        updateViewport(); //the cip page might have moved
+        return;
+    }
+    mRows.swap(rows);
 
-        // allocation protection
-        wS = getProtectionString(wMbi.AllocationProtect);
-        setCellContent(wI, 5, wS);
+    // Keep the selected page selected when rows were added or removed in front of it
+    QString wSelection = getCellContent(getInitialSelection(), 0);
 
+    setRowCount(int(mRows.size()));
+    for(int wI = 0; wI < int(mRows.size()); wI++)
+    {
+        const QList<QString> & cells = mRows[wI].cells;
+        for(int wJ = 0; wJ < cells.size(); wJ++)
+            setCellContent(wI, wJ, cells.at(wJ));
     }
-    if(wMemMapStruct.page != 0)
-        BridgeFree(wMemMapStruct.page);
     reloadData(); //refresh memory map
+
+    if(!wSelection.isEmpty() && getCellContent(getInitialSelection(), 0) != wSelection)
+    {
+        for(int wI = 0; wI < getRowCount(); wI++)
+            if(getCellContent(wI, 0) == wSelection)
+            {
+                setSingleSelection(wI);
+                break;
+            }
+    }
 }
 
 void MemoryMapView::stateChangedSlot(DBGSTATE state)
@@ -475,16 +501,12 @@ void MemoryMapView::entropy()
 {
     duint addr = getCellContent(getInitialSelection(), 0).toULongLong(0, 16);
     duint size = getCellContent(getInitialSelection(), 1).toULongLong(0, 16);
-    unsigned char* data = new unsigned char[size];
-    DbgMemRead(addr, data, size);
 
     EntropyDialog entropyDialog(this);
     entropyDialog.setWindowTitle(tr("Entropy (Address: %1, Size: %2)").arg(ToPtrString(addr).arg(ToPtrString(size))));
     entropyDialog.show();
-    entropyDialog.GraphMemory(data, size);
+    entropyDialog.GraphMemoryRegion(addr, size);
     entropyDialog.exec();
-
-    delete[] data;
 }
 
 void MemoryMapView::memoryAllocateSlot()
@@ -2,6 +2,7 @@
 #define MEMORYMAPVIEW_H
 
 #include "StdTable.h"
+#include <vector>
 
 class MemoryMapView : public StdTable
 {
@@ -43,8 +44,15 @@ public slots:
     void findAddressSlot();
 
 private:
+    struct MemoryRow
+    {
+        MEMPAGE page;
+        QList<QString> cells;
+    };
+
     int m_viewId;
     QString getProtectionString(DWORD Protect);
+    MemoryRow makeRow(const MEMPAGE & page);
 
     QAction* mFollowDump;
     QAction* mFollowDisassembly;
@@ -72,6 +80,7 @@ private:
     QAction* mFindAddress;
 
     duint mCipBase;
+    std::vector<MemoryRow> mRows; //last map that was shown, sorted by address
 };
 
 #endif // MEMORYMAPVIEW_H
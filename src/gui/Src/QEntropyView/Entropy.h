@@ -2,65 +2,144 @@
 #define ENTROPY_H
 
 #include <cmath>
+#include <cstring>
 #include <vector>
+#include <thread>
+#include <functional>
+#include <algorithm>
 
 class Entropy
 {
 public:
-    static double MeasureData(const unsigned char* data, int dataSize)
+    //Reads size bytes at offset into buffer, has to be callable from several threads at once
+    typedef std::function<bool(size_t offset, unsigned char* buffer, size_t size)> Reader;
+
+    //Entropy of the last size bytes pushed, updated per byte instead of recounting the whole window
+    class Window
     {
-        int occurrences[256] = {};
-        for(int i = 0; i < dataSize; i++)
-            occurrences[data[i]]++;
-        double entropy = 0.0;
-        double logBase = log(256);
-        for(int i = 0; i < 256; i++)
+    public:
+        explicit Window(size_t size)
+            : mSize(size),
+              mBytes(size),
+              mXLogX(size + 1)
         {
-            if(occurrences[i] == 0)
-                continue;
-            double p = (double)occurrences[i] / (double)dataSize;
-            entropy += p * log(p) / logBase;
+            //-sum(p*log(p)) with p = c/n equals log(n) - sum(c*log(c))/n, so only c*log(c) is needed
+            for(size_t i = 1; i <= size; i++)
+                mXLogX[i] = double(i) * log(double(i));
+            Reset();
         }
-        return -entropy;
-    }
 
-    static double MeasureByte(const unsigned char* data, int dataSize, int index, unsigned char* block, int blockSize)
-    {
-        if(dataSize < blockSize)
-            return -1;
-        int start = index - blockSize / 2;
-        int end = index + blockSize / 2;
-        if(start < 0)
+        void Reset()
         {
-            end += -start;
-            start = 0;
+            memset(mOccurrences, 0, sizeof(mOccurrences));
+            mCount = 0;
+            mPos = 0;
+            mSum = 0.0;
         }
-        else if(end > dataSize)
+
+        void Push(unsigned char byte)
         {
-            start -= end - dataSize;
-            end = dataSize;
+            if(mCount == mSize)
+            {
+                size_t & old = mOccurrences[mBytes[mPos]];
+                mSum += mXLogX[old - 1] - mXLogX[old];
+                old--;
+            }
+            else
+                mCount++;
+            size_t & occurrences = mOccurrences[byte];
+            mSum += mXLogX[occurrences + 1] - mXLogX[occurrences];
+            occurrences++;
+            mBytes[mPos] = byte;
+            mPos = (mPos + 1) % mSize;
         }
-        for(int i = start; i < end; i++)
-            block[i - start] = data[i];
-        return MeasureData(block, blockSize);
+
+        double Value() const
+        {
+            if(!mCount)
+                return 0.0;
+            double entropy = (log(double(mCount)) - mSum / double(mCount)) / log(256.0);
+            return std::min(std::max(entropy, 0.0), 1.0);
+        }
+
+    private:
+        size_t mSize;
+        size_t mCount;
+        size_t mPos;
+        double mSum;
+        size_t mOccurrences[256];
+        std::vector<unsigned char> mBytes;
+        std::vector<double> mXLogX;
+    };
+
+    static double MeasureData(const unsigned char* data, size_t dataSize)
+    {
+        if(!dataSize)
+            return 0.0;
+        Window window(dataSize);
+        for(size_t i = 0; i < dataSize; i++)
+            window.Push(data[i]);
+        return window.Value();
+    }
+
+    static void MeasurePoints(const unsigned char* data, size_t dataSize, size_t blockSize, std::vector<double> & points, size_t pointCount)
+    {
+        MeasurePoints(dataSize, blockSize, points, pointCount, [data](size_t offset, unsigned char* buffer, size_t size)
+        {
+            memcpy(buffer, data + offset, size);
+            return true;
+        });
     }
 
-    static void MeasurePoints(const unsigned char* data, int dataSize, int blockSize, std::vector<double> & points, int pointCount)
+    //Only the bytes of the windows around the points are read, so the data can be streamed from a large region
+    static void MeasurePoints(size_t dataSize, size_t blockSize, std::vector<double> & points, size_t pointCount, const Reader & reader)
     {
         points.clear();
-        if(dataSize < pointCount)
+        if(!pointCount || dataSize < pointCount || !blockSize || dataSize < blockSize)
             return;
         if(dataSize % pointCount != 0)
             pointCount += dataSize % pointCount;
 
-        unsigned char* block = new unsigned char[blockSize];
-        int interval = dataSize / pointCount;
-        points.reserve(pointCount);
-        for(int i = 0; i < dataSize; i += interval)
-            points.push_back(MeasureByte(data, dataSize, i, block, blockSize));
-        delete[] block;
+        size_t interval = dataSize / pointCount;
+        size_t count = (dataSize + interval - 1) / interval;
+        points.resize(count);
+
+        //Every thread slides its own window over a contiguous range of points
+        auto measure = [&](size_t first, size_t last)
+        {
+            Window window(blockSize);
+            std::vector<unsigned char> buffer;
+            size_t windowEnd = 0;
+            for(size_t i = first; i < last; i++)
+            {
+                size_t index = i * interval;
+                size_t start = index < blockSize / 2 ? 0 : std::min(index - blockSize / 2, dataSize - blockSize);
+                size_t end = start + blockSize;
+                size_t readStart = start;
+                if(i != first && start < windowEnd)
+                    readStart = windowEnd; //overlaps the previous window, only push the new bytes
+                else
+                    window.Reset();
+                buffer.resize(end - readStart);
+                if(!buffer.empty() && !reader(readStart, buffer.data(), buffer.size()))
+                    std::fill(buffer.begin(), buffer.end(), 0);
+                for(unsigned char byte : buffer)
+                    window.Push(byte);
+                windowEnd = end;
+                points[i] = window.Value();
+            }
+        };
+
+        const size_t minPointsPerThread = 32;
+        size_t threadCount = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), count / minPointsPerThread));
+        size_t chunk = (count + threadCount - 1) / threadCount;
+        std::vector<std::thread> threads;
+        for(size_t first = chunk; first < count; first += chunk)
+            threads.push_back(std::thread(measure, first, std::min(first + chunk, count)));
+        measure(0, std::min(chunk, count));
+        for(auto & thread : threads)
+            thread.join();
     }
 };
 
 #endif // ENTROPY_H
-
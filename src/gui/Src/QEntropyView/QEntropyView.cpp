@@ -1,6 +1,5 @@
 #include "QEntropyView.h"
 #include <QFile>
-#include "Entropy.h"
 
 QEntropyView::QEntropyView(QWidget* parent)
     : QGraphicsView(parent),
@@ -70,7 +69,16 @@ void QEntropyView::GraphFile(const QString & fileName, int blockSize, int pointC
     GraphMemory((unsigned char*)fileData.constData(), fileData.size(), blockSize, pointCount, color);
 }
 
-void QEntropyView::GraphMemory(const unsigned char* data, int dataSize, int blockSize, int pointCount, QColor color)
+void QEntropyView::GraphMemory(const unsigned char* data, size_t dataSize, size_t blockSize, size_t pointCount, QColor color)
+{
+    GraphStream([data](size_t offset, unsigned char* buffer, size_t size)
+    {
+        memcpy(buffer, data + offset, size);
+        return true;
+    }, dataSize, blockSize, pointCount, color);
+}
+
+void QEntropyView::GraphStream(const Entropy::Reader & reader, size_t dataSize, size_t blockSize, size_t pointCount, QColor color)
 {
     std::vector<double> points;
     if(dataSize < blockSize)
@@ -80,7 +88,7 @@ void QEntropyView::GraphMemory(const unsigned char* data, int dataSize, int bloc
             blockSize = 1;
     }
     if(dataSize < pointCount)
-        pointCount = (int)dataSize;
-    Entropy::MeasurePoints(data, dataSize, blockSize, points, pointCount);
+        pointCount = dataSize;
+    Entropy::MeasurePoints(dataSize, blockSize, points, pointCount, reader);
     AddGraph(points, color);
 }
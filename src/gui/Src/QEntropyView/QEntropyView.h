@@ -2,6 +2,7 @@
 #define QENTROPYVIEW_H
 
 #include <QGraphicsView>
+#include "Entropy.h"
 
 class QGraphicsScene;
 
@@ -13,7 +14,8 @@ public:
     void InitializeGraph(int penSize = 1);
     void AddGraph(const std::vector<double> & points, QColor color = Qt::black);
     void GraphFile(const QString & fileName, int blockSize, int pointCount, QColor = Qt::black);
-    void GraphMemory(const unsigned char* data, int dataSize, int blockSize, int pointCount, QColor = Qt::black);
+    void GraphMemory(const unsigned char* data, size_t dataSize, size_t blockSize, size_t pointCount, QColor = Qt::black);
+    void GraphStream(const Entropy::Reader & reader, size_t dataSize, size_t blockSize, size_t pointCount, QColor = Qt::black);
 
 private:
     QGraphicsScene* mScene;
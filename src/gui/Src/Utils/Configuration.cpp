@@ -190,6 +190,7 @@ Configuration::Configuration() : QObject(), noMoreMsgbox(false)
     disassemblyBool.insert("OnlyCipAutoComments", false);
     disassemblyBool.insert("TabbedMnemonic", false);
     disassemblyBool.insert("LongDataInstruction", false);
+    disassemblyBool.insert("ShowTokenCacheStatistics", false);
     defaultBools.insert("Disassembler", disassemblyBool);
 
     QMap<QString, bool> engineBool;
@@ -222,6 +223,7 @@ Configuration::Configuration() : QObject(), noMoreMsgbox(false)
     AbstractTableView::setupColumnConfigDefaultValue(guiUint, "Handle", 5);
     AbstractTableView::setupColumnConfigDefaultValue(guiUint, "TcpConnection", 3);
     AbstractTableView::setupColumnConfigDefaultValue(guiUint, "Privilege", 2);
+    guiUint.insert("LogMaxLines", 100000);
     defaultUints.insert("Gui", guiUint);
 
     //uint settings
@@ -465,6 +467,7 @@ void Configuration::readColors()
         QString id = Colors.keys().at(i);
         Colors[id] = colorFromConfig(id);
     }
+    resolveColors();
 }
 
 void Configuration::writeColors()
@@ -475,11 +478,13 @@ void Configuration::writeColors()
         QString id = Colors.keys().at(i);
         colorToConfig(id, Colors[id]);
     }
+    resolveColors();
     emit colorsUpdated();
 }
 
 void Configuration::emitColorsUpdated()
 {
+    resolveColors();
     emit colorsUpdated();
 }
 
@@ -570,6 +575,7 @@ void Configuration::readFonts()
         if(id == "Application" || fontInfo.fixedPitch())
             Fonts[id] = font;
     }
+    resolveFonts();
 }
 
 void Configuration::writeFonts()
@@ -580,11 +586,13 @@ void Configuration::writeFonts()
         QString id = Fonts.keys().at(i);
         fontToConfig(id, Fonts[id]);
     }
+    resolveFonts();
     emit fontsUpdated();
 }
 
 void Configuration::emitFontsUpdated()
 {
+    resolveFonts();
     emit fontsUpdated();
 }
 
@@ -638,6 +646,27 @@ const QColor Configuration::getColor(const QString id) const
     return Qt::black;
 }
 
+/**
+ * @brief Returns the handle of a color, the value behind it is updated in place when the colors change.
+ */
+int Configuration::colorHandle(const QString & id)
+{
+    auto found = mColorHandles.constFind(id);
+    if(found != mColorHandles.constEnd())
+        return found.value();
+    int handle = int(mColorTable.size());
+    mColorHandles.insert(id, handle);
+    mColorIds.push_back(id);
+    mColorTable.push_back(getColor(id));
+    return handle;
+}
+
+void Configuration::resolveColors()
+{
+    for(size_t i = 0; i < mColorIds.size(); i++)
+        mColorTable[i] = Colors.value(mColorIds[i], Qt::black);
+}
+
 const bool Configuration::getBool(const QString category, const QString id) const
 {
     if(Bools.contains(category))
@@ -759,6 +788,31 @@ const QFont Configuration::getFont(const QString id) const
     return ret;
 }
 
+/**
+ * @brief Returns the handle of a font, the value behind it is updated in place when the fonts change.
+ */
+int Configuration::fontHandle(const QString & id)
+{
+    auto found = mFontHandles.constFind(id);
+    if(found != mFontHandles.constEnd())
+        return found.value();
+    int handle = int(mFontTable.size());
+    mFontHandles.insert(id, handle);
+    mFontIds.push_back(id);
+    mFontTable.push_back(getFont(id));
+    return handle;
+}
+
+void Configuration::resolveFonts()
+{
+    for(size_t i = 0; i < mFontIds.size(); i++)
+    {
+        auto found = Fonts.constFind(mFontIds[i]);
+        if(found != Fonts.constEnd())
+            mFontTable[i] = found.value();
+    }
+}
+
 const Configuration::Shortcut Configuration::getShortcut(const QString key_id) const
 {
     if(Shortcuts.contains(key_id))
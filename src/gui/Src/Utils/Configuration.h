@@ -6,13 +6,16 @@
 #include <QMap>
 #include <QColor>
 #include <QFont>
+#include <vector>
 #include "Imports.h"
 
 #define Config() (Configuration::instance())
-#define ConfigColor(x) (Config()->getColor(x))
+// Resolves a string literal key to a handle once per call site
+#define ConfigHandle(type, x) ([]() { static const int handle = Config()->type##Handle(x); return handle; }())
+#define ConfigColor(x) (Config()->getColor(ConfigHandle(color, x)))
 #define ConfigBool(x,y) (Config()->getBool(x,y))
 #define ConfigUint(x,y) (Config()->getUint(x,y))
-#define ConfigFont(x) (Config()->getFont(x))
+#define ConfigFont(x) (Config()->getFont(ConfigHandle(font, x)))
 #define ConfigShortcut(x) (Config()->getShortcut(x).Hotkey)
 #define ConfigHScrollBarStyle() "QScrollBar:horizontal{border:1px solid grey;background:#f1f1f1;height:10px}QScrollBar::handle:horizontal{background:#aaa;min-width:20px;margin:1px}QScrollBar::add-line:horizontal,QScrollBar::sub-line:horizontal{width:0;height:0}"
 #define ConfigVScrollBarStyle() "QScrollBar:vertical{border:1px solid grey;background:#f1f1f1;width:10px}QScrollBar::handle:vertical{background:#aaa;min-height:20px;margin:1px}QScrollBar::add-line:vertical,QScrollBar::sub-line:vertical{width:0;height:0}"
@@ -53,11 +56,21 @@ public:
     void writeShortcuts();
 
     const QColor getColor(const QString id) const;
+    int colorHandle(const QString & id);
+    const QColor & getColor(int handle) const
+    {
+        return mColorTable[handle];
+    }
     const bool getBool(const QString category, const QString id) const;
     void setBool(const QString category, const QString id, const bool b);
     const duint getUint(const QString category, const QString id) const;
     void setUint(const QString category, const QString id, const duint i);
     const QFont getFont(const QString id) const;
+    int fontHandle(const QString & id);
+    const QFont & getFont(int handle) const
+    {
+        return mFontTable[handle];
+    }
     const Shortcut getShortcut(const QString key_id) const;
     void setShortcut(const QString key_id, const QKeySequence key_sequence);
 
@@ -94,8 +107,18 @@ private:
     bool fontToConfig(const QString id, const QFont font);
     QString shortcutFromConfig(const QString id);
     bool shortcutToConfig(const QString id, const QKeySequence shortcut);
+    void resolveColors();
+    void resolveFonts();
 
     mutable bool noMoreMsgbox;
+
+    //resolved values, indexed by handle
+    QMap<QString, int> mColorHandles;
+    std::vector<QString> mColorIds;
+    std::vector<QColor> mColorTable;
+    QMap<QString, int> mFontHandles;
+    std::vector<QString> mFontIds;
+    std::vector<QFont> mFontTable;
 };
 
 #endif // CONFIGURATION_H
@@ -0,0 +1,422 @@
+#include "GraphLayout.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <tuple>
+
+GraphLayout::GraphLayout()
+    : mCancel(false),
+      mDone(false),
+      mProgress(0)
+{
+}
+
+bool GraphLayout::Compute()
+{
+    mProgress = 0;
+    if(entry < 0 || entry >= int(nodes.size()))
+    {
+        mDone = true;
+        return true;
+    }
+
+    //Construct acyclic graph where each node is used as an edge exactly once
+    std::vector<std::vector<int>> new_exits(nodes.size());
+    if(!makeAcyclic(new_exits))
+        return false;
+    mProgress = 20;
+
+    //Compute graph layout from bottom up
+    int col_count, row_count;
+    if(!computeLayout(new_exits, col_count, row_count))
+        return false;
+    mProgress = 30;
+
+    //Prepare edge routing
+    int cols = col_count + 1;
+    EdgeGrid horiz_edges, vert_edges;
+    horiz_edges.init(cols);
+    vert_edges.init(cols);
+    mBlockedRows.clear();
+    mBlockedRows.resize(cols);
+    for(const Node & node : nodes)
+        mBlockedRows[node.col + 1].push_back(node.row);
+    for(auto & rows : mBlockedRows)
+        std::sort(rows.begin(), rows.end());
+
+    //Perform edge routing
+    for(size_t i = 0; i < nodes.size(); i++)
+    {
+        Node & start = nodes[i];
+        start.edges.clear();
+        for(int exit : start.exits)
+            start.edges.push_back(routeEdge(horiz_edges, vert_edges, cols, start, nodes[exit]));
+        if(mCancel)
+            return false;
+        mProgress = 30 + int(i * 65 / nodes.size());
+    }
+
+    //Compute edge counts for each row and column
+    std::vector<int> col_edge_count(col_count + 1, 0), row_edge_count(row_count + 1, 0);
+    horiz_edges.forEach([&](int row, int, int count)
+    {
+        row_edge_count[row] = std::max(row_edge_count[row], count);
+    });
+    vert_edges.forEach([&](int, int col, int count)
+    {
+        col_edge_count[col] = std::max(col_edge_count[col], count);
+    });
+
+    //Compute row and column sizes
+    std::vector<int> col_width(col_count + 1, 0), row_height(row_count + 1, 0);
+    for(const Node & node : nodes)
+    {
+        if((node.width / 2) > col_width[node.col])
+            col_width[node.col] = node.width / 2;
+        if((node.width / 2) > col_width[node.col + 1])
+            col_width[node.col + 1] = node.width / 2;
+        if(node.height > row_height[node.row])
+            row_height[node.row] = node.height;
+    }
+
+    //Compute row and column positions
+    std::vector<int> col_x(col_count, 0), row_y(row_count, 0);
+    col_edge_x.assign(col_count + 1, 0);
+    row_edge_y.assign(row_count + 1, 0);
+    int x = 16;
+    for(int i = 0; i < col_count; i++)
+    {
+        col_edge_x[i] = x;
+        x += 8 * col_edge_count[i];
+        col_x[i] = x;
+        x += col_width[i];
+    }
+    int y = 16;
+    for(int i = 0; i < row_count; i++)
+    {
+        row_edge_y[i] = y;
+        y += 8 * row_edge_count[i];
+        row_y[i] = y;
+        y += row_height[i];
+    }
+    col_edge_x[col_count] = x;
+    row_edge_y[row_count] = y;
+    width = x + 16 + (8 * col_edge_count[col_count]);
+    height = y + 16 + (8 * row_edge_count[row_count]);
+
+    //Compute node positions
+    for(Node & node : nodes)
+    {
+        int right = col_x[node.col] + col_width[node.col] + col_width[node.col + 1] + 8 * col_edge_count[node.col + 1];
+        node.x = (col_x[node.col] + col_width[node.col] + 4 * col_edge_count[node.col + 1]) - (node.width / 2);
+        if((node.x + node.width) > right)
+            node.x = right - node.width;
+        node.y = row_y[node.row];
+    }
+
+    mProgress = 100;
+    mDone = true;
+    return true;
+}
+
+void GraphLayout::Cancel()
+{
+    mCancel = true;
+}
+
+bool GraphLayout::IsCancelled() const
+{
+    return mCancel;
+}
+
+bool GraphLayout::IsDone() const
+{
+    return mDone;
+}
+
+int GraphLayout::Progress() const
+{
+    return mProgress;
+}
+
+bool GraphLayout::makeAcyclic(std::vector<std::vector<int>> & new_exits)
+{
+    //The number of unseen incoming edges only changes for a node when it is placed, so it can be counted up front
+    std::vector<int> incoming(nodes.size(), 0);
+    for(const Node & node : nodes)
+        for(int exit : node.exits)
+            incoming[exit]++;
+
+    //Edges to unplaced nodes ordered by (incoming edges, node, parent)
+    typedef std::tuple<int, int, int> Candidate;
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+    std::vector<bool> visited(nodes.size(), false);
+    auto addCandidates = [&](int parent)
+    {
+        for(int exit : nodes[parent].exits)
+            if(!visited[exit])
+                candidates.push(Candidate(incoming[exit], exit, parent));
+    };
+
+    std::queue<int> queue;
+    visited[entry] = true;
+    queue.push(entry);
+    while(true)
+    {
+        //First pick nodes that have single entry points
+        while(!queue.empty())
+        {
+            int parent = queue.front();
+            queue.pop();
+            for(int exit : nodes[parent].exits)
+            {
+                if(visited[exit] || incoming[exit] != 1)
+                    continue;
+                new_exits[parent].push_back(exit);
+                visited[exit] = true;
+                queue.push(exit);
+            }
+            addCandidates(parent);
+        }
+        if(mCancel)
+            return false;
+
+        //No more nodes satisfy constraints, pick a node to continue constructing the graph
+        while(!candidates.empty() && visited[std::get<1>(candidates.top())])
+            candidates.pop();
+        if(candidates.empty())
+            break;
+        int best = std::get<1>(candidates.top());
+        int best_parent = std::get<2>(candidates.top());
+        candidates.pop();
+        new_exits[best_parent].push_back(best);
+        visited[best] = true;
+        addCandidates(best);
+    }
+    return true;
+}
+
+bool GraphLayout::computeLayout(const std::vector<std::vector<int>> & new_exits, int & col_count, int & row_count)
+{
+    //Walk the tree with an explicit stack, deep graphs would overflow the call stack
+    std::vector<int> order;
+    order.reserve(nodes.size());
+    std::vector<int> stack(1, entry);
+    while(!stack.empty())
+    {
+        int node = stack.back();
+        stack.pop_back();
+        order.push_back(node);
+        for(int child : new_exits[node])
+            stack.push_back(child);
+    }
+
+    //Compute child node layouts and arrange them horizontally, children come after their parent in order
+    std::vector<int> col_counts(nodes.size(), 0), row_counts(nodes.size(), 0), local_col(nodes.size(), 0), shift(nodes.size(), 0);
+    for(auto it = order.rbegin(); it != order.rend(); ++it)
+    {
+        int node = *it;
+        int col = 0;
+        int rows = 1;
+        for(int child : new_exits[node])
+        {
+            shift[child] = col;
+            col += col_counts[child];
+            if((row_counts[child] + 1) > rows)
+                rows = row_counts[child] + 1;
+        }
+
+        if(col >= 2)
+        {
+            //Place this node centered over the child nodes
+            local_col[node] = (col - 2) / 2;
+            col_counts[node] = col;
+        }
+        else
+        {
+            //No child nodes, set single node's width (nodes are 2 columns wide to allow
+            //centering over a branch)
+            local_col[node] = 0;
+            col_counts[node] = 2;
+        }
+        row_counts[node] = rows;
+    }
+    if(mCancel)
+        return false;
+
+    //Every subtree is moved one row down and to its column within the parent's subtree
+    std::vector<int> frame_col(nodes.size(), 0), frame_row(nodes.size(), 0);
+    for(int node : order)
+    {
+        for(int child : new_exits[node])
+        {
+            frame_col[child] = frame_col[node] + shift[child];
+            frame_row[child] = frame_row[node] + 1;
+        }
+        nodes[node].col = frame_col[node] + local_col[node];
+        nodes[node].row = frame_row[node];
+    }
+
+    col_count = col_counts[entry];
+    row_count = row_counts[entry];
+    return true;
+}
+
+bool GraphLayout::isColumnFree(int col, int min_row, int max_row) const
+{
+    const auto & rows = mBlockedRows[col];
+    auto found = std::lower_bound(rows.begin(), rows.end(), min_row);
+    return found == rows.end() || *found > max_row;
+}
+
+GraphLayout::Edge GraphLayout::routeEdge(EdgeGrid & horiz_edges, EdgeGrid & vert_edges, int cols, const Node & start, const Node & end)
+{
+    Edge edge;
+    edge.dest = int(&end - nodes.data());
+
+    //Find edge index for initial outgoing line
+    int i = 0;
+    while(vert_edges.isMarked(start.row + 1, start.col + 1, i))
+        i += 1;
+    vert_edges.mark(start.row + 1, start.col + 1, i);
+    edge.addPoint(start.row + 1, start.col + 1);
+    edge.start_index = i;
+    bool horiz = false;
+
+    //Find valid column for moving vertically to the target node
+    int min_row, max_row;
+    if(end.row < (start.row + 1))
+    {
+        min_row = end.row;
+        max_row = start.row + 1;
+    }
+    else
+    {
+        min_row = start.row + 1;
+        max_row = end.row;
+    }
+    int col = start.col + 1;
+    if(min_row != max_row)
+    {
+        int ofs = 0;
+        while(true)
+        {
+            col = start.col + 1 - ofs;
+            if(col >= 0 && isColumnFree(col, min_row, max_row))
+                break;
+
+            col = start.col + 1 + ofs;
+            if(col < cols && isColumnFree(col, min_row, max_row))
+                break;
+
+            ofs += 1;
+        }
+    }
+
+    if(col != (start.col + 1))
+    {
+        //Not in same column, need to generate a line for moving to the correct column
+        int min_col = std::min(col, start.col + 1);
+        int max_col = std::max(col, start.col + 1);
+        int index = horiz_edges.findHorizIndex(start.row + 1, min_col, max_col);
+        edge.addPoint(start.row + 1, col, index);
+        horiz = true;
+    }
+
+    if(end.row != (start.row + 1))
+    {
+        //Not in same row, need to generate a line for moving to the correct row
+        int index = vert_edges.findVertIndex(col, min_row, max_row);
+        edge.addPoint(end.row, col, index);
+        horiz = false;
+    }
+
+    if(col != (end.col + 1))
+    {
+        //Not in ending column, need to generate a line for moving to the correct column
+        int min_col = std::min(col, end.col + 1);
+        int max_col = std::max(col, end.col + 1);
+        int index = horiz_edges.findHorizIndex(end.row, min_col, max_col);
+        edge.addPoint(end.row, end.col + 1, index);
+        horiz = true;
+    }
+
+    //If last line was horizontal, choose the ending edge index for the incoming edge
+    if(horiz)
+    {
+        int index = vert_edges.findVertIndex(end.col + 1, end.row, end.row);
+        edge.points[int(edge.points.size()) - 1].index = index;
+    }
+
+    return edge;
+}
+
+void GraphLayout::EdgeGrid::init(int cols)
+{
+    mCols = cols;
+    mCells.clear();
+}
+
+bool GraphLayout::EdgeGrid::isMarked(int row, int col, int index) const
+{
+    auto found = mCells.find(key(row, col));
+    if(found == mCells.end() || index >= int(found->second.size()))
+        return false;
+    return found->second[index];
+}
+
+void GraphLayout::EdgeGrid::mark(int row, int col, int index)
+{
+    auto & cell = mCells[key(row, col)];
+    if(int(cell.size()) <= index)
+        cell.resize(index + 1, false);
+    cell[index] = true;
+}
+
+int GraphLayout::EdgeGrid::findHorizIndex(int row, int min_col, int max_col)
+{
+    //Find a valid index
+    int i = 0;
+    while(true)
+    {
+        bool valid = true;
+        for(int col = min_col; col < max_col + 1; col++)
+            if(isMarked(row, col, i))
+            {
+                valid = false;
+                break;
+            }
+        if(valid)
+            break;
+        i++;
+    }
+
+    //Mark chosen index as used
+    for(int col = min_col; col < max_col + 1; col++)
+        mark(row, col, i);
+    return i;
+}
+
+int GraphLayout::EdgeGrid::findVertIndex(int col, int min_row, int max_row)
+{
+    //Find a valid index
+    int i = 0;
+    while(true)
+    {
+        bool valid = true;
+        for(int row = min_row; row < max_row + 1; row++)
+            if(isMarked(row, col, i))
+            {
+                valid = false;
+                break;
+            }
+        if(valid)
+            break;
+        i++;
+    }
+
+    //Mark chosen index as used
+    for(int row = min_row; row < max_row + 1; row++)
+        mark(row, col, i);
+    return i;
+}
@@ -0,0 +1,111 @@
+#ifndef GRAPHLAYOUT_H
+#define GRAPHLAYOUT_H
+
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+
+//Layered layout of a control flow graph, free of any GUI types so it can run on a worker thread
+class GraphLayout
+{
+public:
+    struct Point
+    {
+        int row;
+        int col;
+        int index;
+    };
+
+    struct Edge
+    {
+        int dest; //index of the destination node
+        int start_index = 0;
+        std::vector<Point> points;
+
+        void addPoint(int row, int col, int index = 0)
+        {
+            Point point;
+            point.row = row;
+            point.col = col;
+            point.index = 0;
+            this->points.push_back(point);
+            if(int(this->points.size()) > 1)
+                this->points[this->points.size() - 2].index = index;
+        }
+    };
+
+    struct Node
+    {
+        //input
+        int width = 0;
+        int height = 0;
+        std::vector<int> exits; //indices of the successor nodes
+
+        //output
+        int row = 0;
+        int col = 0;
+        int x = 0;
+        int y = 0;
+        std::vector<Edge> edges; //one for every exit, in the same order
+    };
+
+    //input, nodes are expected to be sorted by address so ties are broken the same way every time
+    std::vector<Node> nodes;
+    int entry = 0;
+
+    //output
+    std::vector<int> col_edge_x;
+    std::vector<int> row_edge_y;
+    int width = 0;
+    int height = 0;
+
+    GraphLayout();
+
+    //returns false when the layout was cancelled
+    bool Compute();
+    void Cancel();
+    bool IsCancelled() const;
+    bool IsDone() const;
+    int Progress() const;
+
+private:
+    //edge indices in use per grid cell, only cells that are crossed by an edge are stored
+    class EdgeGrid
+    {
+    public:
+        void init(int cols);
+        bool isMarked(int row, int col, int index) const;
+        void mark(int row, int col, int index);
+        int findHorizIndex(int row, int min_col, int max_col);
+        int findVertIndex(int col, int min_row, int max_row);
+        template<typename F>
+        void forEach(F && cb) const
+        {
+            for(const auto & cell : mCells)
+                cb(int(cell.first / mCols), int(cell.first % mCols), int(cell.second.size()));
+        }
+
+    private:
+        unsigned long long key(int row, int col) const
+        {
+            return (unsigned long long)row * mCols + col;
+        }
+
+        unsigned long long mCols = 0;
+        std::unordered_map<unsigned long long, std::vector<bool>> mCells;
+    };
+
+    std::atomic<bool> mCancel;
+    std::atomic<bool> mDone;
+    std::atomic<int> mProgress;
+
+    //rows occupied by a node per edge column, sorted
+    std::vector<std::vector<int>> mBlockedRows;
+
+    bool makeAcyclic(std::vector<std::vector<int>> & new_exits);
+    bool computeLayout(const std::vector<std::vector<int>> & new_exits, int & col_count, int & row_count);
+    bool isColumnFree(int col, int min_row, int max_row) const;
+    Edge routeEdge(EdgeGrid & horiz_edges, EdgeGrid & vert_edges, int cols, const Node & start, const Node & end);
+};
+
+#endif // GRAPHLAYOUT_H
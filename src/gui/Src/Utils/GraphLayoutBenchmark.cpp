@@ -0,0 +1,72 @@
+#include "GraphLayoutBenchmark.h"
+#include "GraphLayout.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+//Deterministic generator, so every run lays out the same graphs
+static unsigned int nextRandom(unsigned int & state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+//Blocks in address order with the usual mix of fall-throughs, conditional branches, loops and switches
+static void makeGraph(GraphLayout & layout, int blockCount, int & edgeCount)
+{
+    unsigned int state = 0x1337;
+    layout.nodes.clear();
+    layout.nodes.resize(blockCount);
+    layout.entry = 0;
+    edgeCount = 0;
+    for(int i = 0; i < blockCount; i++)
+    {
+        GraphLayout::Node & node = layout.nodes[i];
+        node.width = 80 + int(nextRandom(state) % 320);
+        node.height = 20 + int(nextRandom(state) % 180);
+        if(i == blockCount - 1)
+            break; //the last block returns
+        auto addExit = [&](int exit)
+        {
+            exit = std::max(0, std::min(exit, blockCount - 1));
+            if(exit != i && std::find(node.exits.begin(), node.exits.end(), exit) == node.exits.end())
+                node.exits.push_back(exit);
+        };
+        unsigned int kind = nextRandom(state) % 10;
+        addExit(i + 1);
+        if(kind >= 5 && kind <= 7) //conditional forward branch
+            addExit(i + 2 + int(nextRandom(state) % 50));
+        else if(kind == 8) //loop
+            addExit(i - 1 - int(nextRandom(state) % 20));
+        else if(kind == 9) //switch
+        {
+            for(int j = 0; j < 4; j++)
+                addExit(i + 2 + int(nextRandom(state) % 100));
+        }
+        edgeCount += int(node.exits.size());
+    }
+}
+
+std::string GraphLayoutBenchmark(int blockCount)
+{
+    std::string result;
+    const int sizes[] = { blockCount / 10, blockCount / 3, blockCount };
+    for(int size : sizes)
+    {
+        if(size < 2)
+            continue;
+        GraphLayout layout;
+        int edgeCount;
+        makeGraph(layout, size, edgeCount);
+        auto start = std::chrono::steady_clock::now();
+        layout.Compute();
+        auto end = std::chrono::steady_clock::now();
+        char line[256];
+        sprintf_s(line, "Graph layout: %d blocks, %d edges in %lldms (%dx%d)\n", size, edgeCount,
+                  (long long)std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count(), layout.width, layout.height);
+        result += line;
+    }
+    return result;
+}
@@ -0,0 +1,9 @@
+#ifndef GRAPHLAYOUTBENCHMARK_H
+#define GRAPHLAYOUTBENCHMARK_H
+
+#include <string>
+
+//Lays out synthetic control flow graphs of up to blockCount blocks and reports the time per stage size
+std::string GraphLayoutBenchmark(int blockCount);
+
+#endif // GRAPHLAYOUTBENCHMARK_H
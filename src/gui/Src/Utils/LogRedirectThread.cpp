@@ -0,0 +1,62 @@
+#include "LogRedirectThread.h"
+#include <Windows.h>
+
+LogRedirectThread::LogRedirectThread(FILE* file, QObject* parent) : QThread(parent)
+{
+    mFile = file;
+    mStop = false;
+}
+
+LogRedirectThread::~LogRedirectThread()
+{
+    stop();
+}
+
+void LogRedirectThread::write(const QString & msg)
+{
+    QMutexLocker locker(&mMutex);
+    mPending += msg;
+    mPendingCondition.wakeOne();
+}
+
+void LogRedirectThread::stop()
+{
+    {
+        QMutexLocker locker(&mMutex);
+        mStop = true;
+        mPendingCondition.wakeOne();
+    }
+    wait();
+    if(mFile != NULL)
+        fclose(mFile);
+    mFile = NULL;
+}
+
+void LogRedirectThread::run()
+{
+    while(true)
+    {
+        QString msg;
+        bool stop;
+        {
+            QMutexLocker locker(&mMutex);
+            while(mPending.isEmpty() && !mStop)
+                mPendingCondition.wait(&mMutex);
+            msg.swap(mPending);
+            stop = mStop;
+        }
+        if(msg.length())
+        {
+            // fix Unix-style line endings.
+            msg.replace(QString("\r\n"), QString("\n"));
+            msg.replace(QChar('\n'), QString("\r\n"));
+            if(!fwrite(msg.utf16(), msg.size() * 2, 1, mFile))
+            {
+                emit writeFailed(GetLastError());
+                return;
+            }
+        }
+        if(stop) //everything that was written before stopping is flushed
+            return;
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef LOGREDIRECTTHREAD_H
+#define LOGREDIRECTTHREAD_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <cstdio>
+
+class LogRedirectThread : public QThread
+{
+    Q_OBJECT
+public:
+    explicit LogRedirectThread(FILE* file, QObject* parent = 0);
+    ~LogRedirectThread();
+    void write(const QString & msg);
+    void stop();
+
+signals:
+    void writeFailed(unsigned int lastError);
+
+private:
+    void run();
+
+    FILE* mFile;
+    QMutex mMutex;
+    QWaitCondition mPendingCondition;
+    QString mPending;
+    bool mStop;
+};
+
+#endif // LOGREDIRECTTHREAD_H
@@ -142,6 +142,7 @@ SOURCES += \
     Src/Utils/MainWindowCloseThread.cpp \
     Src/Gui/TimeWastedCounter.cpp \
     Src/Utils/FlickerThread.cpp \
+    Src/Utils/LogRedirectThread.cpp \
     Src/QEntropyView/QEntropyView.cpp \
     Src/Gui/EntropyDialog.cpp \
     Src/Gui/NotesManager.cpp \
@@ -167,7 +168,9 @@ SOURCES += \
     Src/Gui/FavouriteTools.cpp \
     Src/Gui/BrowseDialog.cpp \
     Src/Gui/DisassemblerGraphView.cpp \
-    Src/Gui/DisassemblyPopup.cpp
+    Src/Gui/DisassemblyPopup.cpp \
+    Src/Utils/GraphLayout.cpp \
+    Src/Utils/GraphLayoutBenchmark.cpp
 
 
 HEADERS += \
@@ -242,6 +245,7 @@ HEADERS += \
     Src/Utils/MainWindowCloseThread.h \
     Src/Gui/TimeWastedCounter.h \
     Src/Utils/FlickerThread.h \
+    Src/Utils/LogRedirectThread.h \
     Src/QEntropyView/Entropy.h \
     Src/QEntropyView/QEntropyView.h \
     Src/Gui/EntropyDialog.h \
@@ -271,7 +275,9 @@ HEADERS += \
     Src/Gui/BrowseDialog.h \
     Src/Gui/DisassemblerGraphView.h \
     Src/Utils/ActionHelpers.h \
-    Src/Gui/DisassemblyPopup.h
+    Src/Gui/DisassemblyPopup.h \
+    Src/Utils/GraphLayout.h \
+    Src/Utils/GraphLayoutBenchmark.h
     
 
 FORMS += \